@@ -0,0 +1,34 @@
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+/**
+ * @file bench_common.h
+ * @brief 基准测试程序共用的计时函数
+ */
+
+#include "platform/platform.h"
+
+#ifdef _WIN32
+/**
+ * @brief 单调时钟（纳秒）
+ */
+static inline double bench_now_ns(void) {
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1e9 / (double)freq.QuadPart;
+}
+#else
+#include <time.h>
+
+/**
+ * @brief 单调时钟（纳秒）
+ */
+static inline double bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+#endif
+
+#endif // BENCH_COMMON_H
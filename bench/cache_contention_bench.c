@@ -0,0 +1,223 @@
+/**
+ * @file cache_contention_bench.c
+ * @brief 缓存争用基准：1到64个线程对分段缓存执行混合读写，观察吞吐随线程数的扩展
+ *
+ * 预先为两倍于缓存容量的域名构造应答报文和缓存键（与服务器相同，由报文视图中的问题构造），
+ * 各线程从中随机取键：按比例直接写入，其余先查缓存，未命中时写入（模拟上游应答回填）。
+ * 键集大于容量，因此写入路径持续触发CLOCK淘汰。每轮线程数不同，缓存在各轮之间保持预热。
+ *
+ * 用法: cache_contention_bench [每轮操作数] [写入百分比] [缓存容量] [分段数]
+ */
+
+#include "DNScache/relayBuild.h"
+#include "DNScache/name_hash.h"
+#include "websocket/datagram.h"
+#include "websocket/websocket.h"
+#include "debug/debug.h"
+#include "bench_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DEFAULT_OPS 4000000        // 每轮默认操作总数（各线程均分）
+#define BENCH_DEFAULT_PUT_PERCENT 10     // 默认直接写入比例
+#define BENCH_DEFAULT_CAPACITY 65536     // 默认缓存容量（条目数）
+#define BENCH_MAX_THREADS 64
+#define BENCH_PACKET_SLOT 64             // 每个预构造应答报文占用的字节数
+
+static const int g_thread_counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+// 预构造的键和报文，各线程只读共享
+typedef struct {
+    int key_count;
+    dns_cache_key_t* keys;
+    char* packets;                      // key_count个BENCH_PACKET_SLOT字节的应答报文
+    int* packet_lens;
+} bench_keyset_t;
+
+typedef struct {
+    const bench_keyset_t* keyset;
+    int* start;                         // 所有线程就绪后置1，统一开始
+    int put_percent;
+    long ops;                           // 该线程执行的操作数
+    unsigned long long rng;             // 线程私有随机数状态
+    long gets;                          // 查询次数
+    long hits;                          // 查询命中次数
+} bench_worker_t;
+
+static unsigned long long bench_rand_next(unsigned long long* state) {
+    // xorshift64*：只用于选键
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief 构造 hostN.bench.example. IN A 的应答报文（一个A记录，所有者名用指针指向查询名）
+ * @return 报文长度
+ */
+static int bench_build_response(char* packet, int index) {
+    char label[16];
+    int label_len = snprintf(label, sizeof(label), "host%d", index);
+
+    static const unsigned char header[DNS_HEADER_SIZE] = { 0, 0, 0x81, 0x80, 0, 1, 0, 1, 0, 0, 0, 0 };
+    int pos = 0;
+    memcpy(packet, header, DNS_HEADER_SIZE);
+    pos += DNS_HEADER_SIZE;
+
+    packet[pos++] = (char)label_len;
+    memcpy(packet + pos, label, label_len);
+    pos += label_len;
+    memcpy(packet + pos, "\5bench\7example\0", 15);
+    pos += 15;
+
+    static const unsigned char question_tail[4] = { 0, A, 0, 1 };
+    memcpy(packet + pos, question_tail, sizeof(question_tail));
+    pos += sizeof(question_tail);
+
+    // 所有者名0xC00C、类型A、类IN、TTL 3600、RDATA 4字节
+    static const unsigned char answer[12] = { 0xC0, 0x0C, 0, A, 0, 1, 0, 0, 0x0E, 0x10, 0, 4 };
+    memcpy(packet + pos, answer, sizeof(answer));
+    pos += sizeof(answer);
+    packet[pos++] = 10;
+    packet[pos++] = (char)(index >> 16);
+    packet[pos++] = (char)(index >> 8);
+    packet[pos++] = (char)index;
+    return pos;
+}
+
+static int bench_keyset_init(bench_keyset_t* keyset, int key_count) {
+    keyset->key_count = key_count;
+    keyset->keys = (dns_cache_key_t*)malloc(sizeof(dns_cache_key_t) * key_count);
+    keyset->packets = (char*)malloc((size_t)BENCH_PACKET_SLOT * key_count);
+    keyset->packet_lens = (int*)malloc(sizeof(int) * key_count);
+    if (!keyset->keys || !keyset->packets || !keyset->packet_lens) return MYERROR;
+
+    for (int i = 0; i < key_count; i++) {
+        char* packet = keyset->packets + (size_t)BENCH_PACKET_SLOT * i;
+        keyset->packet_lens[i] = bench_build_response(packet, i);
+
+        dns_msg_view_t view;
+        if (dns_msg_view_parse_question(&view, packet, keyset->packet_lens[i]) != MYSUCCESS ||
+            dns_cache_key_init(&keyset->keys[i], &view, &view.questions[0]) != MYSUCCESS) {
+            return MYERROR;
+        }
+    }
+    return MYSUCCESS;
+}
+
+static void bench_keyset_destroy(bench_keyset_t* keyset) {
+    free(keyset->keys);
+    free(keyset->packets);
+    free(keyset->packet_lens);
+}
+
+static THREAD_RETURN_TYPE bench_worker_main(void* arg) {
+    bench_worker_t* worker = (bench_worker_t*)arg;
+    const bench_keyset_t* keyset = worker->keyset;
+    char packet_buf[BENCH_PACKET_SLOT];
+
+    while (!platform_atomic_load_acquire(worker->start)) {
+        platform_cpu_relax();
+    }
+
+    for (long i = 0; i < worker->ops; i++) {
+        unsigned long long r = bench_rand_next(&worker->rng);
+        int index = (int)((r >> 16) % (unsigned long long)keyset->key_count);
+        const dns_cache_key_t* key = &keyset->keys[index];
+
+        if ((int)(r % 100) >= worker->put_percent) {
+            int needs_refresh;
+            worker->gets++;
+            if (dns_cache_get(key, packet_buf, sizeof(packet_buf), &needs_refresh) > 0) {
+                worker->hits++;
+                continue;
+            }
+        }
+        dns_cache_put(key, keyset->packets + (size_t)BENCH_PACKET_SLOT * index, keyset->packet_lens[index]);
+    }
+    return THREAD_RETURN_VALUE;
+}
+
+/**
+ * @brief 运行一轮：所有线程就绪后同时开始，全部结束后计时
+ * @return 吞吐量（百万操作/秒）
+ */
+static double bench_run(const bench_keyset_t* keyset, int thread_count, long total_ops, int put_percent,
+                        double* hit_ratio) {
+    pthread_t threads[BENCH_MAX_THREADS];
+    bench_worker_t workers[BENCH_MAX_THREADS];
+    int start = 0;
+
+    for (int i = 0; i < thread_count; i++) {
+        workers[i].keyset = keyset;
+        workers[i].start = &start;
+        workers[i].put_percent = put_percent;
+        workers[i].ops = total_ops / thread_count + (i < total_ops % thread_count ? 1 : 0);
+        workers[i].rng = 0x9E3779B97F4A7C15ULL * (unsigned long long)(i + 1);
+        workers[i].gets = 0;
+        workers[i].hits = 0;
+        platform_thread_create(&threads[i], NULL, bench_worker_main, &workers[i]);
+    }
+
+    double begin = bench_now_ns();
+    platform_atomic_store_release(&start, 1);
+
+    long hits = 0;
+    long gets = 0;
+    for (int i = 0; i < thread_count; i++) {
+        platform_thread_join(threads[i], NULL);
+        hits += workers[i].hits;
+        gets += workers[i].gets;
+    }
+    double elapsed = bench_now_ns() - begin;
+
+    *hit_ratio = gets > 0 ? (double)hits / (double)gets : 0.0;
+    return (double)total_ops / elapsed * 1e3;
+}
+
+int main(int argc, char* argv[]) {
+    long total_ops = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_OPS;
+    int put_percent = argc > 2 ? atoi(argv[2]) : BENCH_DEFAULT_PUT_PERCENT;
+    int capacity = argc > 3 ? atoi(argv[3]) : BENCH_DEFAULT_CAPACITY;
+    int segments = argc > 4 ? atoi(argv[4]) : 0;
+    if (total_ops <= 0) total_ops = BENCH_DEFAULT_OPS;
+    if (put_percent < 0 || put_percent > 100) put_percent = BENCH_DEFAULT_PUT_PERCENT;
+    if (capacity <= 0) capacity = BENCH_DEFAULT_CAPACITY;
+    if (segments < 0) segments = 0;
+
+    set_log_level(LOG_LEVEL_ERROR);
+    name_hash_init();
+
+    dns_cache_config_t config;
+    dns_cache_config_init(&config);
+    config.max_size = capacity;
+    config.num_segments = segments;
+    config.prefetch_percent = 0;
+    if (dns_cache_init(&config) != MYSUCCESS) {
+        printf("缓存初始化失败\n");
+        return 1;
+    }
+
+    bench_keyset_t keyset;
+    if (bench_keyset_init(&keyset, capacity * 2) != MYSUCCESS) {
+        printf("键集构造失败\n");
+        bench_keyset_destroy(&keyset);
+        dns_cache_destroy();
+        return 1;
+    }
+
+    printf("缓存容量: %d, 分段数: %s, 键数: %d, 写入比例: %d%%, 每轮操作: %ld\n",
+           capacity, segments > 0 ? argv[4] : "按CPU推导", keyset.key_count, put_percent, total_ops);
+    printf("%-8s %-16s %-10s\n", "线程", "吞吐(M操作/秒)", "命中率");
+    for (size_t i = 0; i < sizeof(g_thread_counts) / sizeof(g_thread_counts[0]); i++) {
+        double hit_ratio;
+        double mops = bench_run(&keyset, g_thread_counts[i], total_ops, put_percent, &hit_ratio);
+        printf("%-8d %-16.2f %.1f%%\n", g_thread_counts[i], mops, hit_ratio * 100.0);
+    }
+
+    bench_keyset_destroy(&keyset);
+    dns_cache_destroy();
+    return 0;
+}
@@ -0,0 +1,184 @@
+/**
+ * @file name_hash_bench.c
+ * @brief 域名哈希微基准：name_fold_hash各内核与原djb2哈希对比，并校验各内核结果一致
+ *
+ * 先用随机输入（含大写、非ASCII字节和各种长度）比较avx2、sse2、scalar三个内核的哈希值和折叠输出，
+ * 任何不一致都以非零退出码结束，不再测速；一致时按若干典型域名长度测量每个域名的耗时。
+ * djb2为原域名表使用的逐字节小写化哈希，只计算哈希、不输出折叠后的字节。
+ *
+ * 用法: name_hash_bench [每种长度的哈希次数]
+ */
+
+#include "DNScache/name_hash.h"
+#include "debug/debug.h"
+#include "bench_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DEFAULT_ROUNDS 4000000     // 每种长度默认哈希次数
+#define BENCH_NAME_POOL 1024             // 轮流哈希的域名个数（避免只测同一缓存行）
+#define BENCH_MAX_NAME_LEN 256
+#define BENCH_VERIFY_CASES 200000        // 一致性校验的随机输入个数
+
+static const int g_name_lengths[] = { 12, 24, 48, 96, 253 };
+
+static const char* const g_kernel_names[] = { "scalar", "sse2", "avx2" };
+
+static char g_names[BENCH_NAME_POOL][BENCH_MAX_NAME_LEN];
+
+// 测速结果写入此处，防止编译器删除哈希计算
+static volatile unsigned long long g_sink;
+
+/**
+ * @brief 原域名表使用的djb2哈希（逐字节折叠'A'..'Z'）
+ */
+static unsigned int bench_djb2(const char* domain) {
+    unsigned int hash = 5381;
+    int c;
+    while ((c = *domain++)) {
+        if (c >= 'A' && c <= 'Z') {
+            c += 32;
+        }
+        hash = ((hash << 5) + hash) + c;
+    }
+    return hash;
+}
+
+static unsigned long long bench_rand_next(unsigned long long* state) {
+    // xorshift64*：只用于生成测试输入
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief 生成指定长度的点分域名：大小写混合的字母数字标签，标签间用'.'分隔
+ */
+static void bench_fill_name(char* name, int len, unsigned long long* state) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-";
+    int label_len = 0;
+    for (int i = 0; i < len; i++) {
+        unsigned long long r = bench_rand_next(state);
+        if (label_len > 0 && i < len - 1 && (label_len >= 63 || r % 9 == 0)) {
+            name[i] = '.';
+            label_len = 0;
+        } else {
+            name[i] = alphabet[(r >> 8) % (sizeof(alphabet) - 1)];
+            label_len++;
+        }
+    }
+    name[len] = '\0';
+}
+
+/**
+ * @brief 校验各可用内核对随机输入给出相同的哈希和折叠输出，折叠结果与逐字节小写化一致
+ * @return 不一致的输入个数
+ */
+static int bench_verify_kernels(void) {
+    unsigned long long state = 0x9E3779B97F4A7C15ULL;
+    char input[BENCH_MAX_NAME_LEN];
+    char expected[BENCH_MAX_NAME_LEN];
+    char folded[BENCH_MAX_NAME_LEN];
+    int mismatches = 0;
+
+    for (int n = 0; n < BENCH_VERIFY_CASES; n++) {
+        size_t len = (size_t)(bench_rand_next(&state) % BENCH_MAX_NAME_LEN);
+        for (size_t i = 0; i < len; i++) {
+            // 一半概率取'@'..'['附近的字节，覆盖'A'/'Z'边界；其余取全字节范围（含0x80以上）
+            unsigned long long r = bench_rand_next(&state);
+            input[i] = (r & 1) ? (char)('@' + (r >> 8) % 28) : (char)(r >> 16);
+            expected[i] = (input[i] >= 'A' && input[i] <= 'Z') ? (char)(input[i] + 32) : input[i];
+        }
+        unsigned long long seed = bench_rand_next(&state);
+
+        unsigned long long reference = name_fold_hash_kernel(NAME_HASH_KERNEL_SCALAR, input, len, folded, seed);
+        if (memcmp(folded, expected, len) != 0) {
+            printf("折叠结果错误: 内核 scalar, 长度 %zu\n", len);
+            mismatches++;
+            continue;
+        }
+        for (int k = NAME_HASH_KERNEL_SSE2; k <= NAME_HASH_KERNEL_AVX2; k++) {
+            if (!name_hash_kernel_supported((name_hash_kernel_t)k)) continue;
+            memset(folded, 0, sizeof(folded));
+            unsigned long long hash = name_fold_hash_kernel((name_hash_kernel_t)k, input, len, folded, seed);
+            if (hash != reference || memcmp(folded, expected, len) != 0) {
+                printf("内核结果不一致: %s 与 scalar, 长度 %zu\n", g_kernel_names[k], len);
+                mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+/**
+ * @brief 测量一种长度下的单个域名耗时
+ * @param kernel 内核编号，-1表示djb2
+ * @return 每个域名的纳秒数
+ */
+static double bench_run(int kernel, int len, long rounds) {
+    char folded[BENCH_MAX_NAME_LEN];
+    unsigned long long acc = 0;
+
+    double start = bench_now_ns();
+    if (kernel < 0) {
+        for (long i = 0; i < rounds; i++) {
+            acc += bench_djb2(g_names[i & (BENCH_NAME_POOL - 1)]);
+        }
+    } else {
+        for (long i = 0; i < rounds; i++) {
+            acc += name_fold_hash_kernel((name_hash_kernel_t)kernel, g_names[i & (BENCH_NAME_POOL - 1)],
+                                         (size_t)len, folded, 0);
+        }
+    }
+    double elapsed = bench_now_ns() - start;
+
+    g_sink += acc;
+    return elapsed / (double)rounds;
+}
+
+int main(int argc, char* argv[]) {
+    long rounds = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_ROUNDS;
+    if (rounds <= 0) rounds = BENCH_DEFAULT_ROUNDS;
+
+    set_log_level(LOG_LEVEL_ERROR);
+    name_hash_init();
+
+    printf("当前内核: %s，可用内核:", name_hash_kernel_name());
+    for (int k = NAME_HASH_KERNEL_SCALAR; k <= NAME_HASH_KERNEL_AVX2; k++) {
+        if (name_hash_kernel_supported((name_hash_kernel_t)k)) printf(" %s", g_kernel_names[k]);
+    }
+    printf("\n");
+
+    int mismatches = bench_verify_kernels();
+    if (mismatches > 0) {
+        printf("一致性校验失败: %d / %d 个输入\n", mismatches, BENCH_VERIFY_CASES);
+        return 1;
+    }
+    printf("一致性校验通过: %d 个随机输入\n", BENCH_VERIFY_CASES);
+
+    printf("每种长度哈希次数: %ld，单位: 纳秒/域名\n", rounds);
+    printf("%-8s %-10s", "长度", "djb2");
+    for (int k = NAME_HASH_KERNEL_SCALAR; k <= NAME_HASH_KERNEL_AVX2; k++) {
+        if (name_hash_kernel_supported((name_hash_kernel_t)k)) printf(" %-10s", g_kernel_names[k]);
+    }
+    printf("\n");
+
+    unsigned long long state = 0xD1B54A32D192ED03ULL;
+    for (size_t i = 0; i < sizeof(g_name_lengths) / sizeof(g_name_lengths[0]); i++) {
+        int len = g_name_lengths[i];
+        for (int n = 0; n < BENCH_NAME_POOL; n++) {
+            bench_fill_name(g_names[n], len, &state);
+        }
+
+        printf("%-8d %-10.2f", len, bench_run(-1, len, rounds));
+        for (int k = NAME_HASH_KERNEL_SCALAR; k <= NAME_HASH_KERNEL_AVX2; k++) {
+            if (name_hash_kernel_supported((name_hash_kernel_t)k)) {
+                printf(" %-10.2f", bench_run(k, len, rounds));
+            }
+        }
+        printf("\n");
+    }
+    return 0;
+}
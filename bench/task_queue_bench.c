@@ -0,0 +1,176 @@
+/**
+ * @file task_queue_bench.c
+ * @brief 任务队列微基准：生产者持续入队，1/4/16/31个消费者出队
+ *
+ * 同一份源文件分别链接两种队列实现（task_queue_bench_lockfree / task_queue_bench_mutex），
+ * 输出每种消费者数下的吞吐量。消费者取不到任务时按工作线程的方式自旋后在共享的futex上挂起，
+ * 生产者入队后按需唤醒。
+ *
+ * 注意：两个版本都使用同一套futex挂起，互斥锁版本也只有try_pop，不是最初带条件变量
+ * 阻塞出队的队列。因此对比的只是“无锁环形队列的try_pop”与“互斥锁环形数组的try_pop”
+ * 在同一挂起机制下的差异，不包含条件变量唤醒的开销，不能代表相对原始实现的总体提升。
+ *
+ * 用法: task_queue_bench_xxx [每轮任务数] [生产者数]
+ */
+
+#include "Thread/thread_pool.h"
+#include "debug/debug.h"
+#include "bench_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_QUEUE_CAPACITY 4096        // 与默认工作线程本地队列同一量级
+#define BENCH_DEFAULT_TASKS 2000000      // 每轮默认任务数
+#define BENCH_MAX_PRODUCERS 8
+
+#if TASK_QUEUE_LOCKFREE
+#define BENCH_QUEUE_NAME "无锁MPMC环形队列"
+#else
+#define BENCH_QUEUE_NAME "互斥锁队列（try_pop + futex挂起，无条件变量）"
+#endif
+
+static const int g_consumer_counts[] = { 1, 4, 16, 31 };
+
+// 一轮测试共享的状态：队列和消费者挂起用的futex字（与线程池的wake_seq/sleepers相同）
+typedef struct {
+    task_queue_t queue;
+    long consumed;                      // 所有消费者累计出队数（原子累加）
+    int stop;                           // 全部任务已取走，消费者退出
+    int wake_seq;                       // 唤醒序号（futex字）
+    int sleepers;                       // 挂起的消费者数量
+} bench_state_t;
+
+typedef struct {
+    bench_state_t* state;
+    dns_task_t* task;                   // 入队的任务（队列只传递指针，不访问内容）
+    long count;                         // 该生产者入队的任务数
+    long full_retries;                  // 队列满时的重试次数
+} bench_producer_t;
+
+static THREAD_RETURN_TYPE bench_producer_main(void* arg) {
+    bench_producer_t* producer = (bench_producer_t*)arg;
+    bench_state_t* state = producer->state;
+    for (long i = 0; i < producer->count; i++) {
+        while (task_queue_push(&state->queue, producer->task) != MYSUCCESS) {
+            producer->full_retries++;
+            platform_cpu_relax();
+        }
+        platform_atomic_fence();
+        if (platform_atomic_load_relaxed(&state->sleepers) > 0) {
+            platform_atomic_fetch_add(&state->wake_seq, 1);
+            platform_futex_wake(&state->wake_seq, 1);
+        }
+    }
+    return THREAD_RETURN_VALUE;
+}
+
+/**
+ * @brief 取一个任务：先自旋，再登记为等待者后在futex上挂起（同worker_wait_for_task）
+ * @return 取到任务返回1，超时或停止返回0
+ */
+static int bench_consumer_wait(bench_state_t* state, dns_task_t** task) {
+    for (int spin = 0; spin < TASK_QUEUE_SPIN_COUNT; spin++) {
+        if (task_queue_try_pop(&state->queue, task)) {
+            return 1;
+        }
+        platform_cpu_relax();
+    }
+
+    platform_atomic_fetch_add(&state->sleepers, 1);
+    int wake_seq = platform_atomic_load_acquire(&state->wake_seq);
+    if (task_queue_try_pop(&state->queue, task)) {
+        platform_atomic_fetch_sub(&state->sleepers, 1);
+        return 1;
+    }
+    if (!platform_atomic_load_acquire(&state->stop)) {
+        platform_futex_wait(&state->wake_seq, wake_seq, QUEUE_TIMEOUT_MS);
+    }
+    platform_atomic_fetch_sub(&state->sleepers, 1);
+    return task_queue_try_pop(&state->queue, task);
+}
+
+static THREAD_RETURN_TYPE bench_consumer_main(void* arg) {
+    bench_state_t* state = (bench_state_t*)arg;
+    dns_task_t* task;
+    while (!platform_atomic_load_acquire(&state->stop)) {
+        if (bench_consumer_wait(state, &task)) {
+            platform_atomic_add_relaxed(&state->consumed, 1);
+        }
+    }
+    return THREAD_RETURN_VALUE;
+}
+
+/**
+ * @brief 运行一轮：启动消费者和生产者，等待全部任务被取走后关闭队列
+ * @return 吞吐量（百万任务/秒），失败返回负数
+ */
+static double bench_run(int consumer_count, int producer_count, long total_tasks, long* full_retries) {
+    bench_state_t state;
+    memset(&state, 0, sizeof(state));
+    if (task_queue_init(&state.queue, BENCH_QUEUE_CAPACITY) != MYSUCCESS) {
+        return -1.0;
+    }
+
+    dns_task_t task;
+    pthread_t consumer_threads[MAX_WORKER_THREADS];
+    pthread_t producer_threads[BENCH_MAX_PRODUCERS];
+    bench_producer_t producers[BENCH_MAX_PRODUCERS];
+
+    for (int i = 0; i < consumer_count; i++) {
+        platform_thread_create(&consumer_threads[i], NULL, bench_consumer_main, &state);
+    }
+
+    double start = bench_now_ns();
+    for (int i = 0; i < producer_count; i++) {
+        producers[i].state = &state;
+        producers[i].task = &task;
+        producers[i].count = total_tasks / producer_count + (i < total_tasks % producer_count ? 1 : 0);
+        producers[i].full_retries = 0;
+        platform_thread_create(&producer_threads[i], NULL, bench_producer_main, &producers[i]);
+    }
+
+    *full_retries = 0;
+    for (int i = 0; i < producer_count; i++) {
+        platform_thread_join(producer_threads[i], NULL);
+        *full_retries += producers[i].full_retries;
+    }
+    while (platform_atomic_load_acquire(&state.consumed) < total_tasks) {
+        platform_cpu_relax();
+    }
+    double elapsed = bench_now_ns() - start;
+
+    platform_atomic_store_release(&state.stop, 1);
+    platform_atomic_fetch_add(&state.wake_seq, 1);
+    platform_futex_wake(&state.wake_seq, 0);
+    for (int i = 0; i < consumer_count; i++) {
+        platform_thread_join(consumer_threads[i], NULL);
+    }
+    task_queue_destroy(&state.queue);
+
+    return (double)total_tasks / elapsed * 1e3;
+}
+
+int main(int argc, char* argv[]) {
+    long total_tasks = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_TASKS;
+    int producer_count = argc > 2 ? atoi(argv[2]) : 1;
+    if (total_tasks <= 0) total_tasks = BENCH_DEFAULT_TASKS;
+    if (producer_count < 1) producer_count = 1;
+    if (producer_count > BENCH_MAX_PRODUCERS) producer_count = BENCH_MAX_PRODUCERS;
+
+    set_log_level(LOG_LEVEL_ERROR);
+
+    printf("任务队列: %s, 容量: %d, 生产者: %d, 每轮任务: %ld\n",
+           BENCH_QUEUE_NAME, BENCH_QUEUE_CAPACITY, producer_count, total_tasks);
+    printf("%-8s %-16s %-12s\n", "消费者", "吞吐(M任务/秒)", "队列满重试");
+    for (size_t i = 0; i < sizeof(g_consumer_counts) / sizeof(g_consumer_counts[0]); i++) {
+        long full_retries;
+        double mops = bench_run(g_consumer_counts[i], producer_count, total_tasks, &full_retries);
+        if (mops < 0) {
+            printf("队列初始化失败\n");
+            return 1;
+        }
+        printf("%-8d %-16.2f %-12ld\n", g_consumer_counts[i], mops, full_retries);
+    }
+    return 0;
+}
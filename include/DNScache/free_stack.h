@@ -27,6 +27,14 @@ typedef struct {
  */
 int free_stack_init(free_stack_t* stack, int capacity);
 
+/**
+ * @brief 扩大栈容量，新增的索引[原容量, new_capacity)全部入栈
+ * @param stack 栈结构体指针
+ * @param new_capacity 新容量（必须大于原容量）
+ * @return 成功返回0，失败返回-1（原栈保持不变）
+ */
+int free_stack_grow(free_stack_t* stack, int new_capacity);
+
 /**
  * @brief 销毁空闲条目栈
  * @param stack 栈结构体指针
@@ -0,0 +1,65 @@
+#ifndef NAME_HASH_H
+#define NAME_HASH_H
+
+/**
+ * @file name_hash.h
+ * @brief 域名小写化与哈希的一遍式内核
+ *
+ * 一次遍历完成ASCII大小写折叠并计算64位哈希，同时输出折叠后的字节，
+ * 之后比较只需先比长度和哈希再memcmp，不必再做strcasecmp。
+ * 缓存键、本地域名表等按域名索引的结构共用此内核。
+ *
+ * 实现按16字节（SSE2）或32字节（AVX2，运行时检测）分块折叠，哈希按8字节字序吸收，
+ * 因此各实现对同一输入的结果完全一致；不支持SIMD的平台使用逐字节折叠的标量实现。
+ *
+ * 吸收函数采用wyhash式的128位乘法混合，并以进程启动时随机生成的密钥为参数，
+ * 外部无法预先构造落入同一哈希桶的域名。
+ */
+
+#include <stddef.h>
+
+/**
+ * @brief 生成进程级随机哈希密钥
+ *
+ * 必须在任何表建立之前、工作线程启动之前调用一次；之后所有哈希值都依赖该密钥。
+ *
+ * @return 从操作系统取得随机数返回1，退化为时间/地址混合返回0
+ */
+int name_hash_init(void);
+
+/**
+ * @brief 折叠大小写并计算哈希
+ * @param name 输入字节（不要求以NUL结尾）
+ * @param len 字节数
+ * @param out 输出折叠后的字节（至少len字节，可与name相同）
+ * @param seed 哈希种子（调用方可用它混入查询类型等附加字段）
+ * @return 64位哈希
+ */
+unsigned long long name_fold_hash(const char* name, size_t len, char* out, unsigned long long seed);
+
+// 内核实现，按分块宽度递增排列
+typedef enum {
+    NAME_HASH_KERNEL_SCALAR = 0,
+    NAME_HASH_KERNEL_SSE2,
+    NAME_HASH_KERNEL_AVX2
+} name_hash_kernel_t;
+
+/**
+ * @brief 指定内核在当前编译目标和CPU上是否可用
+ */
+int name_hash_kernel_supported(name_hash_kernel_t kernel);
+
+/**
+ * @brief 以指定内核为上限折叠大小写并计算哈希（基准测试和一致性校验用）
+ *
+ * 不可用的宽内核自动退回到可用的较窄实现，结果与name_fold_hash相同。
+ */
+unsigned long long name_fold_hash_kernel(name_hash_kernel_t kernel, const char* name, size_t len, char* out,
+                                         unsigned long long seed);
+
+/**
+ * @brief 当前使用的内核实现名称（"avx2"、"sse2"或"scalar"），用于启动日志
+ */
+const char* name_hash_kernel_name(void);
+
+#endif // NAME_HASH_H
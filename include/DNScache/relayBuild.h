@@ -16,17 +16,30 @@
 #define MAX_IP_LENGTH 46                // 扩展以支持IPv6地址
 #define DOMAIN_TABLE_HASH_SIZE 16384     // 优化：16K哈希桶，平衡内存和性能
 #define DOMAIN_TABLE_NUM_SEGMENTS 64     // 优化：64个分段，适合多核CPU
+#define LOCAL_ANSWER_TTL 3600            // 本地表应答的TTL（1小时）
+#define LOCAL_ANSWER_MAX_RR_LEN 28       // 应答模板最大长度：压缩名(2)+类型/类/TTL/长度(10)+IPv6地址(16)
+
+// 本地表应答模板：加载时预编译好的响应标志和回答记录（所有者名为指向问题的压缩指针0xC00C）
+typedef struct {
+    unsigned short flags;               // 响应标志（NOERROR，屏蔽域名为NXDOMAIN）
+    unsigned short ancount;             // 回答记录数（0或1）
+    int rr_len;                         // 回答记录长度
+    char rr[LOCAL_ANSWER_MAX_RR_LEN];   // 线路格式的回答记录
+} dns_answer_template_t;
 
 // IP地址条目，支持IPv4和IPv6
 typedef struct ip_address_entry {
     unsigned short type;                // 查询类型 (e.g., T_A, T_AAAA)
     char ip[MAX_IP_LENGTH];             // IP地址字符串
+    dns_answer_template_t answer;       // 预编译的应答模板
     struct ip_address_entry* next;      // 指向下一个IP地址
 } ip_address_entry_t;
 
 // 本地域名表条目
 typedef struct domain_entry {
-    char domain[MAX_DOMAIN_LENGTH];     // 域名
+    char domain[MAX_DOMAIN_LENGTH];     // 域名（小写）
+    int domain_len;                     // 域名长度
+    unsigned long long hash;            // 域名哈希（比较时先比长度和哈希，再比较字节）
     ip_address_entry_t* ips;            // IP地址链表
     int is_blocked;                     // 是否被阻止（0.0.0.0或::标记）
     struct domain_entry* next;          // 哈希冲突链表
@@ -37,6 +50,7 @@ typedef struct {
     pthread_rwlock_t rwlock;            // 保护该段的读写锁
     domain_entry_t* hash_buckets[DOMAIN_TABLE_HASH_SIZE / DOMAIN_TABLE_NUM_SEGMENTS]; // 该段的哈希桶
     int entry_count;                    // 该段的条目数量
+    int max_chain;                      // 该段出现过的最长冲突链长度
 } domain_table_segment_t;
 
 // 本地域名表
@@ -50,54 +64,138 @@ typedef struct {
 // LRU缓存相关定义
 // ============================================================================
 
-#define DNS_CACHE_SIZE 20000             // 缓存容量（优化：增加到2万，提升命中率）
-#define DNS_CACHE_HASH_SIZE 32768        // 哈希表大小（优化：32K，平衡内存和冲突率）
+#define DNS_CACHE_ENTRIES_PER_CPU 65536  // 默认容量：每个CPU核心6.5万条（槽位按需分配，不预占内存）
+#define DNS_CACHE_MAX_SIZE (1 << 28)     // 容量上限
+#define DNS_CACHE_BYTES_PER_CPU (32u << 20) // 默认字节预算：每个CPU核心32MB（条目、数据块头、报文和缓存键）
+#define DNS_CACHE_MAX_EVICT_PER_PUT 128  // 单次写入为腾出字节预算最多淘汰的条目数（超出部分由维护回收）
+#define DNS_CACHE_SIZE_CLASSES 8         // 条目大小分布的档位数：≤128、≤256、…、≤8K、>8K字节
+#define DNS_CACHE_SEGMENTS_PER_CPU 16    // 默认分段数：CPU核心数×16，向上取2的幂
+#define DNS_CACHE_MIN_SEGMENTS 16        // 分段数下限
+#define DNS_CACHE_MAX_SEGMENTS 4096      // 分段数上限
+#define DNS_CACHE_MIN_BUCKETS 16         // 每段最少哈希桶数（桶数取每段容量向上的2的幂）
+#define DNS_CACHE_SLAB_CHUNK 256         // 条目槽位按块分配，扩容只追加新块，已有条目地址不变
+#define DNS_CACHE_REHASH_STEP 64         // 每次写入最多迁移的旧哈希桶数（渐进式再哈希）
+#define DNS_CACHE_MAINTAIN_STEP 1024     // 每次维护最多迁移的旧哈希桶数或淘汰的超额条目数
+#define DNS_CACHE_WHEEL_BITS 6           // 过期时间轮每层槽位数的位数（每层64槽）
+#define DNS_CACHE_WHEEL_SLOTS (1 << DNS_CACHE_WHEEL_BITS)
+#define DNS_CACHE_WHEEL_LEVELS 4         // 时间轮层数：1秒、64秒、约68分钟、约3天一格，覆盖DNS_CACHE_MAX_TTL
+#define DNS_CACHE_EXPIRE_BATCH 256       // 每段每次最多回收的过期条目数（限制单次写锁时长）
+#define DNS_CACHE_WHEEL_MAX_TICKS 1024   // 每段每次最多推进的刻度数（长时间停顿后分多次追上）
+#define DNS_CACHE_HOUSEKEEPING_MS 250    // 缓存维护线程周期（更新粗粒度时钟、过期回收、再哈希）
+#define DNS_CACHE_PREFETCH_PERCENT 10    // 默认预取窗口：命中时剩余TTL不超过原TTL的10%即发起刷新（0为关闭）
+#define DNS_CACHE_PREFETCH_MIN_HITS 8    // 默认预取门槛：本次应答写入后至少命中8次的条目才算热点
+#define DNS_CACHE_PREFETCH_RETRY 5       // 同一条目两次预取的最小间隔（秒，与上游请求超时一致）
 #define DEFAULT_TTL 300                 // 默认TTL（5分钟）
-#define DNS_CACHE_NUM_SEGMENTS 128       // 分段数量，必须是2的幂（优化：128段，减少锁争用）
-#define MAX_CACHE_KEY_LENGTH (MAX_DOMAIN_LENGTH + 10) // 缓存键最大长度 "domain:TYPE"
+#define DNS_CACHE_MAX_TTL 604800         // 缓存时长上限（7天）
+#define DNS_CACHE_NO_NEGATIVE_TTL 0xFFFFFFFFu  // 授权部分没有SOA记录，无法确定否定应答的缓存时长
+#define DNS_CACHE_KEY_MAX_LENGTH (DNS_MAX_NAME_WIRE_LEN + 4) // 缓存键最大长度：线路格式查询名 + QTYPE + QCLASS
+#define DNS_CACHE_MAX_TTL_OFFSETS 32     // 单个缓存响应最多可改写TTL的资源记录数（超出则不缓存）
+
+// 缓存键：小写的线路格式查询名后接网络字节序的QTYPE和QCLASS，附带预先计算的64位哈希（进程随机密钥）
+typedef struct {
+    unsigned long long hash;            // 键哈希（决定分段和哈希桶）
+    int len;                            // 键长度
+    unsigned char data[DNS_CACHE_KEY_MAX_LENGTH];
+} dns_cache_key_t;
+
+// 缓存响应数据块：报文、缓存键和TTL偏移放在同一块内存中，发布后只读，
+// 由引用计数管理生命周期。命中路径持读锁取得引用后即可释放锁，在锁外拷贝报文；
+// 条目被更新、淘汰或过期时只是放弃缓存持有的引用，最后一个读者负责释放。
+typedef struct {
+    int refcount;                       // 引用计数（缓存本身持有一个）
+    int packet_len;                     // 响应报文长度
+    int ttl_count;                      // TTL字段数量
+    time_t insert_time;                 // 写入时间（报文中TTL的计时起点）
+    unsigned short ttl_offsets[DNS_CACHE_MAX_TTL_OFFSETS]; // 各资源记录TTL字段在报文中的偏移（不含OPT伪记录）
+    char data[];                        // 响应报文，其后紧跟缓存键字节
+} dns_cache_blob_t;
 
-// DNS缓存条目
+// DNS缓存条目：引用上游响应的数据块，命中时拷贝报文并改写ID和剩余TTL
+// 淘汰采用CLOCK（二次机会）算法：命中只在读锁下原子置位访问位，不移动链表
 typedef struct dns_cache_entry {
-    char key[MAX_CACHE_KEY_LENGTH];     // 缓存键 (例如 "example.com:A")
-    DNS_ENTITY* dns_response;           // 完整的DNS响应
+    unsigned long long key_hash;        // 缓存键哈希（比较时先比长度和哈希，再比较键字节）
+    int key_len;                        // 缓存键长度
+    dns_cache_blob_t* blob;             // 响应数据块（分段写锁下替换）
     time_t expire_time;                 // 过期时间
-    time_t access_time;                 // 最后访问时间
+    int referenced;                     // CLOCK访问位（命中时原子置1，淘汰扫描时清0）
+    int slot;                           // 条目在本段槽位中的索引（归还空闲栈时使用）
+    unsigned int hits;                  // 当前应答的命中次数（读锁下原子累加，达到预取门槛后不再写）
+    time_t refresh_time;                // 最近一次发起预取的时间（0表示未发起，读锁下CAS认领）
     
-    // LRU双向链表
+    // CLOCK环（双向链表，头部为最新插入）
     struct dns_cache_entry* prev;
     struct dns_cache_entry* next;
     
     // 哈希表链表
     struct dns_cache_entry* hash_next;
+    
+    // 过期时间轮槽位链表（wheel_pprev指向前一条目的wheel_next或槽位头，任意位置O(1)摘除）
+    struct dns_cache_entry* wheel_next;
+    struct dns_cache_entry** wheel_pprev;
 } dns_cache_entry_t;
 
-// DNS缓存分段结构
+// DNS缓存分段结构：每段独占自己的哈希桶、条目槽位和过期时间轮，写入路径全程只持本段写锁
+// 调整容量时桶数组渐进式再哈希：新旧两个桶数组并存，写入和维护每次迁移一批旧桶，
+// 查找先查新数组再查旧数组；条目槽位按块追加，已发布条目的地址始终不变
 typedef struct {
-    pthread_rwlock_t rwlock;            // 读写锁保护该段
-    dns_cache_entry_t* lru_head;        // 该段的LRU链表头（最新）
-    dns_cache_entry_t* lru_tail;        // 该段的LRU链表尾（最旧）
+    pthread_rwlock_t rwlock;            // 读写锁保护该段（命中路径只取读锁）
+    dns_cache_entry_t** hash_buckets;   // 该段的哈希桶（bucket_mask + 1个）
+    unsigned int bucket_mask;           // 哈希桶掩码（桶数为2的幂）
+    dns_cache_entry_t** old_buckets;    // 再哈希期间的旧桶数组（未在再哈希时为NULL）
+    unsigned int old_bucket_mask;       // 旧桶数组掩码
+    unsigned int rehash_pos;            // 旧桶数组中下一个待迁移的桶
+    dns_cache_entry_t** slab_chunks;    // 条目槽位块（每块DNS_CACHE_SLAB_CHUNK个，按需分配）
+    int chunk_count;                    // 已分配的槽位块数
+    free_stack_t free_slots;            // 该段的空闲槽位栈（分段写锁保护）
+    dns_cache_entry_t* lru_head;        // 该段的CLOCK链表头（最新插入）
+    dns_cache_entry_t* lru_tail;        // 该段的CLOCK链表尾（淘汰扫描的起点）
     int current_size;                   // 该段当前缓存大小
-    int max_size;                       // 该段最大缓存大小
+    int max_size;                       // 该段最大条目数（决定桶数和槽位上限）
+    size_t bytes_used;                  // 该段条目占用的字节数（条目、数据块头、报文和缓存键）
+    size_t max_bytes;                   // 该段字节预算（淘汰按字节和条目数两项约束）
+    int size_classes[DNS_CACHE_SIZE_CLASSES]; // 该段条目大小分布（按字节数的2的幂分档计数）
+    int max_chain;                      // 该段出现过的最长哈希冲突链长度（插入时更新）
+    unsigned long hits;                 // 该段命中次数（读锁下原子累加）
+    unsigned long misses;               // 该段未命中次数（读锁下原子累加）
+    unsigned long prefetches;           // 该段发起的预取刷新次数（读锁下原子累加）
+    unsigned long evictions;            // 该段移除的条目数（分段写锁保护）
+    unsigned long expirations;          // 该段由时间轮回收的过期条目数（分段写锁保护）
+    time_t wheel_time;                  // 时间轮当前刻度（更早的刻度均已处理）
+    dns_cache_entry_t* wheel[DNS_CACHE_WHEEL_LEVELS][DNS_CACHE_WHEEL_SLOTS]; // 按过期时间分层挂接条目
+    char pad[PLATFORM_CACHE_LINE_SIZE]; // 使相邻分段的锁、桶和计数器不落在同一缓存行
 } dns_cache_segment_t;
 
 // LRU缓存管理器
 typedef struct {
-    dns_cache_entry_t* hash_table[DNS_CACHE_HASH_SIZE];
-    dns_cache_entry_t* entry_pool;      // 预分配的条目池
-    free_stack_t free_stack;            // 空闲条目栈
-    pthread_mutex_t pool_lock;          // 保护内存池的互斥锁
-    
-    // 分段锁
-    dns_cache_segment_t segments[DNS_CACHE_NUM_SEGMENTS];
+    // 分段（各自持有哈希桶、条目槽位和锁），分段数在初始化时确定
+    dns_cache_segment_t* segments;
+    int num_segments;                   // 分段数（2的幂）
+    unsigned int segment_mask;          // 分段掩码（键哈希低位选段）
+    int segment_bits;                   // 分段数的位数（键哈希右移该位数后选桶）
     
-    int max_size;                       // 最大缓存大小
+    int max_size;                       // 最大缓存大小（统计信息按分段计数，汇总时相加；resize_lock保护）
+    size_t max_bytes;                   // 总字节预算（各分段均分；resize_lock保护）
+    pthread_mutex_t resize_lock;        // 串行化在线容量调整
+    int prefetch_percent;               // 预取窗口（剩余TTL占原TTL的百分比，0为关闭）
+    unsigned int prefetch_min_hits;     // 预取门槛（当前应答的最少命中次数）
     
-    // 统计信息（使用原子操作或单独锁保护）
-    unsigned long cache_hits;
-    unsigned long cache_misses;
-    unsigned long cache_evictions;
+    // 缓存维护线程：推进各分段时间轮回收过期条目，并执行再哈希和超额淘汰
+    time_t clock;                       // 粗粒度时钟（维护线程每周期更新，命中和写入路径不调用time()）
+    pthread_t housekeeper;              // 维护线程
+    int housekeeper_running;            // 维护线程运行标志（housekeeper_lock保护）
+    pthread_mutex_t housekeeper_lock;
+    pthread_cond_t housekeeper_cond;    // 用于唤醒维护线程退出
 } dns_lru_cache_t;
 
+// 缓存运行配置（0表示按CPU核心数推导）
+typedef struct {
+    int max_size;                       // 缓存总容量（条目数）
+    size_t max_bytes;                   // 缓存总字节预算
+    int num_segments;                   // 分段数（非2的幂时向上取整）
+    int prefetch_percent;               // 预取窗口百分比（0为关闭，不按CPU推导）
+    int prefetch_min_hits;              // 预取门槛命中次数
+} dns_cache_config_t;
+
 // ============================================================================
 // 查询结果枚举
 // ============================================================================
@@ -110,11 +208,13 @@ typedef enum {
     QUERY_RESULT_ERROR          // 查询错误
 } dns_query_result_t;
 
-// 查询结果结构
+// 查询结果结构（由调用方提供）
 typedef struct {
     dns_query_result_t result_type;
-    DNS_ENTITY* dns_response;           // cache缓存找到返回DNS响应
+    int packet_len;                     // 缓存命中时写入调用方缓冲区的响应报文长度
+    int needs_refresh;                  // 缓存命中的是进入TTL末段的热点条目，调用方应向上游发起一次预取
     char resolved_ip[MAX_IP_LENGTH];    // 本地表查找时返回ip
+    dns_answer_template_t answer;       // 本地表命中（含屏蔽）时返回应答模板
 } dns_query_response_t;
 
 // ============================================================================
@@ -128,26 +228,33 @@ ip_address_entry_t* domain_table_lookup(const char* domain, unsigned short qtype
 void domain_table_destroy();
 
 // LRU缓存管理
-int dns_cache_init(int max_size);
-dns_cache_entry_t* dns_cache_get(const char* domain, unsigned short qtype);
-int dns_cache_put(const char* domain, unsigned short qtype, DNS_ENTITY* response, int ttl);
+void dns_cache_config_init(dns_cache_config_t* config);
+int dns_cache_init(const dns_cache_config_t* config);
+int dns_cache_resize(int max_size, size_t max_bytes);
+int dns_cache_config_load(const char* filename, dns_cache_config_t* config);
+int dns_cache_reload_config(const char* filename);
+void dns_cache_maintain(void);
+int dns_cache_key_init(dns_cache_key_t* key, const dns_msg_view_t* view, const dns_question_view_t* question);
+int dns_cache_get(const dns_cache_key_t* key, char* packet_buf, int packet_buf_size, int* needs_refresh);
+int dns_cache_put(const dns_cache_key_t* key, const char* packet, int packet_len);
 void dns_cache_cleanup_expired();
 void dns_cache_print_stats();
 void dns_cache_destroy();
 
 // 统一查询接口
-dns_query_response_t* dns_relay_query(const char* domain, unsigned short qtype);
-int dns_relay_init(const char* domain_file);
+int dns_relay_query(const dns_msg_view_t* request, dns_query_response_t* response,
+                    char* packet_buf, int packet_buf_size);
+int dns_relay_init(const char* domain_file, const dns_cache_config_t* cache_config);
 void dns_relay_cleanup(void);
-int dns_relay_cache_response(const char* domain, unsigned short qtype, DNS_ENTITY* response);
+int dns_relay_cache_response(const dns_msg_view_t* view);
 void dns_relay_get_stats(int* domain_count, int* cache_size, unsigned long* cache_hits, unsigned long* cache_misses);
 
 // 内部辅助函数声明
-unsigned int hash_key(const char* key);
-dns_cache_segment_t* get_cache_segment(const char* key);
-domain_table_segment_t* get_domain_table_segment(const char* domain);
+dns_cache_segment_t* get_cache_segment(unsigned long long key_hash);
+domain_table_segment_t* get_domain_table_segment(unsigned long long domain_hash);
 void lru_move_to_head_segment(dns_cache_segment_t* segment, dns_cache_entry_t* entry);
 dns_cache_entry_t* lru_remove_tail_segment(dns_cache_segment_t* segment);
+dns_cache_entry_t* clock_evict_segment(dns_cache_segment_t* segment);
 
 #endif // RELAYBUILD_H
 
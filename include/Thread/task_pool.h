@@ -0,0 +1,117 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+/**
+ * @file task_pool.h
+ * @brief DNS任务对象池：按数据包大小分级的预分配任务缓冲区
+ *
+ * 任务队列中只传递dns_task_t指针，任务头和数据缓冲区来自预分配的分级空闲表：
+ * - 小任务（≤TASK_BUFFER_SMALL_SIZE）：普通查询
+ * - 大任务（≤TASK_BUFFER_LARGE_SIZE）：EDNS响应等
+ * - 超出大任务或分级耗尽时按需malloc，释放时归还系统
+ *
+ * 每个分级的空闲表是以索引链接的无锁栈（Treiber栈），栈顶与版本号打包在一个64位字中
+ * 通过CAS更新，版本号每次修改递增以避免ABA；分配与归还路径不加锁。
+ */
+
+#include "platform/platform.h"
+#include <time.h>
+
+#define TASK_BUFFER_SMALL_SIZE 512       // 小任务缓冲区大小（传统UDP DNS报文上限）
+#define TASK_BUFFER_LARGE_SIZE 4096      // 大任务缓冲区大小（常见EDNS缓冲区上限）
+#define TASK_POOL_LARGE_RATIO 4          // 大任务数量 = 小任务数量 / 该比例
+
+// 任务类型枚举
+typedef enum {
+    TASK_CLIENT_REQUEST,    // 客户端DNS请求
+    TASK_UPSTREAM_RESPONSE, // 上游服务器响应
+    TASK_CLIENT_FORWARD     // I/O线程已确认缓存未命中的客户端请求（只需转发上游）
+} task_type_t;
+
+// 任务缓冲区来源
+typedef enum {
+    TASK_TIER_SMALL,        // 小任务分级
+    TASK_TIER_LARGE,        // 大任务分级
+    TASK_TIER_HEAP,         // 按需malloc
+    TASK_TIER_COUNT
+} task_tier_t;
+
+// DNS处理任务结构体
+typedef struct {
+    char* buffer;                       // DNS数据包缓冲区（指向分级存储或按需分配的内存）
+    int buffer_len;                     // 数据包长度
+    int buffer_capacity;                // 缓冲区容量
+    struct sockaddr_in source_addr;     // 源地址信息
+    socklen_t source_addr_len;          // 源地址长度
+    task_type_t type;                   // 任务类型
+    time_t created_time;                // 任务创建时间
+    SOCKET reply_socket;                // 接收该数据包的套接字（客户端请求为监听套接字，上游响应为上游专用套接字）
+    task_tier_t tier;                   // 缓冲区来源
+    int pool_index;                     // 在所属分级中的索引
+} dns_task_t;
+
+// 单个分级：预分配的任务头数组、数据区和无锁空闲栈
+typedef struct {
+    dns_task_t* tasks;                  // 任务头数组
+    char* storage;                      // 数据区（count * buffer_size）
+    int* next_free;                     // 空闲栈链接：next_free[i]为栈中i之下的任务索引（-1表示栈底）
+    int buffer_size;                    // 每个任务的缓冲区大小
+    int count;                          // 任务数量
+
+    // 栈顶与空闲计数被所有线程修改，独占缓存行
+    char pad0[PLATFORM_CACHE_LINE_SIZE];
+    unsigned long long free_head;       // 高32位为版本号，低32位为栈顶索引+1（0表示栈空）
+    int free_count;                     // 空闲任务数（仅用于统计，近似值）
+    char pad1[PLATFORM_CACHE_LINE_SIZE - sizeof(unsigned long long) - sizeof(int)];
+} task_tier_pool_t;
+
+// 任务对象池
+typedef struct {
+    task_tier_pool_t tiers[TASK_TIER_HEAP];        // 小任务、大任务两个预分配分级
+    unsigned long acquire_count[TASK_TIER_COUNT];  // 各来源的分配次数（relaxed原子计数）
+    unsigned long acquire_failures;                // 分配失败次数（relaxed原子计数）
+    int is_initialized;
+} task_pool_t;
+
+/**
+ * @brief 初始化任务对象池
+ * @param pool 对象池指针
+ * @param small_count 小任务数量
+ * @param large_count 大任务数量
+ * @return 成功返回MYSUCCESS，失败返回MYERROR
+ */
+int task_pool_init(task_pool_t* pool, int small_count, int large_count);
+
+/**
+ * @brief 销毁任务对象池（调用前所有任务需已归还）
+ * @param pool 对象池指针
+ */
+void task_pool_destroy(task_pool_t* pool);
+
+/**
+ * @brief 获取一个能容纳指定长度数据包的任务
+ *
+ * 优先使用能容纳数据的最小分级，该分级耗尽时尝试更大的分级，最后按需malloc。
+ *
+ * @param pool 对象池指针
+ * @param packet_len 数据包长度
+ * @return 成功返回任务指针（buffer_capacity >= packet_len），失败返回NULL
+ */
+dns_task_t* task_pool_acquire(task_pool_t* pool, int packet_len);
+
+/**
+ * @brief 归还任务
+ * @param pool 对象池指针
+ * @param task 任务指针（按需分配的任务直接free）
+ */
+void task_pool_release(task_pool_t* pool, dns_task_t* task);
+
+/**
+ * @brief 获取分级当前可用任务数
+ * @param pool 对象池指针
+ * @param tier 分级（TASK_TIER_SMALL或TASK_TIER_LARGE）
+ * @return 可用任务数（并发分配/归还时为近似值）
+ */
+int task_pool_available(task_pool_t* pool, task_tier_t tier);
+
+#endif // TASK_POOL_H
@@ -4,6 +4,7 @@
 #include "websocket/websocket.h"
 #include "idmapping/idmapping.h"
 #include "platform/platform.h"
+#include "Thread/task_pool.h"
 #include <time.h>
 
 // 线程池配置常量
@@ -12,26 +13,39 @@
 #define MAX_QUEUE_SIZE 20000             // 优化：增大队列容量，减少任务丢弃
 #define QUEUE_TIMEOUT_MS 100             // 优化：减少超时时间，提升响应速度
 
-// 任务类型枚举
-typedef enum {
-    TASK_CLIENT_REQUEST,    // 客户端DNS请求
-    TASK_UPSTREAM_RESPONSE, // 上游服务器响应
-    TASK_SHUTDOWN          // 关闭信号
-} task_type_t;
+// 任务队列实现选择：1为无锁MPMC环形队列（默认），0为互斥锁+条件变量队列
+#ifndef TASK_QUEUE_LOCKFREE
+#define TASK_QUEUE_LOCKFREE 1
+#endif
 
-// DNS处理任务结构体
+#define TASK_QUEUE_SPIN_COUNT 64         // 工作线程找不到任务时挂起前的自旋次数
+
+#if TASK_QUEUE_LOCKFREE
+// 无锁队列槽位：sequence标记槽位轮次（Vyukov有界MPMC队列）
+typedef struct {
+    size_t sequence;                    // 槽位序号（入队等待pos，出队等待pos+1）
+    dns_task_t* task;                   // 任务指针
+} task_queue_slot_t;
+
+// 线程安全的任务队列（无锁MPMC环形队列，只存放任务指针）
+// 生产者与消费者通过CAS推进各自的位置；出队不阻塞，空闲工作线程在线程池的futex上挂起
 typedef struct {
-    char buffer[BUF_SIZE];              // DNS数据包缓冲区
-    int buffer_len;                     // 数据包长度
-    struct sockaddr_in source_addr;     // 源地址信息
-    socklen_t source_addr_len;          // 源地址长度
-    task_type_t type;                   // 任务类型
-    time_t created_time;                // 任务创建时间
-} dns_task_t;
-
-// 线程安全的任务队列
+    task_queue_slot_t* slots;           // 槽位数组（容量为2的幂）
+    int capacity;                       // 队列容量
+    size_t mask;                        // 容量掩码
+    int shutdown;                       // 关闭标志
+
+    // 入队/出队位置分别独占缓存行，避免生产者与消费者伪共享
+    char pad0[PLATFORM_CACHE_LINE_SIZE];
+    size_t enqueue_pos;                 // 下一个入队位置
+    char pad1[PLATFORM_CACHE_LINE_SIZE - sizeof(size_t)];
+    size_t dequeue_pos;                 // 下一个出队位置
+    char pad2[PLATFORM_CACHE_LINE_SIZE - sizeof(size_t)];
+} task_queue_t;
+#else
+// 线程安全的任务队列（互斥锁保护的环形数组，只存放任务指针，任务本身来自任务对象池）
 typedef struct {
-    dns_task_t* tasks;                  // 任务数组（动态分配）
+    dns_task_t** tasks;                 // 任务指针数组（动态分配）
     int capacity;                       // 队列容量
     int head;                           // 队列头索引
     int tail;                           // 队列尾索引
@@ -39,19 +53,34 @@ typedef struct {
     int shutdown;                       // 关闭标志
     
     pthread_mutex_t mutex;              // 队列访问互斥锁
-    pthread_cond_t not_empty;           // 队列非空条件变量
-    pthread_cond_t not_full;            // 队列非满条件变量
 } task_queue_t;
+#endif
+
+#define WORKER_QUEUE_MIN_SIZE 1024       // 每个工作线程本地队列的最小容量
+
+struct dns_thread_pool;
+
 // 工作线程信息结构
+// 每个工作线程持有一个本地任务队列：提交方按轮询分发到各本地队列，
+// 工作线程优先处理本地任务，本地为空时从相邻线程的队列窃取
+// 处理计数只由本线程写入（relaxed原子存储），统计时由thread_pool_get_stats汇总
 typedef struct {
     pthread_t thread_id;                // 线程ID
     int thread_index;                   // 线程索引
     int is_active;                      // 是否活跃
     unsigned long processed_tasks;      // 已处理任务数
+    unsigned long stolen_tasks;         // 从其他线程队列窃取的任务数
+    unsigned long client_requests;      // 已处理的客户端请求数
+    unsigned long upstream_responses;   // 已处理的上游响应数
+    unsigned long dropped_tasks;        // 处理失败而丢弃的任务数
     time_t last_activity;               // 最后活动时间
+    struct dns_thread_pool* pool;       // 所属线程池
+    task_queue_t local_queue;           // 本地任务队列
+    dns_send_batch_t send_batch;        // 响应批量发送缓冲区（sendmmsg）
 } worker_thread_t;
 
-// 线程池统计信息
+// 线程池统计信息（线程池内只有提交方计数total_tasks_queued/total_tasks_dropped以relaxed原子累加，
+// 其余计数在thread_pool_get_stats中由各工作线程的计数汇总）
 typedef struct {
     unsigned long total_tasks_queued;   // 总入队任务数
     unsigned long total_tasks_processed; // 总处理任务数
@@ -62,14 +91,20 @@ typedef struct {
 } thread_pool_stats_t;
 
 // DNS线程池主结构
-typedef struct {
+typedef struct dns_thread_pool {
     worker_thread_t* workers;           // 工作线程数组
     int worker_count;                   // 工作线程数量
-    task_queue_t task_queue;            // 任务队列
+    int send_batch_size;                // 工作线程批量发送大小（1表示逐个发送）
+    int queue_capacity;                 // 各本地队列容量之和
+    task_pool_t task_pool;              // 任务对象池（队列中的任务均来自此池）
+
+    // 任务分发与空闲线程挂起
+    unsigned int next_worker;           // 轮询分发计数
+    int wake_seq;                       // 唤醒序号（futex字），每次唤醒递增
+    int sleepers;                       // 挂起等待任务的工作线程数量
     
     // 剩余必要的全局锁（ID映射表已使用分段锁，不再需要全局锁）
     pthread_mutex_t socket_mutex;           // Socket操作互斥锁（可选）
-    pthread_mutex_t stats_mutex;            // 统计信息互斥锁
     
     // 线程池状态
     int is_initialized;                 // 是否已初始化
@@ -103,7 +138,7 @@ dns_thread_pool_t* thread_pool_get_global_instance(void);
  * @brief 初始化DNS线程池
  * @param pool 线程池指针
  * @param worker_count 工作线程数量（0表示使用默认值）
- * @param queue_size 任务队列大小（0表示使用默认值）
+ * @param queue_size 任务队列总容量，平均分给各工作线程的本地队列（0表示使用默认值）
  * @param server_socket 服务器Socket
  * @param mapping_table ID映射表指针
  * @return 成功返回MYSUCCESS，失败返回MYERROR
@@ -135,6 +170,13 @@ int thread_pool_stop(dns_thread_pool_t* pool, int timeout_ms);
  */
 void thread_pool_destroy(dns_thread_pool_t* pool);
 
+/**
+ * @brief 设置工作线程的批量发送大小（需在thread_pool_start之前调用）
+ * @param pool 线程池指针
+ * @param batch_size 批量大小（1~SEND_BATCH_MAX，1表示不批量）
+ */
+void thread_pool_set_send_batch_size(dns_thread_pool_t* pool, int batch_size);
+
 // ============================================================================
 // 任务队列操作函数声明
 // ============================================================================
@@ -142,27 +184,26 @@ void thread_pool_destroy(dns_thread_pool_t* pool);
 /**
  * @brief 初始化任务队列
  * @param queue 队列指针
- * @param capacity 队列容量
+ * @param capacity 队列容量（无锁实现向上取整为2的幂）
  * @return 成功返回MYSUCCESS，失败返回MYERROR
  */
 int task_queue_init(task_queue_t* queue, int capacity);
 
 /**
- * @brief 向队列添加任务（非阻塞）
+ * @brief 向队列添加任务（非阻塞，只传递指针）
  * @param queue 队列指针
- * @param task 要添加的任务
- * @return 成功返回MYSUCCESS，队列满返回MYERROR
+ * @param task 要添加的任务，入队成功后所有权转移给队列
+ * @return 成功返回MYSUCCESS，队列满返回MYERROR（任务仍归调用方所有）
  */
-int task_queue_push(task_queue_t* queue, const dns_task_t* task);
+int task_queue_push(task_queue_t* queue, dns_task_t* task);
 
 /**
- * @brief 从队列获取任务（阻塞）
+ * @brief 从队列获取任务（非阻塞，可由多个线程并发调用：本线程出队和任务窃取共用）
  * @param queue 队列指针
- * @param task 输出任务指针
- * @param timeout_ms 超时时间（毫秒，-1表示无限等待）
- * @return 成功返回MYSUCCESS，超时或关闭返回MYERROR
+ * @param task 输出任务指针，使用完毕后需归还任务对象池
+ * @return 取到任务返回1，队列为空返回0
  */
-int task_queue_pop(task_queue_t* queue, dns_task_t* task, int timeout_ms);
+int task_queue_try_pop(task_queue_t* queue, dns_task_t** task);
 
 /**
  * @brief 获取队列当前大小
@@ -185,6 +226,12 @@ int task_queue_is_empty(task_queue_t* queue);
  */
 int task_queue_is_full(task_queue_t* queue);
 
+/**
+ * @brief 关闭任务队列，之后入队失败（队列中剩余任务仍可取出）
+ * @param queue 队列指针
+ */
+void task_queue_shutdown(task_queue_t* queue);
+
 /**
  * @brief 销毁任务队列
  * @param queue 队列指针
@@ -197,7 +244,7 @@ void task_queue_destroy(task_queue_t* queue);
 
 /**
  * @brief 工作线程主函数
- * @param arg 线程参数（dns_thread_pool_t指针）
+ * @param arg 线程参数（worker_thread_t指针）
  * @return 线程返回值
  */
 THREAD_RETURN_TYPE worker_thread_main(void* arg);
@@ -233,6 +280,7 @@ void thread_pool_reset_stats(dns_thread_pool_t* pool);
  * @param source_addr 源地址
  * @param source_addr_len 源地址长度
  * @param task_type 任务类型
+ * @param reply_socket 接收该数据包的套接字（处理时经此发送响应）
  * @return 成功返回MYSUCCESS，失败返回MYERROR
  */
 int thread_pool_submit_task(dns_thread_pool_t* pool,
@@ -240,19 +288,22 @@ int thread_pool_submit_task(dns_thread_pool_t* pool,
                            int buffer_len,
                            struct sockaddr_in source_addr,
                            socklen_t source_addr_len,
-                           task_type_t task_type);
+                           task_type_t task_type,
+                           SOCKET reply_socket);
 
 /**
  * @brief 线程安全的映射表操作：添加映射
  * @param original_id 原始ID
  * @param client_addr 客户端地址
  * @param client_addr_len 客户端地址长度
+ * @param client_sock 接收该请求的监听套接字（上游响应经此返回客户端）
  * @param new_id 输出的新ID
  * @return 成功返回MYSUCCESS，失败返回MYERROR
  */
 int thread_pool_add_mapping_safe(unsigned short original_id, 
                                  struct sockaddr_in* client_addr, 
                                  int client_addr_len, 
+                                 SOCKET client_sock,
                                  unsigned short* new_id);
 
 /**
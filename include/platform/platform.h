@@ -1,211 +1,375 @@
-#ifndef PLATFORM_H
-#define PLATFORM_H
-
-#ifdef _WIN32
-    // Windows-specific includes
-    #include <winsock2.h>
-    #include <ws2tcpip.h>
-    #include <windows.h>
-    #include <process.h>
-    #include <pthread.h>  // 使用mingw64的pthread实现
-    #pragma comment(lib, "ws2_32.lib")
-    
-    // Windows下使用mingw64的pthread读写锁实现
-    // pthread_rwlock_t已在pthread.h中定义
-    
-    #define THREAD_RETURN_TYPE void*
-    #define THREAD_RETURN_VALUE NULL
-#else
-    // Linux-specific includes
-    #include <sys/socket.h>
-    #include <netinet/in.h>
-    #include <arpa/inet.h>
-    #include <unistd.h>
-    #include <fcntl.h>
-    #include <errno.h>
-    #include <pthread.h>
-    #include <arpa/inet.h> // 包含 inet_ntoa
-    
-    #define SOCKET int
-    #define INVALID_SOCKET -1
-    #define SOCKET_ERROR -1
-    #define closesocket close
-    
-    #define THREAD_RETURN_TYPE void*
-    #define THREAD_RETURN_VALUE NULL
-#endif
-
-// ============================================================================
-// 网络相关函数声明
-// ============================================================================
-void platform_init();
-void platform_cleanup();
-SOCKET create_socket();
-int set_socket_reuseaddr(SOCKET sock);
-int set_socket_nonblocking(SOCKET sock);
-int platform_get_last_error();
-
-// ============================================================================
-// 跨平台线程函数声明
-// ============================================================================
-
-/**
- * @brief 跨平台的互斥锁初始化
- * @param mutex 互斥锁指针
- * @param attr 属性（可为NULL）
- * @return 成功返回0，失败返回非0
- */
-int platform_mutex_init(pthread_mutex_t* mutex, const pthread_mutexattr_t* attr);
-
-/**
- * @brief 跨平台的互斥锁销毁
- * @param mutex 互斥锁指针
- * @return 成功返回0，失败返回非0
- */
-int platform_mutex_destroy(pthread_mutex_t* mutex);
-
-/**
- * @brief 跨平台的互斥锁加锁
- * @param mutex 互斥锁指针
- * @return 成功返回0，失败返回非0
- */
-int platform_mutex_lock(pthread_mutex_t* mutex);
-
-/**
- * @brief 跨平台的互斥锁解锁
- * @param mutex 互斥锁指针
- * @return 成功返回0，失败返回非0
- */
-int platform_mutex_unlock(pthread_mutex_t* mutex);
-
-/**
- * @brief 跨平台的条件变量初始化
- * @param cond 条件变量指针
- * @param attr 属性（可为NULL）
- * @return 成功返回0，失败返回非0
- */
-int platform_cond_init(pthread_cond_t* cond, const pthread_condattr_t* attr);
-
-/**
- * @brief 跨平台的条件变量销毁
- * @param cond 条件变量指针
- * @return 成功返回0，失败返回非0
- */
-int platform_cond_destroy(pthread_cond_t* cond);
-
-/**
- * @brief 跨平台的条件变量等待
- * @param cond 条件变量指针
- * @param mutex 关联的互斥锁指针
- * @return 成功返回0，失败返回非0
- */
-int platform_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex);
-
-/**
- * @brief 跨平台的条件变量超时等待
- * @param cond 条件变量指针
- * @param mutex 关联的互斥锁指针
- * @param timeout_ms 超时时间（毫秒）
- * @return 成功返回0，超时返回正数，失败返回负数
- */
-int platform_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, int timeout_ms);
-
-/**
- * @brief 跨平台的条件变量信号
- * @param cond 条件变量指针
- * @return 成功返回0，失败返回非0
- */
-int platform_cond_signal(pthread_cond_t* cond);
-
-/**
- * @brief 跨平台的条件变量广播
- * @param cond 条件变量指针
- * @return 成功返回0，失败返回非0
- */
-int platform_cond_broadcast(pthread_cond_t* cond);
-
-/**
- * @brief 跨平台的线程创建
- * @param thread 线程ID指针
- * @param attr 线程属性（可为NULL）
- * @param start_routine 线程函数
- * @param arg 线程参数
- * @return 成功返回0，失败返回非0
- */
-int platform_thread_create(pthread_t* thread, const pthread_attr_t* attr, 
-                          THREAD_RETURN_TYPE (*start_routine)(void*), void* arg);
-
-/**
- * @brief 跨平台的线程等待
- * @param thread 线程ID
- * @param retval 返回值指针（可为NULL）
- * @return 成功返回0，失败返回非0
- */
-int platform_thread_join(pthread_t thread, void** retval);
-
-/**
- * @brief 跨平台的线程分离
- * @param thread 线程ID
- * @return 成功返回0，失败返回非0
- */
-int platform_thread_detach(pthread_t thread);
-
-/**
- * @brief 获取当前线程ID
- * @return 当前线程ID
- */
-pthread_t platform_thread_self(void);
-
-/**
- * @brief 跨平台的睡眠函数
- * @param ms 睡眠时间（毫秒）
- */
-void platform_sleep_ms(int ms);
-
-/**
- * @brief 获取系统CPU核心数
- * @return CPU核心数
- */
-int platform_get_cpu_count(void);
-
-// ============================================================================
-// 跨平台读写锁函数声明
-// ============================================================================
-
-/**
- * @brief 跨平台的读写锁初始化
- * @param rwlock 读写锁指针
- * @param attr 属性（可为NULL）
- * @return 成功返回0，失败返回非0
- */
-int platform_rwlock_init(pthread_rwlock_t* rwlock, const pthread_rwlockattr_t* attr);
-
-/**
- * @brief 跨平台的读写锁销毁
- * @param rwlock 读写锁指针
- * @return 成功返回0，失败返回非0
- */
-int platform_rwlock_destroy(pthread_rwlock_t* rwlock);
-
-/**
- * @brief 跨平台的读写锁读锁定
- * @param rwlock 读写锁指针
- * @return 成功返回0，失败返回非0
- */
-int platform_rwlock_rdlock(pthread_rwlock_t* rwlock);
-
-/**
- * @brief 跨平台的读写锁写锁定
- * @param rwlock 读写锁指针
- * @return 成功返回0，失败返回非0
- */
-int platform_rwlock_wrlock(pthread_rwlock_t* rwlock);
-
-/**
- * @brief 跨平台的读写锁解锁
- * @param rwlock 读写锁指针
- * @return 成功返回0，失败返回非0
- */
-int platform_rwlock_unlock(pthread_rwlock_t* rwlock);
-
-#endif // PLATFORM_H
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#ifdef _WIN32
+    // Windows-specific includes
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #include <windows.h>
+    #include <process.h>
+    #include <pthread.h>  // 使用mingw64的pthread实现
+    #pragma comment(lib, "ws2_32.lib")
+    
+    // Windows下使用mingw64的pthread读写锁实现
+    // pthread_rwlock_t已在pthread.h中定义
+    
+    #define THREAD_RETURN_TYPE void*
+    #define THREAD_RETURN_VALUE NULL
+#else
+    // Linux-specific includes
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <errno.h>
+    #include <pthread.h>
+    #include <arpa/inet.h> // 包含 inet_ntoa
+    
+    #define SOCKET int
+    #define INVALID_SOCKET -1
+    #define SOCKET_ERROR -1
+    #define closesocket close
+    
+    #define THREAD_RETURN_TYPE void*
+    #define THREAD_RETURN_VALUE NULL
+#endif
+
+// ============================================================================
+// 网络相关函数声明
+// ============================================================================
+void platform_init();
+void platform_cleanup();
+SOCKET create_socket();
+int set_socket_reuseaddr(SOCKET sock);
+int set_socket_nonblocking(SOCKET sock);
+int platform_get_last_error();
+
+// ============================================================================
+// 批量数据报收发（Linux使用recvmmsg/sendmmsg，其他平台逐个收发）
+// ============================================================================
+
+#define PLATFORM_DGRAM_BATCH_MAX 64      // 单次批量收发的最大数据报数
+
+// 批量收发使用的数据报描述结构
+typedef struct {
+    char* buffer;                       // 数据缓冲区
+    int buffer_size;                    // 缓冲区容量（接收时使用）
+    int length;                         // 数据长度（接收时为实际长度，发送时为待发送长度）
+    struct sockaddr_in addr;            // 对端地址
+    socklen_t addr_len;                 // 对端地址长度（发送时为0表示经已连接套接字发送，不指定目的地址）
+} platform_dgram_t;
+
+/**
+ * @brief 从非阻塞UDP套接字批量接收数据报
+ * @param sock 套接字
+ * @param dgrams 数据报描述数组（buffer和buffer_size需预先设置）
+ * @param count 最多接收的数据报数（不超过PLATFORM_DGRAM_BATCH_MAX）
+ * @return 成功返回接收到的数据报数，无数据可读返回0，出错返回SOCKET_ERROR
+ */
+int platform_recv_batch(SOCKET sock, platform_dgram_t* dgrams, int count);
+
+/**
+ * @brief 通过UDP套接字批量发送数据报
+ * @param sock 套接字
+ * @param dgrams 数据报描述数组（buffer、length、addr和addr_len需预先设置，addr_len为0时不指定目的地址）
+ * @param count 待发送的数据报数（不超过PLATFORM_DGRAM_BATCH_MAX）
+ * @return 返回成功发送的数据报数（从头开始计；发送缓冲区已满时其后的数据报不再发送，单个数据报出错时只跳过该数据报）
+ */
+int platform_send_batch(SOCKET sock, const platform_dgram_t* dgrams, int count);
+
+// ============================================================================
+// 事件循环（Linux使用epoll边沿触发 + timerfd，其他平台使用select）
+// ============================================================================
+
+#define PLATFORM_EVENT_MAX 64            // 单次等待返回的最大事件数
+
+// 事件循环实例
+typedef struct {
+#ifdef _WIN32
+    SOCKET sockets[FD_SETSIZE];         // 已注册的套接字
+    void* socket_data[FD_SETSIZE];      // 套接字对应的用户数据
+    int socket_count;                   // 已注册套接字数量
+    int timer_interval_ms;              // 定时器周期（0表示未设置）
+    ULONGLONG timer_next_tick;          // 下一次定时器触发的时刻（GetTickCount64）
+#else
+    int epoll_fd;                       // epoll实例
+    int timer_fd;                       // 定时器（timerfd），未设置时为-1
+#endif
+    void* timer_data;                   // 定时器事件对应的用户数据
+} platform_event_loop_t;
+
+// 就绪事件
+typedef struct {
+    void* data;                         // 注册时传入的用户数据（调用方据此区分事件来源）
+    int is_timer;                       // 是否为定时器事件
+} platform_event_t;
+
+/**
+ * @brief 初始化事件循环
+ * @param loop 事件循环指针
+ * @return 成功返回0，失败返回-1
+ */
+int platform_event_loop_init(platform_event_loop_t* loop);
+
+/**
+ * @brief 注册套接字的可读事件（边沿触发，就绪后调用方需读空套接字）
+ * @param loop 事件循环指针
+ * @param sock 套接字（需为非阻塞）
+ * @param data 用户数据，事件就绪时原样返回
+ * @return 成功返回0，失败返回-1
+ */
+int platform_event_loop_add(platform_event_loop_t* loop, SOCKET sock, void* data);
+
+/**
+ * @brief 从事件循环移除套接字
+ * @param loop 事件循环指针
+ * @param sock 套接字
+ * @return 成功返回0，失败返回-1
+ */
+int platform_event_loop_remove(platform_event_loop_t* loop, SOCKET sock);
+
+/**
+ * @brief 设置周期定时器（重复调用会替换原有周期）
+ * @param loop 事件循环指针
+ * @param interval_ms 定时周期（毫秒）
+ * @param data 用户数据，定时器事件返回时原样返回
+ * @return 成功返回0，失败返回-1
+ */
+int platform_event_loop_set_timer(platform_event_loop_t* loop, int interval_ms, void* data);
+
+/**
+ * @brief 等待就绪事件
+ * @param loop 事件循环指针
+ * @param events 输出的事件数组
+ * @param max_events 事件数组容量（不超过PLATFORM_EVENT_MAX）
+ * @param timeout_ms 超时时间（毫秒，-1表示无限等待）
+ * @return 返回就绪事件数，超时或被信号中断返回0，出错返回-1
+ */
+int platform_event_loop_wait(platform_event_loop_t* loop, platform_event_t* events, int max_events, int timeout_ms);
+
+/**
+ * @brief 销毁事件循环（不关闭已注册的套接字）
+ * @param loop 事件循环指针
+ */
+void platform_event_loop_destroy(platform_event_loop_t* loop);
+
+// ============================================================================
+// 原子操作与等待/唤醒（GCC/Clang __atomic内建函数；Linux使用futex，Windows使用WaitOnAddress）
+// ============================================================================
+
+#define PLATFORM_CACHE_LINE_SIZE 64      // 缓存行大小，用于避免伪共享
+
+#define platform_atomic_load_relaxed(ptr)        __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define platform_atomic_load_acquire(ptr)        __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define platform_atomic_store_relaxed(ptr, val)  __atomic_store_n((ptr), (val), __ATOMIC_RELAXED)
+#define platform_atomic_store_release(ptr, val)  __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define platform_atomic_fetch_add(ptr, val)      __atomic_fetch_add((ptr), (val), __ATOMIC_SEQ_CST)
+#define platform_atomic_fetch_sub(ptr, val)      __atomic_fetch_sub((ptr), (val), __ATOMIC_SEQ_CST)
+#define platform_atomic_add_relaxed(ptr, val)    ((void)__atomic_fetch_add((ptr), (val), __ATOMIC_RELAXED))
+#define platform_atomic_cas_weak(ptr, expected_ptr, desired) \
+    __atomic_compare_exchange_n((ptr), (expected_ptr), (desired), 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#define platform_atomic_cas_acq_rel(ptr, expected_ptr, desired) \
+    __atomic_compare_exchange_n((ptr), (expected_ptr), (desired), 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#define platform_atomic_fence()                  __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+// 自旋等待时的CPU提示
+#if defined(__x86_64__) || defined(__i386__)
+#define platform_cpu_relax()                     __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define platform_cpu_relax()                     __asm__ __volatile__("yield")
+#else
+#define platform_cpu_relax()                     ((void)0)
+#endif
+
+/**
+ * @brief 当*addr仍等于expected时挂起当前线程，直到被唤醒或超时
+ * @param addr 等待的32位整数地址
+ * @param expected 期望值（不相等时立即返回）
+ * @param timeout_ms 超时时间（毫秒，-1表示无限等待）
+ * @return 被唤醒或值已改变返回0，超时返回1
+ */
+int platform_futex_wait(int* addr, int expected, int timeout_ms);
+
+/**
+ * @brief 唤醒在addr上等待的线程
+ * @param addr 等待的32位整数地址
+ * @param count 唤醒数量（<=0表示全部唤醒）
+ */
+void platform_futex_wake(int* addr, int count);
+
+// ============================================================================
+// 跨平台线程函数声明
+// ============================================================================
+
+/**
+ * @brief 跨平台的互斥锁初始化
+ * @param mutex 互斥锁指针
+ * @param attr 属性（可为NULL）
+ * @return 成功返回0，失败返回非0
+ */
+int platform_mutex_init(pthread_mutex_t* mutex, const pthread_mutexattr_t* attr);
+
+/**
+ * @brief 跨平台的互斥锁销毁
+ * @param mutex 互斥锁指针
+ * @return 成功返回0，失败返回非0
+ */
+int platform_mutex_destroy(pthread_mutex_t* mutex);
+
+/**
+ * @brief 跨平台的互斥锁加锁
+ * @param mutex 互斥锁指针
+ * @return 成功返回0，失败返回非0
+ */
+int platform_mutex_lock(pthread_mutex_t* mutex);
+
+/**
+ * @brief 跨平台的互斥锁解锁
+ * @param mutex 互斥锁指针
+ * @return 成功返回0，失败返回非0
+ */
+int platform_mutex_unlock(pthread_mutex_t* mutex);
+
+/**
+ * @brief 跨平台的条件变量初始化
+ * @param cond 条件变量指针
+ * @param attr 属性（可为NULL）
+ * @return 成功返回0，失败返回非0
+ */
+int platform_cond_init(pthread_cond_t* cond, const pthread_condattr_t* attr);
+
+/**
+ * @brief 跨平台的条件变量销毁
+ * @param cond 条件变量指针
+ * @return 成功返回0，失败返回非0
+ */
+int platform_cond_destroy(pthread_cond_t* cond);
+
+/**
+ * @brief 跨平台的条件变量等待
+ * @param cond 条件变量指针
+ * @param mutex 关联的互斥锁指针
+ * @return 成功返回0，失败返回非0
+ */
+int platform_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex);
+
+/**
+ * @brief 跨平台的条件变量超时等待
+ * @param cond 条件变量指针
+ * @param mutex 关联的互斥锁指针
+ * @param timeout_ms 超时时间（毫秒）
+ * @return 成功返回0，超时返回正数，失败返回负数
+ */
+int platform_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, int timeout_ms);
+
+/**
+ * @brief 跨平台的条件变量信号
+ * @param cond 条件变量指针
+ * @return 成功返回0，失败返回非0
+ */
+int platform_cond_signal(pthread_cond_t* cond);
+
+/**
+ * @brief 跨平台的条件变量广播
+ * @param cond 条件变量指针
+ * @return 成功返回0，失败返回非0
+ */
+int platform_cond_broadcast(pthread_cond_t* cond);
+
+/**
+ * @brief 跨平台的线程创建
+ * @param thread 线程ID指针
+ * @param attr 线程属性（可为NULL）
+ * @param start_routine 线程函数
+ * @param arg 线程参数
+ * @return 成功返回0，失败返回非0
+ */
+int platform_thread_create(pthread_t* thread, const pthread_attr_t* attr, 
+                          THREAD_RETURN_TYPE (*start_routine)(void*), void* arg);
+
+/**
+ * @brief 跨平台的线程等待
+ * @param thread 线程ID
+ * @param retval 返回值指针（可为NULL）
+ * @return 成功返回0，失败返回非0
+ */
+int platform_thread_join(pthread_t thread, void** retval);
+
+/**
+ * @brief 跨平台的线程分离
+ * @param thread 线程ID
+ * @return 成功返回0，失败返回非0
+ */
+int platform_thread_detach(pthread_t thread);
+
+/**
+ * @brief 获取当前线程ID
+ * @return 当前线程ID
+ */
+pthread_t platform_thread_self(void);
+
+/**
+ * @brief 跨平台的睡眠函数
+ * @param ms 睡眠时间（毫秒）
+ */
+void platform_sleep_ms(int ms);
+
+/**
+ * @brief 获取系统CPU核心数
+ * @return CPU核心数
+ */
+int platform_get_cpu_count(void);
+
+/**
+ * @brief 安装配置重载信号（SIGHUP）处理函数，信号到达时只记录一次重载请求
+ * @return 成功返回0，平台没有该信号（Windows）或安装失败返回-1
+ */
+int platform_reload_signal_install(void);
+
+/**
+ * @brief 取走重载请求：自上次调用以来收到过重载信号返回1并清除，否则返回0
+ */
+int platform_reload_signal_take(void);
+
+// ============================================================================
+// 跨平台读写锁函数声明
+// ============================================================================
+
+/**
+ * @brief 跨平台的读写锁初始化
+ * @param rwlock 读写锁指针
+ * @param attr 属性（可为NULL）
+ * @return 成功返回0，失败返回非0
+ */
+int platform_rwlock_init(pthread_rwlock_t* rwlock, const pthread_rwlockattr_t* attr);
+
+/**
+ * @brief 跨平台的读写锁销毁
+ * @param rwlock 读写锁指针
+ * @return 成功返回0，失败返回非0
+ */
+int platform_rwlock_destroy(pthread_rwlock_t* rwlock);
+
+/**
+ * @brief 跨平台的读写锁读锁定
+ * @param rwlock 读写锁指针
+ * @return 成功返回0，失败返回非0
+ */
+int platform_rwlock_rdlock(pthread_rwlock_t* rwlock);
+
+/**
+ * @brief 跨平台的读写锁写锁定
+ * @param rwlock 读写锁指针
+ * @return 成功返回0，失败返回非0
+ */
+int platform_rwlock_wrlock(pthread_rwlock_t* rwlock);
+
+/**
+ * @brief 跨平台的读写锁解锁
+ * @param rwlock 读写锁指针
+ * @return 成功返回0，失败返回非0
+ */
+int platform_rwlock_unlock(pthread_rwlock_t* rwlock);
+
+#endif // PLATFORM_H
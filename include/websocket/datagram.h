@@ -1,75 +1,100 @@
-#ifndef DATAGRAM_H
-#define DATAGRAM_H
-
-#include "platform/platform.h" // 包含平台抽象层头文件
-#include "debug/debug.h"   // 包含调试相关的头文件
-
-
-
-#define A 1
-#define AAAA 28
-#define CNAME 5
-#define MX 15
-
-// 定义 DNS 查询实体和资源记录实体
-
-typedef struct DNS_QUESTION_ENTITY {
-    char* qname;            // 查询名：域名字符串，格式化为 DNS 查询格式
-    unsigned short qtype;   // 查询类型：指定查询的资源记录类型 (例如，1 表示 A 记录)
-    unsigned short qclass;  // 查询类：通常为 1，表示 IN (Internet)
-} DNS_QUESTION_ENTITY;
-
-typedef struct R_DATA_ENTITY {
-    char* name;            // 域名：资源记录的域名，可能是压缩格式
-    unsigned short type;   // 类型：资源记录的类型 (例如，1 表示 A 记录)
-    unsigned short _class; // 类：通常为 1，表示 IN (Internet)
-    unsigned int ttl;      // 生存时间(Time to Live)：资源记录可以被缓存的秒数
-    unsigned short data_len; // 数据长度：RDATA 字段的长度（以字节为单位）
-    char* rdata;           // RDATA 字段：包含实际的数据，如 IP 地址等
-} R_DATA_ENTITY;
-
-
-typedef struct DNS_ENTITY{
-    unsigned short id;       // 事务ID：一个16位的标识符，用于匹配请求和响应
-    unsigned short flags;    // 标志：一个16位的字段，包含查询/响应、操作码、标志位等信息
-    unsigned short qdcount;  // 问题数：查询区域中的问题数量
-    unsigned short ancount;  // 回答数：回答区域中的资源记录数量
-    unsigned short nscount;  // 授权回答数：授权区域中的名称服务器资源记录数量
-    unsigned short arcount;  // 附加回答数：附加区域中的资源记录数量
-    DNS_QUESTION_ENTITY* questions; // 问题部分的数组
-    R_DATA_ENTITY* answers; // 回答部分的数组
-    R_DATA_ENTITY* authorities; // 权威记录部分的数组
-    R_DATA_ENTITY* additionals; // 附加记录部分的数组
-} DNS_ENTITY;
-
-
-// 函数：计算DNS格式域名的实际长度
-int get_dns_name_length(const char* dns_name);
-
-// 函数：将域名格式化为DNS查询格式 (例如 "www.baidu.com" -> "3www5baidu3com0")
-// DNS协议要求域名以一种特殊的格式表示，每个标签前有一个字节表示该标签的长度。
-void format_domain_name(char* dns, const char* host);
-
-// 函数：将DNS_ENTITY序列化为DNS协议格式的字节流
-int serialize_dns_packet(char* buffer, const DNS_ENTITY* dns_entity);
-
-// 函数：构造一个DNS响应实体
-DNS_ENTITY* build_response(const DNS_ENTITY* request, const char* ip_address);
-
-// 函数：从DNS协议格式的字节流解析为DNS_ENTITY
-DNS_ENTITY* parse_dns_packet(const char* buffer, int buffer_len);
-
-// 函数：释放DNS_ENTITY及其相关资源
-void free_dns_entity(DNS_ENTITY* entity);
-
-// 函数：将DNS_ENTITY转换为格式化的字符串表示
-char* dns_entity_to_string(const DNS_ENTITY* entity);
-
-// 函数：从缓冲区中读取域名（处理DNS压缩）
-int read_name_from_buffer(const char* buffer, int buffer_len, int* offset, char* name, int max_name_len);
-
-// 函数：构造一个表示服务器错误的DNS响应实体
-DNS_ENTITY* build_error_response(const DNS_ENTITY* request);
-
-DNS_ENTITY* build_response(const DNS_ENTITY* request, const char* ip_address);
+#ifndef DATAGRAM_H
+#define DATAGRAM_H
+
+#include "platform/platform.h" // 包含平台抽象层头文件
+#include "debug/debug.h"   // 包含调试相关的头文件
+
+
+
+#define A 1
+#define AAAA 28
+#define CNAME 5
+#define SOA 6
+#define MX 15
+#define OPT 41  // EDNS0伪记录（TTL字段为扩展RCODE和标志位）
+
+#define DNS_HEADER_SIZE 12  // DNS报文头长度（ID、标志和4个计数字段）
+#define DNS_MAX_NAME_WIRE_LEN 255   // 域名线路格式最大长度（含长度字节和根标签）
+#define DNS_MAX_LABEL_LEN 63        // 单个标签最大长度
+#define DNS_NAME_BUF_SIZE 256       // 点分格式域名缓冲区大小（含结尾NUL）
+
+#define DNS_FLAG_TC 0x0200          // 报文头标志：应答被截断
+#define DNS_FLAG_RD 0x0100          // 报文头标志：期望递归
+#define DNS_FLAG_CD 0x0010          // 报文头标志：禁用DNSSEC校验
+#define DNS_RCODE_MASK 0x000F       // 报文头标志中的RCODE
+#define DNS_RCODE_NOERROR 0
+#define DNS_RCODE_NXDOMAIN 3
+
+#define DNS_SOA_FIXED_SIZE 20       // SOA记录RDATA中两个域名之后的定长部分（SERIAL到MINIMUM共5个32位字段）
+#define DNS_OPT_RR_SIZE 11          // 不带选项的OPT伪记录长度（根名、类型、类、TTL、RDLENGTH）
+#define DNS_EDNS_UDP_PAYLOAD 1232   // 自行发起的查询声明的UDP载荷上限（避免IP分片的常用取值）
+
+#define DNS_VIEW_MAX_QUESTIONS 4    // 报文视图最多索引的问题数
+#define DNS_VIEW_MAX_RECORDS 64     // 报文视图最多索引的资源记录数（回答、授权、附加合计）
+
+// 报文视图：一次校验后得到的各部分在原始报文中的偏移，不拷贝、不分配内存
+
+typedef struct {
+    unsigned short name_offset;   // 查询名在报文中的偏移（需要时用dns_msg_view_read_name解码）
+    unsigned short qtype;         // 查询类型
+    unsigned short qclass;        // 查询类
+} dns_question_view_t;
+
+typedef struct {
+    unsigned short name_offset;   // 所有者域名在报文中的偏移
+    unsigned short type;          // 记录类型
+    unsigned short rclass;        // 记录类
+    unsigned short rdlength;      // RDATA长度
+    unsigned int ttl;             // 生存时间
+    unsigned short ttl_offset;    // TTL字段在报文中的偏移（原地改写TTL时使用）
+    unsigned short rdata_offset;  // RDATA在报文中的偏移
+} dns_rr_view_t;
+
+typedef struct {
+    const char* packet;      // 原始报文（视图不持有，生命周期由调用方保证）
+    int packet_len;          // 报文长度
+    unsigned short id;       // 事务ID
+    unsigned short flags;    // 标志
+    unsigned short qdcount;  // 头部声明的问题数
+    unsigned short ancount;  // 头部声明的回答数
+    unsigned short nscount;  // 头部声明的授权记录数
+    unsigned short arcount;  // 头部声明的附加记录数
+    int question_count;      // 已索引的问题数
+    int record_count;        // 已索引的资源记录数（按回答、授权、附加顺序排列）
+    int records_parsed;      // 资源记录部分是否已校验和索引（只解析问题时为0）
+    int truncated;           // 问题或记录数超过视图容量，超出部分已校验但未索引
+    int end_offset;          // 已解析部分之后的偏移
+    dns_question_view_t questions[DNS_VIEW_MAX_QUESTIONS];
+    dns_rr_view_t records[DNS_VIEW_MAX_RECORDS];
+} dns_msg_view_t;
+
+
+// 函数：单遍校验整个报文并填充报文视图（不分配内存）
+// 检查各字段及RDATA不越界、标签长度、域名总长度，压缩指针必须严格向前指向更早的位置（排除指针环）
+// 成功返回MYSUCCESS，报文格式错误返回MYERROR
+int dns_msg_view_parse(dns_msg_view_t* view, const char* packet, int packet_len);
+
+// 函数：只校验报文头和问题部分（转发查询和查缓存只需要这些），资源记录留待dns_msg_view_parse_records按需解析
+int dns_msg_view_parse_question(dns_msg_view_t* view, const char* packet, int packet_len);
+
+// 函数：在只解析了问题部分的视图上继续校验并索引回答、授权、附加记录（已解析时直接返回成功）
+int dns_msg_view_parse_records(dns_msg_view_t* view);
+
+// 函数：按需将视图中某个偏移处的域名解码为点分格式，返回域名长度，失败返回-1
+// 标签内含'.'或NUL的域名无法用点分格式无歧义地表示，同样返回-1
+int dns_msg_view_read_name(const dns_msg_view_t* view, int name_offset, char* name, int name_size);
+
+// 函数：将视图中某个偏移处的域名展开为不含压缩指针的线路格式（wire容量至少DNS_MAX_NAME_WIRE_LEN）
+// 标签按原始字节输出，不做转义；返回线路格式长度（含根标签），失败返回-1
+int dns_msg_view_read_wire_name(const dns_msg_view_t* view, int name_offset, unsigned char* wire);
+
+// 函数：用预编译的回答记录构造响应：报文头 + 请求的第一个问题（原样拷贝）+ 回答记录
+// answer中的所有者名可用0xC00C指向查询名；成功返回报文长度，请求无效或缓冲区不足返回-1
+int build_template_response(const dns_msg_view_t* request, unsigned short flags, unsigned short ancount,
+                            const char* answer, int answer_len, char* buffer, int buffer_size);
+
+// 函数：在报文末尾追加一条不带选项的OPT伪记录（声明UDP载荷上限）并将ARCOUNT加一
+// 成功返回新的报文长度，缓冲区不足返回-1
+int dns_append_opt_record(char* packet, int packet_len, int buffer_size, unsigned short udp_payload);
+
 #endif // DATAGRAM_H
\ No newline at end of file
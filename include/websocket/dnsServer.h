@@ -1,28 +1,85 @@
-#ifndef DNSSERVER_H
-#define DNSSERVER_H
-
-#include "websocket/websocket.h" // 包含自定义的 WebSocket 头文件
-#include "websocket/datagram.h" // 包含自定义的数据报头文件，定义了 DNS 报文相关结构体和函数
-#include "idmapping/idmapping.h" // 包含 ID 映射相关的头文件
-#include "debug/debug.h"
-#include <time.h>
-
-
-// DNS代理服务器函数
-int start_dns_proxy_server();
-
-// 多线程版本的DNS代理服务器函数
-int start_dns_proxy_server_threaded();
-
-int forward_to_upstream_dns(char* request_buffer, int request_len, char* response_buffer, int* response_len);
-int handle_dns_request(char* request_buffer, int request_len, struct sockaddr_in* client_addr, int client_addr_len, SOCKET server_socket);
-
-// 新增并发处理相关函数
-int handle_receive();
-
-// 多线程版本的接收处理函数
-int handle_receive_threaded();
-void handle_client_requests(DNS_ENTITY* dns_entity,struct sockaddr_in source_addr, int source_addr_len,int receive_len);
-void handle_upstream_responses(DNS_ENTITY* dns_entity,struct sockaddr_in source_addr, int source_addr_len, int receive_len);
-int forward_request_to_upstream(char* request_buffer, int request_len) ;
+#ifndef DNSSERVER_H
+#define DNSSERVER_H
+
+#include "websocket/websocket.h" // 包含自定义的 WebSocket 头文件
+#include "websocket/datagram.h" // 包含自定义的数据报头文件，定义了 DNS 报文相关结构体和函数
+#include "idmapping/idmapping.h" // 包含 ID 映射相关的头文件
+#include "debug/debug.h"
+#include <time.h>
+
+// 批量接收相关定义
+#define RECV_BATCH_MAX PLATFORM_DGRAM_BATCH_MAX  // 单次recvmmsg最大数据报数
+#define DEFAULT_RECV_BATCH_SIZE 32               // 默认批量接收大小
+
+// 事件循环相关定义
+#define HOUSEKEEPING_INTERVAL_MS 1000            // 维护定时器周期（映射清理、状态打印）
+
+// 监听分片相关定义（SO_REUSEPORT）
+#define MAX_LISTEN_SHARDS 32                     // 最大监听分片数
+#define DEFAULT_LISTEN_SHARDS 1                  // 默认监听分片数（单套接字）
+
+// I/O线程快速路径（本地表/缓存命中在收包线程内直接应答）
+#define DEFAULT_INLINE_FAST_PATH 0               // 默认关闭，所有请求经线程池处理
+
+// 多线程DNS代理服务器运行配置
+typedef struct {
+    int recv_batch_size;    // I/O线程每次唤醒最多接收的数据报数（recvmmsg）
+    int send_batch_size;    // 工作线程批量发送响应的大小（sendmmsg，1表示逐个发送）
+    int listen_shards;      // SO_REUSEPORT监听分片数，每个分片一个套接字和一个I/O线程（0表示按CPU核心数）
+    int inline_fast_path;   // 是否在I/O线程内直接应答本地表和缓存命中（未命中才提交线程池）
+    const char* cache_config_file; // 缓存容量配置文件，收到SIGHUP时重新读取（NULL表示不处理该信号）
+} dns_server_config_t;
+
+// 接收端点：监听分片（绑定到DNS端口的SO_REUSEPORT套接字及其专属I/O线程），
+// 或上游专用套接字（挂在某个监听分片的事件循环上，共用该分片的接收缓冲区）
+typedef struct {
+    int index;                                      // 分片索引（0号分片运行在主线程）或上游服务器索引
+    int is_upstream;                                // 是否为上游专用套接字（收到的数据报均为上游响应）
+    SOCKET sock;                                    // 分片监听套接字或上游专用套接字
+    pthread_t thread_id;                            // 分片I/O线程（0号分片不创建）
+    int thread_started;                             // I/O线程是否已创建
+    platform_event_loop_t event_loop;               // 分片事件循环
+
+    // 批量接收缓冲区（recvmmsg）
+    platform_dgram_t recv_dgrams[RECV_BATCH_MAX];
+    char* recv_storage;                             // 仅监听分片持有，上游端点为NULL
+    int recv_batch_size;
+
+    // I/O线程快速路径（仅监听分片使用）
+    int inline_fast_path;                           // 是否在收包线程内直接应答命中请求
+    dns_send_batch_t send_batch;                    // 快速路径响应的批量发送缓冲区（未启用时capacity为0）
+
+    // 分片统计（仅由分片I/O线程写入）
+    unsigned long recv_batch_count;                 // 非空接收批次数
+    unsigned long recv_packet_count;                // 接收数据包数
+    unsigned long client_requests;                  // 客户端请求数
+    unsigned long upstream_responses;               // 上游响应数
+    unsigned long submit_failures;                  // 任务提交失败数
+    unsigned long inline_answers;                   // 快速路径直接应答数
+} dns_listen_shard_t;
+
+/**
+ * @brief 使用默认值填充服务器配置
+ * @param config 配置结构体指针
+ */
+void dns_server_config_init(dns_server_config_t* config);
+
+// DNS代理服务器函数
+int start_dns_proxy_server();
+
+// 多线程版本的DNS代理服务器函数
+int start_dns_proxy_server_threaded(const dns_server_config_t* config);
+
+int forward_to_upstream_dns(char* request_buffer, int request_len, char* response_buffer, int* response_len);
+int handle_dns_request(char* request_buffer, int request_len, struct sockaddr_in* client_addr, int client_addr_len, SOCKET server_socket);
+
+// 新增并发处理相关函数
+int handle_receive();
+
+// 多线程版本的接收处理函数
+int handle_receive_threaded(dns_listen_shard_t* shard);
+int handle_client_requests(SOCKET sock, char* packet, int packet_len, struct sockaddr_in source_addr, int source_addr_len);
+void forward_client_request(SOCKET sock, char* packet, int packet_len, struct sockaddr_in client_addr, int client_addr_len);
+void handle_upstream_responses(SOCKET sock, char* packet, int response_len, struct sockaddr_in source_addr, int source_addr_len);
+int forward_request_to_upstream(char* request_buffer, int request_len) ;
 #endif // DNSSERVER_H
\ No newline at end of file
@@ -1,49 +1,75 @@
-#ifndef WEBSOCKET_H
-#define WEBSOCKET_H
-
-//头文件
-#include "platform/platform.h" // 包含平台抽象层头文件
-#include "debug/debug.h"   // 包含调试相关的头文件
-#include "websocket/datagram.h" // 包含自定义的数据报头文件，定义了 DNS 报文相关结构体和函数
-#include <stdlib.h>  // 为rand()和srand()函数
-#include <time.h>    // 为time()函数
-#include <string.h>  // 为strcpy()函数
-
-//定义宏
-#define MYSUCCESS 1
-#define MYERROR 0
-#define DNS_SERVER "10.3.9.6"  // 定义 Google 的公共 DNS 服务器地址
-#define DNS_PORT 53           // 定义 DNS 服务使用的标准端口号
-#define BUF_SIZE 65536        // 定义缓冲区大小，用于存储发送和接收的数据
-
-// DNS上游服务器IP池相关定义
-#define MAX_UPSTREAM_SERVERS 10    // 最大上游服务器数量
-
-// 优化后的DNS上游服务器池结构体 - 直接存储sockaddr_in
-typedef struct {
-    struct sockaddr_in servers[MAX_UPSTREAM_SERVERS];  // 直接存储完整的地址结构
-    int server_count;                                   // 当前服务器数量
-    int current_index;                                  // 当前使用的服务器索引（用于轮询）
-} upstream_dns_pool_t;
-
-//全局变量声明
-extern struct sockaddr_in upstream_addr;
-extern upstream_dns_pool_t g_upstream_pool; // 上游DNS服务器池
-
-
-
-// DNS上游服务器池管理函数
-int upstream_pool_init(upstream_dns_pool_t* pool, const char* config_file);
-int upstream_pool_add_server(upstream_dns_pool_t* pool, const char* ip_address);
-int upstream_pool_load_from_file(upstream_dns_pool_t* pool, const char* config_file);
-struct sockaddr_in* upstream_pool_get_random_server(upstream_dns_pool_t* pool);
-struct sockaddr_in* upstream_pool_get_next_server(upstream_dns_pool_t* pool);  // 新增：轮询获取服务器
-void upstream_pool_destroy(upstream_dns_pool_t* pool);
-int upstream_pool_contains_server(upstream_dns_pool_t* pool, const char* ip_address);
-int upstream_pool_get_server_count(upstream_dns_pool_t* pool);  // 新增：获取服务器数量
-void upstream_pool_print_status(upstream_dns_pool_t* pool);     // 新增：打印池状态
-
-int sendDnsPacket(SOCKET sock,struct sockaddr_in address,const DNS_ENTITY* dns_entity);
-int sendDnsPacketToRandomUpstream(SOCKET sock, const DNS_ENTITY* dns_entity);
-int sendDnsPacketToNextUpstream(SOCKET sock, const DNS_ENTITY* dns_entity);  // 新增：轮询发送
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+//头文件
+#include "platform/platform.h" // 包含平台抽象层头文件
+#include "debug/debug.h"   // 包含调试相关的头文件
+#include "websocket/datagram.h" // 包含自定义的数据报头文件，定义了 DNS 报文相关结构体和函数
+#include <stdlib.h>  // 为rand()和srand()函数
+#include <time.h>    // 为time()函数
+#include <string.h>  // 为strcpy()函数
+
+//定义宏
+#define MYSUCCESS 1
+#define MYERROR 0
+#define DNS_SERVER "10.3.9.6"  // 定义 Google 的公共 DNS 服务器地址
+#define DNS_PORT 53           // 定义 DNS 服务使用的标准端口号
+#define BUF_SIZE 65536        // 定义缓冲区大小，用于存储发送和接收的数据
+
+// DNS上游服务器IP池相关定义
+#define MAX_UPSTREAM_SERVERS 10    // 最大上游服务器数量
+
+// 优化后的DNS上游服务器池结构体 - 直接存储sockaddr_in
+typedef struct {
+    struct sockaddr_in servers[MAX_UPSTREAM_SERVERS];  // 直接存储完整的地址结构
+    SOCKET sockets[MAX_UPSTREAM_SERVERS];               // 每个上游专用的已连接UDP套接字（内核分配随机源端口）
+    int server_count;                                   // 当前服务器数量
+    unsigned int next_index;                            // 轮询计数（原子递增，对server_count取模得到服务器索引）
+} upstream_dns_pool_t;
+
+// 批量发送相关定义
+#define SEND_BATCH_MAX PLATFORM_DGRAM_BATCH_MAX  // 单个批次最大数据包数
+#define DEFAULT_SEND_BATCH_SIZE 16               // 默认批量发送大小
+#define SEND_BATCH_SLOT_SIZE 4096                // 批次槽位大小，超过此长度的响应直接发送
+
+// 线程私有的批量发送缓冲区：sendDnsRawPacket在当前线程绑定了批次时只入批，由持有者统一刷新
+typedef struct {
+    char* storage;                                  // 槽位存储区（capacity * SEND_BATCH_SLOT_SIZE）
+    platform_dgram_t dgrams[SEND_BATCH_MAX];        // 待发送数据报
+    SOCKET sockets[SEND_BATCH_MAX];                 // 每个数据报对应的发送套接字
+    int count;                                      // 当前待发送数量
+    int capacity;                                   // 批次容量
+    unsigned long flush_count;                      // 刷新次数（sendmmsg调用批次数）
+    unsigned long packet_count;                     // 经批次发出的数据包总数
+    unsigned long drop_count;                       // 发送缓冲区已满或发送出错而丢弃的数据包数
+} dns_send_batch_t;
+
+//全局变量声明
+extern struct sockaddr_in upstream_addr;
+extern upstream_dns_pool_t g_upstream_pool; // 上游DNS服务器池
+
+
+
+// DNS上游服务器池管理函数
+int upstream_pool_init(upstream_dns_pool_t* pool, const char* config_file);
+int upstream_pool_add_server(upstream_dns_pool_t* pool, const char* ip_address);
+int upstream_pool_load_from_file(upstream_dns_pool_t* pool, const char* config_file);
+struct sockaddr_in* upstream_pool_get_random_server(upstream_dns_pool_t* pool);
+struct sockaddr_in* upstream_pool_get_next_server(upstream_dns_pool_t* pool);  // 新增：轮询获取服务器
+void upstream_pool_destroy(upstream_dns_pool_t* pool);
+int upstream_pool_contains_server(upstream_dns_pool_t* pool, const char* ip_address);
+int upstream_pool_get_server_count(upstream_dns_pool_t* pool);  // 新增：获取服务器数量
+void upstream_pool_print_status(upstream_dns_pool_t* pool);     // 新增：打印池状态
+int upstream_pool_open_sockets(upstream_dns_pool_t* pool);      // 为每个上游创建已连接的非阻塞UDP套接字
+void upstream_pool_close_sockets(upstream_dns_pool_t* pool);    // 关闭所有上游套接字
+
+// 批量发送管理函数
+int send_batch_init(dns_send_batch_t* batch, int capacity);
+void send_batch_destroy(dns_send_batch_t* batch);
+int send_batch_flush(dns_send_batch_t* batch);
+void send_batch_bind_current_thread(dns_send_batch_t* batch);  // 传入NULL解除绑定
+dns_send_batch_t* send_batch_get_current_thread(void);
+
+int sendDnsRawPacket(SOCKET sock, const struct sockaddr_in* address, const char* buf, int packet_len);  // 发送已编码的报文（不解析、不重新编码；address为NULL表示已连接套接字）
+int sendDnsRawPacketToNextUpstream(SOCKET sock, const char* buf, int packet_len);  // 轮询发送已编码的报文
 #endif // WEBSOCKET_H
\ No newline at end of file
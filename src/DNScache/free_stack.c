@@ -30,6 +30,32 @@ int free_stack_init(free_stack_t* stack, int capacity) {
     return 0;
 }
 
+/**
+ * @brief 扩大栈容量，新增的索引全部入栈
+ */
+int free_stack_grow(free_stack_t* stack, int new_capacity) {
+    if (!stack || !stack->stack || new_capacity <= stack->capacity) {
+        log_error("空闲栈扩容参数错误");
+        return -1;
+    }
+    
+    int* grown = (int*)realloc(stack->stack, new_capacity * sizeof(int));
+    if (!grown) {
+        log_error("空闲栈扩容内存分配失败，容量: %d", new_capacity);
+        return -1;
+    }
+    
+    // 新索引压在现有空闲索引之上，优先被分配
+    for (int i = stack->capacity; i < new_capacity; i++) {
+        grown[++stack->top] = i;
+    }
+    stack->stack = grown;
+    stack->capacity = new_capacity;
+    
+    log_debug("空闲栈扩容完成，容量: %d", new_capacity);
+    return 0;
+}
+
 /**
  * @brief 销毁空闲条目栈
  */
@@ -0,0 +1,248 @@
+#ifdef _WIN32
+#define _CRT_RAND_S  // 启用rand_s
+#endif
+#include "DNScache/name_hash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NAME_HASH_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX2按函数属性单独编译，运行时检测CPU后才调用
+#if defined(NAME_HASH_HAVE_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NAME_HASH_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#define NAME_HASH_ONES 0x0101010101010101ULL
+#define NAME_HASH_HIGHS 0x8080808080808080ULL
+
+// 进程级哈希密钥：启动时由name_hash_init随机生成，未初始化时使用固定默认值
+static uint64_t g_name_hash_secret[2] = {0xA0761D6478BD642FULL, 0xE7037ED1A0B428DBULL};
+
+// ============================================================================
+// 哈希吸收与收尾：各实现都按8字节字序吸收，结果与分块宽度无关
+// ============================================================================
+
+/**
+ * @brief 64x64→128位乘法，返回高低两半的异或（wyhash的mum混合）
+ */
+static uint64_t hash_mum(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ unsigned __int128 r = (unsigned __int128)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t hi;
+    uint64_t lo = _umul128(a, b, &hi);
+    return lo ^ hi;
+#else
+    uint64_t a_hi = a >> 32, a_lo = (uint32_t)a;
+    uint64_t b_hi = b >> 32, b_lo = (uint32_t)b;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+    uint64_t lo = (cross << 32) | (uint32_t)lo_lo;
+    uint64_t hi = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    return lo ^ hi;
+#endif
+}
+
+// 每个字与密钥异或后再与状态相乘，不知道密钥就无法构造与种子无关的碰撞
+static uint64_t hash_absorb(uint64_t h, uint64_t word) {
+    return hash_mum(word ^ g_name_hash_secret[0], h ^ g_name_hash_secret[1]);
+}
+
+static uint64_t hash_finish(uint64_t h, size_t len) {
+    return hash_mum(h ^ g_name_hash_secret[0], (uint64_t)len ^ g_name_hash_secret[1]);
+}
+
+/**
+ * @brief 从操作系统获取随机字节
+ * @return 成功返回1，失败返回0
+ */
+static int read_os_random(void* buf, size_t len) {
+#ifdef _WIN32
+    unsigned char* out = (unsigned char*)buf;
+    for (size_t i = 0; i < len; i += sizeof(unsigned int)) {
+        unsigned int r;
+        if (rand_s(&r) != 0) return 0;
+        size_t n = len - i < sizeof(r) ? len - i : sizeof(r);
+        memcpy(out + i, &r, n);
+    }
+    return 1;
+#else
+    FILE* f = fopen("/dev/urandom", "rb");
+    if (!f) return 0;
+    size_t got = fread(buf, 1, len, f);
+    fclose(f);
+    return got == len;
+#endif
+}
+
+// ============================================================================
+// 标量实现：SWAR按8字节折叠
+// ============================================================================
+
+/**
+ * @brief 把一个字中的8个字节的'A'..'Z'转为小写（非ASCII字节不变）
+ */
+static uint64_t fold_word(uint64_t word) {
+    uint64_t heptets = word & ~NAME_HASH_HIGHS;
+    uint64_t above_z = heptets + (0x7F - 'Z') * NAME_HASH_ONES;  // 大于'Z'时最高位置1
+    uint64_t from_a = heptets + (0x80 - 'A') * NAME_HASH_ONES;   // 不小于'A'时最高位置1
+    uint64_t is_upper = (from_a ^ above_z) & ~word & NAME_HASH_HIGHS;
+    return word | (is_upper >> 2);  // 0x80 >> 2 = 0x20
+}
+
+static uint64_t fold_hash_scalar(const char* name, size_t len, char* out, uint64_t h) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, name + i, 8);
+        word = fold_word(word);
+        memcpy(out + i, &word, 8);
+        h = hash_absorb(h, word);
+    }
+
+    size_t rest = len - i;
+    if (rest > 0) {
+        uint64_t word = 0;
+        memcpy(&word, name + i, rest);
+        word = fold_word(word);
+        memcpy(out + i, &word, rest);
+        h = hash_absorb(h, word);
+    }
+    return h;
+}
+
+// ============================================================================
+// SSE2 / AVX2实现：按16/32字节折叠，余下部分交给标量实现
+// ============================================================================
+
+#ifdef NAME_HASH_HAVE_SSE2
+static uint64_t fold_hash_sse2(const char* name, size_t len, char* out, uint64_t h, size_t* done) {
+    const __m128i before_a = _mm_set1_epi8('A' - 1);
+    const __m128i after_z = _mm_set1_epi8('Z' + 1);
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(name + i));
+        // 有符号比较：0x80以上的字节为负数，不会落入'A'..'Z'
+        __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, before_a), _mm_cmplt_epi8(v, after_z));
+        v = _mm_or_si128(v, _mm_and_si128(upper, case_bit));
+        _mm_storeu_si128((__m128i*)(out + i), v);
+
+        uint64_t words[2];
+        memcpy(words, out + i, 16);
+        h = hash_absorb(h, words[0]);
+        h = hash_absorb(h, words[1]);
+    }
+    *done = i;
+    return h;
+}
+#endif
+
+#ifdef NAME_HASH_HAVE_AVX2
+__attribute__((target("avx2")))
+static uint64_t fold_hash_avx2(const char* name, size_t len, char* out, uint64_t h, size_t* done) {
+    const __m256i before_a = _mm256_set1_epi8('A' - 1);
+    const __m256i after_z = _mm256_set1_epi8('Z' + 1);
+    const __m256i case_bit = _mm256_set1_epi8(0x20);
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(name + i));
+        __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, before_a), _mm256_cmpgt_epi8(after_z, v));
+        v = _mm256_or_si256(v, _mm256_and_si256(upper, case_bit));
+        _mm256_storeu_si256((__m256i*)(out + i), v);
+
+        uint64_t words[4];
+        memcpy(words, out + i, 32);
+        h = hash_absorb(h, words[0]);
+        h = hash_absorb(h, words[1]);
+        h = hash_absorb(h, words[2]);
+        h = hash_absorb(h, words[3]);
+    }
+    *done = i;
+    return h;
+}
+#endif
+
+int name_hash_init(void) {
+    uint64_t secret[2];
+    int from_os = read_os_random(secret, sizeof(secret));
+    if (!from_os) {
+        // 退化为时间和地址混合，仍保证每次启动不同
+        uint64_t stack_marker = (uint64_t)(uintptr_t)&secret;
+        secret[0] = hash_mum((uint64_t)time(NULL) ^ g_name_hash_secret[0], (uint64_t)clock() ^ g_name_hash_secret[1]);
+        secret[1] = hash_mum(stack_marker ^ g_name_hash_secret[1], secret[0] ^ g_name_hash_secret[0]);
+    }
+    // 保持奇数，避免乘法因子退化
+    g_name_hash_secret[0] = secret[0] | 1;
+    g_name_hash_secret[1] = secret[1] | 1;
+    return from_os;
+}
+
+int name_hash_kernel_supported(name_hash_kernel_t kernel) {
+    switch (kernel) {
+        case NAME_HASH_KERNEL_SCALAR:
+            return 1;
+#ifdef NAME_HASH_HAVE_SSE2
+        case NAME_HASH_KERNEL_SSE2:
+            return 1;
+#endif
+#ifdef NAME_HASH_HAVE_AVX2
+        case NAME_HASH_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+        default:
+            return 0;
+    }
+}
+
+unsigned long long name_fold_hash_kernel(name_hash_kernel_t kernel, const char* name, size_t len, char* out,
+                                         unsigned long long seed) {
+    uint64_t h = hash_mum(seed ^ g_name_hash_secret[0], g_name_hash_secret[1]);
+    size_t done = 0;
+
+#ifdef NAME_HASH_HAVE_AVX2
+    if (kernel >= NAME_HASH_KERNEL_AVX2 && len >= 32 && __builtin_cpu_supports("avx2")) {
+        h = fold_hash_avx2(name, len, out, h, &done);
+    }
+#endif
+#ifdef NAME_HASH_HAVE_SSE2
+    if (kernel >= NAME_HASH_KERNEL_SSE2 && len - done >= 16) {
+        size_t sse_done;
+        h = fold_hash_sse2(name + done, len - done, out + done, h, &sse_done);
+        done += sse_done;
+    }
+#endif
+
+    h = fold_hash_scalar(name + done, len - done, out + done, h);
+    return hash_finish(h, len);
+}
+
+unsigned long long name_fold_hash(const char* name, size_t len, char* out, unsigned long long seed) {
+    return name_fold_hash_kernel(NAME_HASH_KERNEL_AVX2, name, len, out, seed);
+}
+
+const char* name_hash_kernel_name(void) {
+#ifdef NAME_HASH_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2")) return "avx2";
+#endif
+#ifdef NAME_HASH_HAVE_SSE2
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
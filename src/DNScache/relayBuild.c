@@ -1,921 +1,1781 @@
-#include "DNScache/relayBuild.h"
-#include "DNScache/free_stack.h"
-#include "websocket/websocket.h"
-#include "platform/platform.h"
-#include "websocket/datagram.h"
-#include <stdlib.h>
-#include <stdio.h>
-
-// ============================================================================
-// 全局变量
-// ============================================================================
-
-static domain_table_t g_domain_table;      // 全局本地域名表
-static dns_lru_cache_t g_dns_cache;        // 全局LRU缓存
-
-// ============================================================================
-// 哈希函数实现
-// ============================================================================
-
-/**
- * @brief 缓存键哈希函数
- * 使用djb2算法计算缓存键的哈希值
- */
-unsigned int hash_key(const char* key) {
-    if (!key) return 0;
-    
-    unsigned int hash = 5381;
-    int c;
-    
-    // 转换为小写并计算哈希
-    while ((c = *key++)) {
-        if (c >= 'A' && c <= 'Z') {
-            c += 32; // 转换为小写
-        }
-        hash = ((hash << 5) + hash) + c; // hash * 33 + c
-    }
-    
-    return hash;
-}
-
-/**
- * @brief 域名哈希函数（用于域名表）
- * 使用djb2算法计算域名的哈希值
- */
-unsigned int hash_domain(const char* domain) {
-    if (!domain) return 0;
-    
-    unsigned int hash = 5381;
-    int c;
-    
-    // 转换为小写并计算哈希
-    while ((c = *domain++)) {
-        if (c >= 'A' && c <= 'Z') {
-            c += 32; // 转换为小写
-        }
-        hash = ((hash << 5) + hash) + c; // hash * 33 + c
-    }
-    
-    return hash;
-}
-
-/**
- * @brief 根据缓存键获取其所属的缓存段
- */
-dns_cache_segment_t* get_cache_segment(const char* key) {
-    if (!key) return NULL;
-    
-    unsigned int hash = hash_key(key);
-    // 使用位运算快速取模，前提是段数量为2的幂
-    return &g_dns_cache.segments[hash & (DNS_CACHE_NUM_SEGMENTS - 1)];
-}
-
-/**
- * @brief 根据域名获取其所属的域名表分段
- */
-domain_table_segment_t* get_domain_table_segment(const char* domain) {
-    if (!domain) return NULL;
-    
-    unsigned int hash = hash_domain(domain);
-    // 使用位运算快速取模，前提是段数量为2的幂
-    return &g_domain_table.segments[hash & (DOMAIN_TABLE_NUM_SEGMENTS - 1)];
-}
-
-// ============================================================================
-// 本地域名表实现
-// ============================================================================
-
-/**
- * @brief 初始化本地域名表（分段版本）
- */
-int domain_table_init() {
-    // 初始化所有分段
-    for (int i = 0; i < DOMAIN_TABLE_NUM_SEGMENTS; i++) {
-        // 初始化读写锁
-        if (platform_rwlock_init(&g_domain_table.segments[i].rwlock, NULL) != 0) {
-            log_error("域名表分段读写锁初始化失败: %d", i);
-            // 清理已初始化的锁
-            for (int j = 0; j < i; j++) {
-                platform_rwlock_destroy(&g_domain_table.segments[j].rwlock);
-            }
-            return MYERROR;
-        }
-        
-        // 清零该分段的哈希桶
-        int buckets_per_segment = DOMAIN_TABLE_HASH_SIZE / DOMAIN_TABLE_NUM_SEGMENTS;
-        for (int k = 0; k < buckets_per_segment; k++) {
-            g_domain_table.segments[i].hash_buckets[k] = NULL;
-        }
-        
-        g_domain_table.segments[i].entry_count = 0;
-    }
-    
-    g_domain_table.total_entry_count = 0;
-    g_domain_table.last_load_time = 0;
-    
-    log_info("本地域名表分段初始化完成，分段数: %d", DOMAIN_TABLE_NUM_SEGMENTS);
-    return MYSUCCESS;
-}
-
-/**
- * @brief 从文件加载域名表（分段版本，支持IPv4和IPv6）
- */
-int domain_table_load_from_file(const char* filename) {
-    if (!filename) return MYERROR;
-    
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        log_error("无法打开域名表文件: %s", filename);
-        return MYERROR;
-    }
-    
-    char line[512];
-    int loaded_count = 0;
-    
-    while (fgets(line, sizeof(line), file)) {
-        // 移除换行符
-        line[strcspn(line, "\r\n")] = '\0';
-        
-        // 跳过空行和注释
-        if (line[0] == '\0' || line[0] == '#') continue;
-        
-        // 解析 IP 域名 格式
-        char ip[MAX_IP_LENGTH];
-        char domain[MAX_DOMAIN_LENGTH];
-        
-        if (sscanf(line, "%s %s", ip, domain) != 2) {
-            log_warn("跳过无效行: %s", line);
-            continue;
-        }
-        
-        // 判断IP地址类型
-        unsigned short ip_type;
-        int is_blocked = 0;
-        if (strchr(ip, ':') != NULL) {
-            // IPv6地址
-            ip_type = AAAA;
-            is_blocked = (strcmp(ip, "::") == 0);
-        } else {
-            // IPv4地址
-            ip_type = A;
-            is_blocked = (strcmp(ip, "0.0.0.0") == 0);
-        }
-        
-        // 获取对应的分段
-        domain_table_segment_t* segment = get_domain_table_segment(domain);
-        if (!segment) {
-            continue;
-        }
-        
-        // 获取写锁并查找或创建域名条目
-        platform_rwlock_wrlock(&segment->rwlock);
-        
-        // 计算在分段内的哈希索引
-        unsigned int global_hash = hash_domain(domain);
-        int buckets_per_segment = DOMAIN_TABLE_HASH_SIZE / DOMAIN_TABLE_NUM_SEGMENTS;
-        unsigned int bucket_index = (global_hash / DOMAIN_TABLE_NUM_SEGMENTS) % buckets_per_segment;
-        
-        // 查找现有的域名条目
-        domain_entry_t* domain_entry = NULL;
-        domain_entry_t* current = segment->hash_buckets[bucket_index];
-        while (current) {
-            if (strcasecmp(current->domain, domain) == 0) {
-                domain_entry = current;
-                break;
-            }
-            current = current->next;
-        }
-        
-        // 如果没有找到域名条目，创建新的
-        if (!domain_entry) {
-            domain_entry = (domain_entry_t*)malloc(sizeof(domain_entry_t));
-            if (!domain_entry) {
-                log_error("内存分配失败");
-                platform_rwlock_unlock(&segment->rwlock);
-                continue;
-            }
-            
-            // 初始化域名条目
-            strncpy(domain_entry->domain, domain, MAX_DOMAIN_LENGTH - 1);
-            domain_entry->domain[MAX_DOMAIN_LENGTH - 1] = '\0';
-            domain_entry->ips = NULL;
-            domain_entry->is_blocked = 0;
-            
-            // 插入到链表头部
-            domain_entry->next = segment->hash_buckets[bucket_index];
-            segment->hash_buckets[bucket_index] = domain_entry;
-            segment->entry_count++;
-        }
-        
-        // 创建IP地址条目
-        ip_address_entry_t* ip_entry = (ip_address_entry_t*)malloc(sizeof(ip_address_entry_t));
-        if (!ip_entry) {
-            log_error("IP地址条目内存分配失败");
-            platform_rwlock_unlock(&segment->rwlock);
-            continue;
-        }
-        
-        ip_entry->type = ip_type;
-        strncpy(ip_entry->ip, ip, MAX_IP_LENGTH - 1);
-        ip_entry->ip[MAX_IP_LENGTH - 1] = '\0';
-        
-        // 将IP条目插入到域名条目的IP链表头部
-        ip_entry->next = domain_entry->ips;
-        domain_entry->ips = ip_entry;
-        
-        // 如果有任何一个IP地址被阻止，则整个域名被标记为阻止
-        if (is_blocked) {
-            domain_entry->is_blocked = 1;
-        }
-        
-        platform_rwlock_unlock(&segment->rwlock);
-        loaded_count++;
-    }
-    
-    fclose(file);
-    g_domain_table.total_entry_count = loaded_count;
-    g_domain_table.last_load_time = time(NULL);
-    
-    log_info("成功加载 %d 个IP地址条目到分段域名表", loaded_count);
-    return MYSUCCESS;
-}
-
-/**
- * @brief 查找域名表条目（分段读写锁，支持查询类型）
- */
-ip_address_entry_t* domain_table_lookup(const char* domain, unsigned short qtype) {
-    if (!domain) return NULL;
-    
-    // 获取对应的分段
-    domain_table_segment_t* segment = get_domain_table_segment(domain);
-    if (!segment) return NULL;
-    
-    ip_address_entry_t* result = NULL;
-    
-    // 获取读锁（多线程可以并发读取不同分段）
-    platform_rwlock_rdlock(&segment->rwlock);
-    
-    // 计算在分段内的哈希索引
-    unsigned int global_hash = hash_domain(domain);
-    int buckets_per_segment = DOMAIN_TABLE_HASH_SIZE / DOMAIN_TABLE_NUM_SEGMENTS;
-    unsigned int bucket_index = (global_hash / DOMAIN_TABLE_NUM_SEGMENTS) % buckets_per_segment;
-    
-    // 在分段的哈希桶中查找域名条目
-    domain_entry_t* domain_entry = segment->hash_buckets[bucket_index];
-    while (domain_entry) {
-        // 不区分大小写比较域名
-        if (strcasecmp(domain_entry->domain, domain) == 0) {
-            // 找到域名条目，现在在其IP链表中查找匹配的查询类型
-            ip_address_entry_t* ip_entry = domain_entry->ips;
-            while (ip_entry) {
-                if (ip_entry->type == qtype) {
-                    result = ip_entry;
-                    break;
-                }
-                ip_entry = ip_entry->next;
-            }
-            break;
-        }
-        domain_entry = domain_entry->next;
-    }
-    
-    platform_rwlock_unlock(&segment->rwlock);
-    return result;
-}
-
-/**
- * @brief 销毁域名表（分段，支持IP链表）
- */
-void domain_table_destroy() {
-    // 释放所有分段的内容并销毁锁
-    for (int i = 0; i < DOMAIN_TABLE_NUM_SEGMENTS; i++) {
-        domain_table_segment_t* segment = &g_domain_table.segments[i];
-        
-        // 获取写锁以安全地销毁内容
-        platform_rwlock_wrlock(&segment->rwlock);
-        
-        // 释放该分段所有哈希桶中的条目
-        int buckets_per_segment = DOMAIN_TABLE_HASH_SIZE / DOMAIN_TABLE_NUM_SEGMENTS;
-        for (int j = 0; j < buckets_per_segment; j++) {
-            domain_entry_t* current = segment->hash_buckets[j];
-            while (current) {
-                domain_entry_t* next_domain = current->next;
-                
-                // 释放该域名条目的所有IP地址条目
-                ip_address_entry_t* ip_entry = current->ips;
-                while (ip_entry) {
-                    ip_address_entry_t* next_ip = ip_entry->next;
-                    free(ip_entry);
-                    ip_entry = next_ip;
-                }
-                
-                // 释放域名条目
-                free(current);
-                current = next_domain;
-            }
-            segment->hash_buckets[j] = NULL;
-        }
-        
-        segment->entry_count = 0;
-        platform_rwlock_unlock(&segment->rwlock);
-        
-        // 销毁读写锁
-        platform_rwlock_destroy(&segment->rwlock);
-    }
-    
-    g_domain_table.total_entry_count = 0;
-    log_info("分段本地域名表已销毁");
-}
-
-// ============================================================================
-// LRU缓存实现
-// ============================================================================
-
-/**
- * @brief 初始化DNS缓存
- */
-int dns_cache_init(int max_size) {
-    if (max_size <= 0) return MYERROR;
-    
-    // 清零哈希表
-    for (int i = 0; i < DNS_CACHE_HASH_SIZE; i++) { //ok
-        g_dns_cache.hash_table[i] = NULL;
-    }
-    
-    // 预分配条目池
-    g_dns_cache.entry_pool = (dns_cache_entry_t*)calloc(max_size, sizeof(dns_cache_entry_t));
-    if (!g_dns_cache.entry_pool) {
-        log_error("DNS缓存条目池内存分配失败");
-        return MYERROR;
-    }
-    
-    // 初始化空闲栈
-    if (free_stack_init(&g_dns_cache.free_stack, max_size) != 0) {
-        log_error("空闲栈初始化失败");
-        free(g_dns_cache.entry_pool);
-        return MYERROR;
-    }
-    
-    // 初始化内存池锁
-    if (platform_mutex_init(&g_dns_cache.pool_lock, NULL) != 0) {
-        log_error("内存池锁初始化失败");
-        free_stack_destroy(&g_dns_cache.free_stack);
-        free(g_dns_cache.entry_pool);
-        return MYERROR;
-    }
-    
-    // 初始化所有分段
-    int segment_max_size = max_size / DNS_CACHE_NUM_SEGMENTS;
-    if (segment_max_size <= 0) segment_max_size = 1; // 至少每段一个条目
-    
-    for (int i = 0; i < DNS_CACHE_NUM_SEGMENTS; i++) {
-        if (platform_rwlock_init(&g_dns_cache.segments[i].rwlock, NULL) != 0) {
-            log_error("分段读写锁初始化失败: %d", i);
-            // 清理已初始化的锁
-            for (int j = 0; j < i; j++) {
-                platform_rwlock_destroy(&g_dns_cache.segments[j].rwlock);
-            }
-            platform_mutex_destroy(&g_dns_cache.pool_lock);
-            free_stack_destroy(&g_dns_cache.free_stack);
-            free(g_dns_cache.entry_pool);
-            return MYERROR;
-        }
-        g_dns_cache.segments[i].lru_head = NULL;
-        g_dns_cache.segments[i].lru_tail = NULL;
-        g_dns_cache.segments[i].current_size = 0;
-        g_dns_cache.segments[i].max_size = segment_max_size;
-    }
-    
-    g_dns_cache.max_size = max_size;
-    g_dns_cache.cache_hits = 0;
-    g_dns_cache.cache_misses = 0;
-    g_dns_cache.cache_evictions = 0;
-    
-    log_info("DNS分段式缓存初始化完成，容量: %d, 分段数: %d, 每段容量: %d", 
-             max_size, DNS_CACHE_NUM_SEGMENTS, segment_max_size);
-    return MYSUCCESS;
-}
-
-/**
- * @brief 将缓存条目移动到分段LRU链表头部
- */
-void lru_move_to_head_segment(dns_cache_segment_t* segment, dns_cache_entry_t* entry) {
-    if (!segment || !entry) return;
-    
-    // 如果已经是头部，直接返回
-    if (segment->lru_head == entry) return;
-    
-    // 从当前位置移除
-    if (entry->prev) {
-        entry->prev->next = entry->next;
-    }
-    if (entry->next) {
-        entry->next->prev = entry->prev;
-    }
-    if (segment->lru_tail == entry) {
-        segment->lru_tail = entry->prev;
-    }
-    
-    // 插入到头部
-    entry->prev = NULL;
-    entry->next = segment->lru_head;
-    if (segment->lru_head) {
-        segment->lru_head->prev = entry;
-    }
-    segment->lru_head = entry;
-    
-    // 如果链表为空，设置尾部
-    if (!segment->lru_tail) {
-        segment->lru_tail = entry;
-    }
-}
-
-/**
- * @brief 移除分段LRU链表尾部条目并返回（不释放内存）
- */
-dns_cache_entry_t* lru_remove_tail_segment(dns_cache_segment_t* segment) {
-    if (!segment || !segment->lru_tail) return NULL;
-    
-    dns_cache_entry_t* tail = segment->lru_tail;
-    
-    // 从哈希表中移除
-    unsigned int hash_index = hash_key(tail->key) % DNS_CACHE_HASH_SIZE;
-    dns_cache_entry_t* current = g_dns_cache.hash_table[hash_index];
-    dns_cache_entry_t* prev = NULL;
-    
-    while (current) {
-        if (current == tail) {
-            if (prev) {
-                prev->hash_next = current->hash_next;
-            } else {
-                g_dns_cache.hash_table[hash_index] = current->hash_next;
-            }
-            break;
-        }
-        prev = current;
-        current = current->hash_next;
-    }
-    
-    // 从分段LRU链表中移除
-    if (tail->prev) {
-        tail->prev->next = NULL;
-    }
-    segment->lru_tail = tail->prev;
-    
-    if (segment->lru_head == tail) {
-        segment->lru_head = NULL;
-    }
-    
-    // 减少分段大小
-    segment->current_size--;
-    g_dns_cache.cache_evictions++;
-    
-    log_debug("分段LRU缓存移除尾部条目: %s, 分段当前大小: %d", tail->key, segment->current_size);
-    return tail;
-}
-
-/**
- * @brief 从缓存获取DNS条目（分段读写锁版本，支持查询类型）
- */
-dns_cache_entry_t* dns_cache_get(const char* domain, unsigned short qtype) {
-    if (!domain) return NULL;
-    
-    // 生成缓存键
-    char cache_key[MAX_CACHE_KEY_LENGTH];
-    snprintf(cache_key, sizeof(cache_key), "%s:%u", domain, qtype);
-    
-    // 获取对应的分段
-    dns_cache_segment_t* segment = get_cache_segment(cache_key);
-    if (!segment) return NULL;
-    
-    dns_cache_entry_t* result = NULL;
-    
-    // 获取读锁
-    platform_rwlock_rdlock(&segment->rwlock);
-    
-    unsigned int hash_index = hash_key(cache_key) % DNS_CACHE_HASH_SIZE;
-    dns_cache_entry_t* current = g_dns_cache.hash_table[hash_index];
-    
-    while (current) {
-        if (strcasecmp(current->key, cache_key) == 0) {
-            // 检查是否过期
-            time_t now = time(NULL);
-            if (now > current->expire_time) {
-                log_debug("缓存条目已过期: %s", cache_key);
-                g_dns_cache.cache_misses++;
-                break; // 过期了，退出循环
-            }
-            
-            // 命中了，但需要升级为写锁来更新LRU
-            platform_rwlock_unlock(&segment->rwlock);
-            platform_rwlock_wrlock(&segment->rwlock);
-            
-            // 再次检查（因为在锁切换期间可能被其他线程修改）
-            if (now <= current->expire_time && strcasecmp(current->key, cache_key) == 0) {
-                // 更新访问时间并移动到头部
-                current->access_time = now;
-                lru_move_to_head_segment(segment, current);
-                g_dns_cache.cache_hits++;
-                result = current;
-                log_debug("缓存命中: %s", cache_key);
-            } else {
-                g_dns_cache.cache_misses++;
-            }
-            break;
-        }
-        current = current->hash_next;
-    }
-    
-    if (!result) {
-        g_dns_cache.cache_misses++;
-        log_debug("缓存未命中: %s", cache_key);
-    }
-    
-    platform_rwlock_unlock(&segment->rwlock);
-    return result;
-}
-
-/**
- * @brief 内部函数：查找缓存条目（不检查过期，不移动LRU）
- * 仅用于内部逻辑，根据缓存键查找对应的缓存条目
- */
-static dns_cache_entry_t* dns_cache_find_entry_internal(const char* cache_key) {
-    if (!cache_key) return NULL;
-    
-    unsigned int hash_index = hash_key(cache_key) % DNS_CACHE_HASH_SIZE;
-    dns_cache_entry_t* current = g_dns_cache.hash_table[hash_index];
-    
-    while (current) {
-        if (strcasecmp(current->key, cache_key) == 0) {
-            return current; // 找到了，直接返回，不检查过期
-        }
-        current = current->hash_next;
-    }
-    
-    return NULL; // 没找到
-}
-
-/**
- * @brief 向缓存添加DNS条目（分段读写锁版本，支持查询类型）
- */
-int dns_cache_put(const char* domain, unsigned short qtype, DNS_ENTITY* response, int ttl) {
-    if (!domain || !response) return MYERROR;
-    
-    // 生成缓存键
-    char cache_key[MAX_CACHE_KEY_LENGTH];
-    snprintf(cache_key, sizeof(cache_key), "%s:%u", domain, qtype);
-    
-    // 获取对应的分段
-    dns_cache_segment_t* segment = get_cache_segment(cache_key);
-    if (!segment) return MYERROR;
-    
-    // 获取写锁
-    platform_rwlock_wrlock(&segment->rwlock);
-    
-    // 使用内部函数查找，无论是否过期
-    dns_cache_entry_t* entry = dns_cache_find_entry_internal(cache_key);
-    if (entry) {
-        // --- 路径A：找到了条目（无论是有效的还是过期的），执行原地更新 ---
-        log_debug("复用现有缓存槽位进行更新: %s", cache_key);
-        
-        // 1. 释放旧的DNS响应数据
-        if (entry->dns_response) {
-            free_dns_entity(entry->dns_response);
-        }
-        // 2. 更新为新的数据和过期时间
-        entry->dns_response = response;
-        entry->expire_time = time(NULL) + (ttl > 0 ? ttl : DEFAULT_TTL);
-        entry->access_time = time(NULL);
-        
-        // 3. 因为被更新，所以它是最新的，移动到分段LRU头部
-        lru_move_to_head_segment(segment, entry);
-        
-        platform_rwlock_unlock(&segment->rwlock);
-        log_debug("原地更新缓存条目: %s", cache_key);
-        return MYSUCCESS;
-    }    
-    
-    // --- 路径B：完全没找到条目，这是一个全新的缓存键，执行插入 ---
-    log_debug("为新缓存键创建缓存条目: %s", cache_key);
-    
-    dns_cache_entry_t* evicted_entry = NULL;
-    
-    // 如果分段已满，移除最旧的一个条目
-    if (segment->current_size >= segment->max_size) {
-        evicted_entry = lru_remove_tail_segment(segment);
-    }
-    
-    // 释放分段锁，访问全局内存池
-    platform_rwlock_unlock(&segment->rwlock);
-    
-    // --- 访问全局内存池，需要使用 pool_lock ---
-    platform_mutex_lock(&g_dns_cache.pool_lock);
-    
-    if (evicted_entry) {
-        // 清理被淘汰的条目并释放其DNS响应
-        if (evicted_entry->dns_response) {
-            free_dns_entity(evicted_entry->dns_response);
-            evicted_entry->dns_response = NULL;
-        }
-        memset(evicted_entry, 0, sizeof(dns_cache_entry_t));
-        
-        // 将被淘汰条目的索引推回空闲栈
-        int evicted_index = evicted_entry - g_dns_cache.entry_pool;
-        free_stack_push(&g_dns_cache.free_stack, evicted_index);
-    }
-    
-    // 从空闲栈获取新条目
-    int free_index = free_stack_pop(&g_dns_cache.free_stack);
-    platform_mutex_unlock(&g_dns_cache.pool_lock);
-    
-    if (free_index < 0) {
-        log_error("无法从空闲栈获取缓存条目");
-        return MYERROR;
-    }
-    
-    dns_cache_entry_t* new_entry = &g_dns_cache.entry_pool[free_index];
-    
-    // 填充条目
-    strncpy(new_entry->key, cache_key, MAX_CACHE_KEY_LENGTH - 1);
-    new_entry->key[MAX_CACHE_KEY_LENGTH - 1] = '\0';
-    new_entry->dns_response = response;
-    new_entry->expire_time = time(NULL) + (ttl > 0 ? ttl : DEFAULT_TTL);
-    new_entry->access_time = time(NULL);
-    new_entry->prev = NULL;
-    new_entry->next = NULL;
-    new_entry->hash_next = NULL;
-    
-    // 重新获取分段写锁来插入新条目
-    platform_rwlock_wrlock(&segment->rwlock);
-    
-    // 插入哈希表
-    unsigned int hash_index = hash_key(cache_key) % DNS_CACHE_HASH_SIZE;
-    new_entry->hash_next = g_dns_cache.hash_table[hash_index];
-    g_dns_cache.hash_table[hash_index] = new_entry;
-    
-    // 插入分段LRU链表头部
-    lru_move_to_head_segment(segment, new_entry);
-    segment->current_size++;
-    
-    platform_rwlock_unlock(&segment->rwlock);
-    
-    log_debug("添加新缓存条目: %s, TTL: %d, 分段当前大小: %d", cache_key, ttl, segment->current_size);
-    return MYSUCCESS;
-}
-
-/**
- * @brief 清理过期的缓存条目（分段版本）
- */
-void dns_cache_cleanup_expired() {
-    if (!&g_dns_cache) return;
-    
-    time_t now = time(NULL);
-    int total_cleaned = 0;
-    
-    // 遍历所有分段进行清理
-    for (int seg = 0; seg < DNS_CACHE_NUM_SEGMENTS; seg++) {
-        dns_cache_segment_t* segment = &g_dns_cache.segments[seg];
-        int cleaned = 0;
-        
-        platform_rwlock_wrlock(&segment->rwlock); // 需要写锁来清理
-        
-        // 从尾部开始清理过期条目
-        dns_cache_entry_t* current = segment->lru_tail;
-        while (current && now > current->expire_time) {
-            dns_cache_entry_t* prev = current->prev;
-            dns_cache_entry_t* expired = lru_remove_tail_segment(segment);
-            
-            if (expired) {
-                // 释放DNS响应
-                if (expired->dns_response) {
-                    free_dns_entity(expired->dns_response);
-                    expired->dns_response = NULL;
-                }
-                
-                // 清零条目并推回空闲栈
-                memset(expired, 0, sizeof(dns_cache_entry_t));
-                platform_mutex_lock(&g_dns_cache.pool_lock);
-                int index = expired - g_dns_cache.entry_pool;
-                free_stack_push(&g_dns_cache.free_stack, index);
-                platform_mutex_unlock(&g_dns_cache.pool_lock);
-                
-                cleaned++;
-            }
-            current = prev;
-        }
-        
-        platform_rwlock_unlock(&segment->rwlock);
-        total_cleaned += cleaned;
-    }
-    
-    if (total_cleaned > 0) {
-        log_info("清理了 %d 个过期缓存条目", total_cleaned);
-    }
-}
-
-/**
- * @brief 打印缓存统计信息（分段版本）
- */
-void dns_cache_print_stats() {
-    if (!&g_dns_cache) return;
-    
-    double hit_rate = 0.0;
-    unsigned long total_requests = g_dns_cache.cache_hits + g_dns_cache.cache_misses;
-    if (total_requests > 0) {
-        hit_rate = (double)g_dns_cache.cache_hits / total_requests * 100.0;
-    }
-    
-    // 计算总的缓存使用量
-    int total_current_size = 0;
-    for (int i = 0; i < DNS_CACHE_NUM_SEGMENTS; i++) {
-        total_current_size += g_dns_cache.segments[i].current_size;
-    }
-    
-    log_info("=== DNS分段式缓存统计 ===");
-    log_info("当前大小: %d/%d", total_current_size, g_dns_cache.max_size);
-    log_info("分段数量: %d", DNS_CACHE_NUM_SEGMENTS);
-    log_info("缓存命中: %lu", g_dns_cache.cache_hits);
-    log_info("缓存未命中: %lu", g_dns_cache.cache_misses);
-    log_info("缓存驱逐: %lu", g_dns_cache.cache_evictions);
-    log_info("命中率: %.2f%%", hit_rate);
-}
-
-/**
- * @brief 销毁DNS缓存（分段版本）
- */
-void dns_cache_destroy() {
-    if (!&g_dns_cache) return;
-    
-    // 释放所有DNS响应
-    for (int i = 0; i < g_dns_cache.max_size; i++) {
-        if (g_dns_cache.entry_pool[i].dns_response) {
-            free_dns_entity(g_dns_cache.entry_pool[i].dns_response);
-        }
-    }
-    
-    // 释放条目池
-    if (g_dns_cache.entry_pool) {
-        free(g_dns_cache.entry_pool);
-        g_dns_cache.entry_pool = NULL;
-    }
-    
-    // 销毁空闲栈
-    free_stack_destroy(&g_dns_cache.free_stack);
-    
-    // 销毁所有分段的读写锁
-    for (int i = 0; i < DNS_CACHE_NUM_SEGMENTS; i++) {
-        platform_rwlock_destroy(&g_dns_cache.segments[i].rwlock);
-        g_dns_cache.segments[i].lru_head = NULL;
-        g_dns_cache.segments[i].lru_tail = NULL;
-        g_dns_cache.segments[i].current_size = 0;
-    }
-    
-    // 销毁内存池锁
-    platform_mutex_destroy(&g_dns_cache.pool_lock);
-    
-    // 清零哈希表
-    for (int i = 0; i < DNS_CACHE_HASH_SIZE; i++) {
-        g_dns_cache.hash_table[i] = NULL;
-    }
-    
-    log_info("DNS分段式缓存已销毁");
-}
-// ============================================================================
-// 对外接口函数（用于集成到现有系统）
-// ============================================================================
-
-
-// ============================================================================
-// 统一查询接口实现
-// ============================================================================
-
-
-/**
- * @brief 统一DNS查询接口
- * 实现三级查询：本地表 -> 缓存 -> 上游DNS
- */
-dns_query_response_t* dns_relay_query(const char* domain, unsigned short qtype) {
-    if (!domain) return NULL;
-    
-    dns_query_response_t* response = (dns_query_response_t*)malloc(sizeof(dns_query_response_t));
-    if (!response) return NULL;
-    
-    memset(response, 0, sizeof(dns_query_response_t));
-    
-    // 第一步：查询本地域名表
-    ip_address_entry_t* local_entry = domain_table_lookup(domain, qtype);
-    if (local_entry) {
-        // 检查是否为阻止地址
-        int is_blocked = 0;
-        if (qtype == A && strcmp(local_entry->ip, "0.0.0.0") == 0) {
-            is_blocked = 1;
-        } else if (qtype == AAAA && strcmp(local_entry->ip, "::") == 0) {
-            is_blocked = 1;
-        }
-        
-        if (is_blocked) {
-            response->result_type = QUERY_RESULT_BLOCKED;
-            log_info("域名被阻止: %s (type:%u)", domain, qtype);
-        } else {
-            response->result_type = QUERY_RESULT_LOCAL_HIT;
-            strncpy(response->resolved_ip, local_entry->ip, MAX_IP_LENGTH - 1);
-            log_info("本地表命中: %s (type:%u) -> %s", domain, qtype, local_entry->ip);
-        }
-        
-        return response;
-    }
-    
-    // 第二步：查询缓存
-    dns_cache_entry_t* cache_entry = dns_cache_get(domain, qtype);
-    if (cache_entry && cache_entry->dns_response) {
-        response->result_type = QUERY_RESULT_CACHE_HIT;
-        response->dns_response = cache_entry->dns_response; // 注意：这里只是引用，不要释放
-        log_info("缓存命中: %s (type:%u)", domain, qtype);
-        return response;
-    }
-    
-    // 第三步：需要查询上游DNS
-    response->result_type = QUERY_RESULT_CACHE_MISS;
-    log_debug("需要查询上游DNS: %s (type:%u)", domain, qtype);
-    return response;
-}
-
-/**
- * @brief 初始化DNScache缓存和本地查询表
- */
-int dns_relay_init(const char* domain_file) {
-    log_info("初始化DNS中继服务...");
-    
-    // 初始化本地域名表
-    if (domain_table_init() != MYSUCCESS) {
-        log_error("本地域名表初始化失败");
-        return MYERROR;
-    }
-    
-    // 加载域名表文件
-    if (domain_file && domain_table_load_from_file(domain_file) != MYSUCCESS) {
-        log_warn("加载域名表文件失败，继续运行");
-    }
-    
-    // 初始化DNS缓存
-    if (dns_cache_init(DNS_CACHE_SIZE) != MYSUCCESS) {
-        log_error("DNS缓存初始化失败");
-        domain_table_destroy();
-        return MYERROR;
-    }
-    
-    log_info("DNS中继服务初始化完成");
-    return MYSUCCESS;
-}
-
-/**
- * @brief 清理DNScache缓存和本地查询表
- */
-void dns_relay_cleanup(void) {
-    log_info("清理DNS中继服务...");
-    
-    // 打印统计信息
-    dns_cache_print_stats();
-    
-    // 清理资源
-    dns_cache_destroy();
-    domain_table_destroy();
-    
-    log_info("DNS中继服务已清理完成");
-}
-
-
-/**
- * @brief 向缓存添加上游DNS响应
- * 这个函数用于在收到上游DNS响应后将其添加到缓存
- */
-int dns_relay_cache_response(const char* domain, unsigned short qtype, DNS_ENTITY* response) {
-    if (!domain || !response) return MYERROR;
-    
-    // 从DNS响应中提取TTL
-    int ttl = DEFAULT_TTL;
-    if (response->ancount > 0 && response->answers) {
-        ttl = response->answers[0].ttl;
-    }
-    
-    return dns_cache_put(domain, qtype, response, ttl);
-}
-
-/**
- * @brief 获取全局域名表和缓存的引用（用于统计）
- */
-void dns_relay_get_stats(int* domain_count, int* cache_size, unsigned long* cache_hits, unsigned long* cache_misses) {
-    if (domain_count) *domain_count = g_domain_table.total_entry_count;
-    
-    if (cache_size) {
-        // 计算所有分段的总缓存大小
-        int total_size = 0;
-        for (int i = 0; i < DNS_CACHE_NUM_SEGMENTS; i++) {
-            total_size += g_dns_cache.segments[i].current_size;
-        }
-        *cache_size = total_size;
-    }
-    
-    if (cache_hits) *cache_hits = g_dns_cache.cache_hits;
-    if (cache_misses) *cache_misses = g_dns_cache.cache_misses;
+#include "DNScache/relayBuild.h"
+#include "DNScache/free_stack.h"
+#include "DNScache/name_hash.h"
+#include "websocket/websocket.h"
+#include "platform/platform.h"
+#include "websocket/datagram.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+// ============================================================================
+// 全局变量
+// ============================================================================
+
+static domain_table_t g_domain_table;      // 全局本地域名表
+static dns_lru_cache_t g_dns_cache;        // 全局LRU缓存
+
+// ============================================================================
+// 哈希函数实现
+// ============================================================================
+
+// 域名表查找键：小写化后的域名及其哈希
+typedef struct {
+    unsigned long long hash;
+    int len;
+    char folded[MAX_DOMAIN_LENGTH];
+} domain_key_t;
+
+/**
+ * @brief 构造域名表查找键（一遍完成小写化和哈希）
+ * @return 成功返回MYSUCCESS，域名过长返回MYERROR
+ */
+static int domain_key_init(domain_key_t* key, const char* domain) {
+    size_t len = strlen(domain);
+    if (len >= MAX_DOMAIN_LENGTH) return MYERROR;
+
+    key->hash = name_fold_hash(domain, len, key->folded, 0);
+    key->folded[len] = '\0';
+    key->len = (int)len;
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 根据缓存键哈希获取其所属的缓存段
+ */
+dns_cache_segment_t* get_cache_segment(unsigned long long key_hash) {
+    // 使用位运算快速取模，前提是段数量为2的幂
+    return &g_dns_cache.segments[key_hash & g_dns_cache.segment_mask];
+}
+
+/**
+ * @brief 计算缓存键哈希在桶数组中的索引（低位已用于选段，选桶使用其上的位）
+ */
+static unsigned int cache_bucket_index(unsigned long long key_hash, unsigned int bucket_mask) {
+    return (unsigned int)(key_hash >> g_dns_cache.segment_bits) & bucket_mask;
+}
+
+/**
+ * @brief 获取缓存键哈希在其分段当前桶数组中对应的哈希桶（新条目总是插入当前桶数组）
+ */
+static dns_cache_entry_t** get_cache_bucket(dns_cache_segment_t* segment, unsigned long long key_hash) {
+    return &segment->hash_buckets[cache_bucket_index(key_hash, segment->bucket_mask)];
+}
+
+/**
+ * @brief 把条目从哈希链中摘除（再哈希期间条目可能仍在旧桶数组，调用方持有分段写锁）
+ */
+static void cache_bucket_unlink(dns_cache_segment_t* segment, dns_cache_entry_t* entry) {
+    dns_cache_entry_t** link = get_cache_bucket(segment, entry->key_hash);
+    while (*link && *link != entry) {
+        link = &(*link)->hash_next;
+    }
+    if (!*link && segment->old_buckets) {
+        link = &segment->old_buckets[cache_bucket_index(entry->key_hash, segment->old_bucket_mask)];
+        while (*link && *link != entry) {
+            link = &(*link)->hash_next;
+        }
+    }
+    if (*link) {
+        *link = entry->hash_next;
+    }
+    entry->hash_next = NULL;
+}
+
+/**
+ * @brief 根据域名哈希获取其所属的域名表分段
+ */
+domain_table_segment_t* get_domain_table_segment(unsigned long long domain_hash) {
+    // 使用位运算快速取模，前提是段数量为2的幂
+    return &g_domain_table.segments[domain_hash & (DOMAIN_TABLE_NUM_SEGMENTS - 1)];
+}
+
+/**
+ * @brief 计算域名在分段内的哈希桶索引
+ */
+static unsigned int domain_bucket_index(unsigned long long domain_hash) {
+    int buckets_per_segment = DOMAIN_TABLE_HASH_SIZE / DOMAIN_TABLE_NUM_SEGMENTS;
+    return (unsigned int)((domain_hash / DOMAIN_TABLE_NUM_SEGMENTS) % buckets_per_segment);
+}
+
+/**
+ * @brief 在分段中查找域名条目（调用方持有分段锁）
+ */
+static domain_entry_t* domain_table_find(domain_table_segment_t* segment, const domain_key_t* key) {
+    domain_entry_t* current = segment->hash_buckets[domain_bucket_index(key->hash)];
+    while (current) {
+        if (current->domain_len == key->len && current->hash == key->hash &&
+            memcmp(current->domain, key->folded, key->len) == 0) {
+            return current;
+        }
+        current = current->next;
+    }
+    return NULL;
+}
+
+// ============================================================================
+// 本地域名表实现
+// ============================================================================
+
+/**
+ * @brief 初始化本地域名表（分段版本）
+ */
+int domain_table_init() {
+    // 初始化所有分段
+    for (int i = 0; i < DOMAIN_TABLE_NUM_SEGMENTS; i++) {
+        // 初始化读写锁
+        if (platform_rwlock_init(&g_domain_table.segments[i].rwlock, NULL) != 0) {
+            log_error("域名表分段读写锁初始化失败: %d", i);
+            // 清理已初始化的锁
+            for (int j = 0; j < i; j++) {
+                platform_rwlock_destroy(&g_domain_table.segments[j].rwlock);
+            }
+            return MYERROR;
+        }
+        
+        // 清零该分段的哈希桶
+        int buckets_per_segment = DOMAIN_TABLE_HASH_SIZE / DOMAIN_TABLE_NUM_SEGMENTS;
+        for (int k = 0; k < buckets_per_segment; k++) {
+            g_domain_table.segments[i].hash_buckets[k] = NULL;
+        }
+        
+        g_domain_table.segments[i].entry_count = 0;
+        g_domain_table.segments[i].max_chain = 0;
+    }
+    
+    g_domain_table.total_entry_count = 0;
+    g_domain_table.last_load_time = 0;
+    
+    log_info("本地域名表分段初始化完成，分段数: %d", DOMAIN_TABLE_NUM_SEGMENTS);
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 预编译IP地址条目的应答模板
+ *
+ * 屏蔽地址编译为不含回答的NXDOMAIN；其他地址编译为一条完整的A/AAAA回答记录，
+ * 所有者名使用指向报文偏移12（问题部分的查询名）的压缩指针，因此与具体请求无关。
+ *
+ * @return 成功返回MYSUCCESS，IP地址格式错误返回MYERROR
+ */
+static int local_answer_compile(ip_address_entry_t* ip_entry, int is_blocked) {
+    dns_answer_template_t* answer = &ip_entry->answer;
+    memset(answer, 0, sizeof(dns_answer_template_t));
+
+    if (is_blocked) {
+        answer->flags = 0x8183;  // QR=1, RD=1, RA=1, RCODE=3 (Name Error)
+        return MYSUCCESS;
+    }
+
+    int addr_len = ip_entry->type == AAAA ? 16 : 4;
+    char* rr = answer->rr;
+    if (inet_pton(ip_entry->type == AAAA ? AF_INET6 : AF_INET, ip_entry->ip, rr + 12) != 1) {
+        return MYERROR;
+    }
+
+    unsigned int ttl = LOCAL_ANSWER_TTL;
+    rr[0] = (char)0xC0;             // 所有者名：指向查询名的压缩指针
+    rr[1] = DNS_HEADER_SIZE;
+    rr[2] = 0;
+    rr[3] = (char)ip_entry->type;   // TYPE
+    rr[4] = 0;
+    rr[5] = 1;                      // CLASS IN
+    rr[6] = (char)(ttl >> 24);
+    rr[7] = (char)(ttl >> 16);
+    rr[8] = (char)(ttl >> 8);
+    rr[9] = (char)ttl;
+    rr[10] = 0;
+    rr[11] = (char)addr_len;        // RDLENGTH
+
+    answer->flags = 0x8180;  // QR=1, RD=1, RA=1, RCODE=0 (No Error)
+    answer->ancount = 1;
+    answer->rr_len = 12 + addr_len;
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 从文件加载域名表（分段版本，支持IPv4和IPv6）
+ */
+int domain_table_load_from_file(const char* filename) {
+    if (!filename) return MYERROR;
+    
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        log_error("无法打开域名表文件: %s", filename);
+        return MYERROR;
+    }
+    
+    char line[512];
+    int loaded_count = 0;
+    
+    while (fgets(line, sizeof(line), file)) {
+        // 移除换行符
+        line[strcspn(line, "\r\n")] = '\0';
+        
+        // 跳过空行和注释
+        if (line[0] == '\0' || line[0] == '#') continue;
+        
+        // 解析 IP 域名 格式
+        char ip[MAX_IP_LENGTH];
+        char domain[MAX_DOMAIN_LENGTH];
+        
+        if (sscanf(line, "%s %s", ip, domain) != 2) {
+            log_warn("跳过无效行: %s", line);
+            continue;
+        }
+        
+        // 判断IP地址类型
+        unsigned short ip_type;
+        int is_blocked = 0;
+        if (strchr(ip, ':') != NULL) {
+            // IPv6地址
+            ip_type = AAAA;
+            is_blocked = (strcmp(ip, "::") == 0);
+        } else {
+            // IPv4地址
+            ip_type = A;
+            is_blocked = (strcmp(ip, "0.0.0.0") == 0);
+        }
+        
+        // 先在栈上编译应答模板，IP地址无效的行直接跳过
+        ip_address_entry_t parsed_ip;
+        parsed_ip.type = ip_type;
+        strncpy(parsed_ip.ip, ip, MAX_IP_LENGTH - 1);
+        parsed_ip.ip[MAX_IP_LENGTH - 1] = '\0';
+        if (local_answer_compile(&parsed_ip, is_blocked) != MYSUCCESS) {
+            log_warn("跳过IP地址无效的行: %s", line);
+            continue;
+        }
+        
+        domain_key_t key;
+        if (domain_key_init(&key, domain) != MYSUCCESS) {
+            log_warn("跳过域名过长的行: %s", line);
+            continue;
+        }
+        
+        // 获取对应的分段
+        domain_table_segment_t* segment = get_domain_table_segment(key.hash);
+        
+        // 获取写锁并查找或创建域名条目
+        platform_rwlock_wrlock(&segment->rwlock);
+        domain_entry_t* domain_entry = domain_table_find(segment, &key);
+        
+        // 如果没有找到域名条目，创建新的
+        if (!domain_entry) {
+            domain_entry = (domain_entry_t*)malloc(sizeof(domain_entry_t));
+            if (!domain_entry) {
+                log_error("内存分配失败");
+                platform_rwlock_unlock(&segment->rwlock);
+                continue;
+            }
+            
+            // 初始化域名条目（保存小写形式，查找时直接按字节比较）
+            memcpy(domain_entry->domain, key.folded, key.len + 1);
+            domain_entry->domain_len = key.len;
+            domain_entry->hash = key.hash;
+            domain_entry->ips = NULL;
+            domain_entry->is_blocked = 0;
+            
+            // 插入到链表头部
+            unsigned int bucket_index = domain_bucket_index(key.hash);
+            domain_entry->next = segment->hash_buckets[bucket_index];
+            segment->hash_buckets[bucket_index] = domain_entry;
+            segment->entry_count++;
+            
+            int chain = 0;
+            for (domain_entry_t* e = domain_entry; e; e = e->next) chain++;
+            if (chain > segment->max_chain) segment->max_chain = chain;
+        }
+        
+        // 创建IP地址条目
+        ip_address_entry_t* ip_entry = (ip_address_entry_t*)malloc(sizeof(ip_address_entry_t));
+        if (!ip_entry) {
+            log_error("IP地址条目内存分配失败");
+            platform_rwlock_unlock(&segment->rwlock);
+            continue;
+        }
+        
+        *ip_entry = parsed_ip;
+        
+        // 将IP条目插入到域名条目的IP链表头部
+        ip_entry->next = domain_entry->ips;
+        domain_entry->ips = ip_entry;
+        
+        // 如果有任何一个IP地址被阻止，则整个域名被标记为阻止
+        if (is_blocked) {
+            domain_entry->is_blocked = 1;
+        }
+        
+        platform_rwlock_unlock(&segment->rwlock);
+        loaded_count++;
+    }
+    
+    fclose(file);
+    g_domain_table.total_entry_count = loaded_count;
+    g_domain_table.last_load_time = time(NULL);
+    
+    int max_chain = 0;
+    for (int i = 0; i < DOMAIN_TABLE_NUM_SEGMENTS; i++) {
+        if (g_domain_table.segments[i].max_chain > max_chain) max_chain = g_domain_table.segments[i].max_chain;
+    }
+    log_info("成功加载 %d 个IP地址条目到分段域名表，最长冲突链: %d", loaded_count, max_chain);
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 查找域名表条目（分段读写锁，支持查询类型）
+ */
+ip_address_entry_t* domain_table_lookup(const char* domain, unsigned short qtype) {
+    if (!domain) return NULL;
+    
+    domain_key_t key;
+    if (domain_key_init(&key, domain) != MYSUCCESS) return NULL;
+    
+    // 获取对应的分段
+    domain_table_segment_t* segment = get_domain_table_segment(key.hash);
+    
+    ip_address_entry_t* result = NULL;
+    
+    // 获取读锁（多线程可以并发读取不同分段）
+    platform_rwlock_rdlock(&segment->rwlock);
+    
+    // 找到域名条目后，在其IP链表中查找匹配的查询类型
+    domain_entry_t* domain_entry = domain_table_find(segment, &key);
+    if (domain_entry) {
+        ip_address_entry_t* ip_entry = domain_entry->ips;
+        while (ip_entry) {
+            if (ip_entry->type == qtype) {
+                result = ip_entry;
+                break;
+            }
+            ip_entry = ip_entry->next;
+        }
+    }
+    
+    platform_rwlock_unlock(&segment->rwlock);
+    return result;
+}
+
+/**
+ * @brief 销毁域名表（分段，支持IP链表）
+ */
+void domain_table_destroy() {
+    // 释放所有分段的内容并销毁锁
+    for (int i = 0; i < DOMAIN_TABLE_NUM_SEGMENTS; i++) {
+        domain_table_segment_t* segment = &g_domain_table.segments[i];
+        
+        // 获取写锁以安全地销毁内容
+        platform_rwlock_wrlock(&segment->rwlock);
+        
+        // 释放该分段所有哈希桶中的条目
+        int buckets_per_segment = DOMAIN_TABLE_HASH_SIZE / DOMAIN_TABLE_NUM_SEGMENTS;
+        for (int j = 0; j < buckets_per_segment; j++) {
+            domain_entry_t* current = segment->hash_buckets[j];
+            while (current) {
+                domain_entry_t* next_domain = current->next;
+                
+                // 释放该域名条目的所有IP地址条目
+                ip_address_entry_t* ip_entry = current->ips;
+                while (ip_entry) {
+                    ip_address_entry_t* next_ip = ip_entry->next;
+                    free(ip_entry);
+                    ip_entry = next_ip;
+                }
+                
+                // 释放域名条目
+                free(current);
+                current = next_domain;
+            }
+            segment->hash_buckets[j] = NULL;
+        }
+        
+        segment->entry_count = 0;
+        segment->max_chain = 0;
+        platform_rwlock_unlock(&segment->rwlock);
+        
+        // 销毁读写锁
+        platform_rwlock_destroy(&segment->rwlock);
+    }
+    
+    g_domain_table.total_entry_count = 0;
+    log_info("分段本地域名表已销毁");
+}
+
+// ============================================================================
+// LRU缓存实现
+// ============================================================================
+
+/**
+ * @brief 计算不小于value的2的幂
+ */
+static unsigned int cache_round_up_pow2(unsigned int value) {
+    unsigned int result = 1;
+    while (result < value) result <<= 1;
+    return result;
+}
+
+/**
+ * @brief 每段容量对应的桶数（负载因子不超过1）
+ */
+static unsigned int cache_bucket_count_for(int segment_max_size) {
+    unsigned int count = cache_round_up_pow2((unsigned int)segment_max_size);
+    return count < DNS_CACHE_MIN_BUCKETS ? DNS_CACHE_MIN_BUCKETS : count;
+}
+
+/**
+ * @brief 读取缓存粗粒度时钟（由维护线程每DNS_CACHE_HOUSEKEEPING_MS更新）
+ */
+static time_t cache_clock_now(void) {
+    return platform_atomic_load_relaxed(&g_dns_cache.clock);
+}
+
+/**
+ * @brief 通过槽位索引取得条目（调用方持有分段写锁）
+ */
+static dns_cache_entry_t* cache_slot_entry(dns_cache_segment_t* segment, int slot) {
+    return &segment->slab_chunks[slot / DNS_CACHE_SLAB_CHUNK][slot % DNS_CACHE_SLAB_CHUNK];
+}
+
+/**
+ * @brief 为分段追加一个槽位块，新槽位压入空闲栈（调用方持有分段写锁或分段尚未发布）
+ * @return 成功返回MYSUCCESS，内存不足返回MYERROR
+ */
+static int cache_segment_add_chunk(dns_cache_segment_t* segment) {
+    dns_cache_entry_t** chunks = (dns_cache_entry_t**)realloc(segment->slab_chunks,
+                                                              sizeof(dns_cache_entry_t*) * (segment->chunk_count + 1));
+    if (!chunks) return MYERROR;
+    segment->slab_chunks = chunks;
+    
+    dns_cache_entry_t* chunk = (dns_cache_entry_t*)calloc(DNS_CACHE_SLAB_CHUNK, sizeof(dns_cache_entry_t));
+    if (!chunk) return MYERROR;
+    
+    int capacity = (segment->chunk_count + 1) * DNS_CACHE_SLAB_CHUNK;
+    int result = segment->chunk_count == 0 ? free_stack_init(&segment->free_slots, capacity)
+                                           : free_stack_grow(&segment->free_slots, capacity);
+    if (result != 0) {
+        free(chunk);
+        return MYERROR;
+    }
+    
+    for (int i = 0; i < DNS_CACHE_SLAB_CHUNK; i++) {
+        chunk[i].slot = segment->chunk_count * DNS_CACHE_SLAB_CHUNK + i;
+    }
+    chunks[segment->chunk_count++] = chunk;
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 释放前count个分段的桶数组、条目槽位、空闲栈和读写锁（不处理条目持有的数据块）
+ */
+static void dns_cache_free_segments(int count) {
+    for (int i = 0; i < count; i++) {
+        dns_cache_segment_t* segment = &g_dns_cache.segments[i];
+        platform_rwlock_destroy(&segment->rwlock);
+        free_stack_destroy(&segment->free_slots);
+        for (int k = 0; k < segment->chunk_count; k++) {
+            free(segment->slab_chunks[k]);
+        }
+        free(segment->slab_chunks);
+        free(segment->hash_buckets);
+        free(segment->old_buckets);
+    }
+    free(g_dns_cache.segments);
+    memset(&g_dns_cache, 0, sizeof(dns_lru_cache_t));
+}
+
+static int dns_cache_housekeeper_start(void);
+
+/**
+ * @brief 使用默认值填充缓存配置（容量和分段数均按CPU核心数推导）
+ */
+void dns_cache_config_init(dns_cache_config_t* config) {
+    if (!config) return;
+    config->max_size = 0;
+    config->max_bytes = 0;
+    config->num_segments = 0;
+    config->prefetch_percent = DNS_CACHE_PREFETCH_PERCENT;
+    config->prefetch_min_hits = DNS_CACHE_PREFETCH_MIN_HITS;
+}
+
+/**
+ * @brief 初始化DNS缓存
+ *
+ * 容量为0时取CPU核心数×DNS_CACHE_ENTRIES_PER_CPU，字节预算为0时取CPU核心数×DNS_CACHE_BYTES_PER_CPU，
+ * 分段数为0时取CPU核心数×DNS_CACHE_SEGMENTS_PER_CPU，
+ * 分段数向上取2的幂并限制在[DNS_CACHE_MIN_SEGMENTS, DNS_CACHE_MAX_SEGMENTS]内。
+ * 每段只预分配一个槽位块，其余槽位随写入按块追加。
+ *
+ * @param config 缓存配置（NULL使用默认值）
+ */
+int dns_cache_init(const dns_cache_config_t* config) {
+    dns_cache_config_t default_config;
+    if (!config) {
+        dns_cache_config_init(&default_config);
+        config = &default_config;
+    }
+    
+    int cpu_count = platform_get_cpu_count();
+    if (cpu_count < 1) cpu_count = 1;
+    
+    long long max_size = config->max_size > 0 ? config->max_size : (long long)cpu_count * DNS_CACHE_ENTRIES_PER_CPU;
+    if (max_size > DNS_CACHE_MAX_SIZE) max_size = DNS_CACHE_MAX_SIZE;
+    size_t max_bytes = config->max_bytes > 0 ? config->max_bytes : (size_t)cpu_count * DNS_CACHE_BYTES_PER_CPU;
+    
+    int num_segments = config->num_segments > 0 ? config->num_segments : cpu_count * DNS_CACHE_SEGMENTS_PER_CPU;
+    if (num_segments < DNS_CACHE_MIN_SEGMENTS) num_segments = DNS_CACHE_MIN_SEGMENTS;
+    if (num_segments > DNS_CACHE_MAX_SEGMENTS) num_segments = DNS_CACHE_MAX_SEGMENTS;
+    num_segments = (int)cache_round_up_pow2((unsigned int)num_segments);
+    
+    int segment_max_size = (int)(max_size / num_segments);
+    if (segment_max_size <= 0) segment_max_size = 1; // 至少每段一个条目
+    unsigned int bucket_count = cache_bucket_count_for(segment_max_size);
+    size_t segment_max_bytes = max_bytes / num_segments;
+    
+    memset(&g_dns_cache, 0, sizeof(dns_lru_cache_t));
+    g_dns_cache.clock = time(NULL);
+    g_dns_cache.segments = (dns_cache_segment_t*)calloc(num_segments, sizeof(dns_cache_segment_t));
+    if (!g_dns_cache.segments) {
+        log_error("DNS缓存分段数组分配失败: %d", num_segments);
+        return MYERROR;
+    }
+    g_dns_cache.num_segments = num_segments;
+    g_dns_cache.segment_mask = (unsigned int)num_segments - 1;
+    while ((1 << g_dns_cache.segment_bits) < num_segments) g_dns_cache.segment_bits++;
+    
+    // 初始化所有分段：每段独立分配桶数组、首个槽位块和空闲栈
+    for (int i = 0; i < num_segments; i++) {
+        dns_cache_segment_t* segment = &g_dns_cache.segments[i];
+        
+        if (platform_rwlock_init(&segment->rwlock, NULL) != 0) {
+            log_error("分段读写锁初始化失败: %d", i);
+            dns_cache_free_segments(i);
+            return MYERROR;
+        }
+        
+        segment->hash_buckets = (dns_cache_entry_t**)calloc(bucket_count, sizeof(dns_cache_entry_t*));
+        if (!segment->hash_buckets || cache_segment_add_chunk(segment) != MYSUCCESS) {
+            log_error("DNS缓存分段桶数组或条目槽位分配失败: %d", i);
+            dns_cache_free_segments(i + 1);
+            return MYERROR;
+        }
+        segment->bucket_mask = bucket_count - 1;
+        segment->max_size = segment_max_size;
+        segment->max_bytes = segment_max_bytes;
+        segment->wheel_time = g_dns_cache.clock;
+    }
+    
+    g_dns_cache.max_size = (int)max_size;
+    g_dns_cache.max_bytes = max_bytes;
+    g_dns_cache.prefetch_percent = config->prefetch_percent > 100 ? 100 :
+                                   (config->prefetch_percent > 0 ? config->prefetch_percent : 0);
+    g_dns_cache.prefetch_min_hits = config->prefetch_min_hits > 0 ? (unsigned int)config->prefetch_min_hits : 0;
+    
+    platform_mutex_init(&g_dns_cache.resize_lock, NULL);
+    if (dns_cache_housekeeper_start() != MYSUCCESS) {
+        platform_mutex_destroy(&g_dns_cache.resize_lock);
+        dns_cache_free_segments(num_segments);
+        return MYERROR;
+    }
+    
+    log_info("DNS分段式缓存初始化完成，容量: %d, 字节预算: %zu, 分段数: %d, 每段容量: %d, 每段哈希桶: %u", 
+             g_dns_cache.max_size, max_bytes, num_segments, segment_max_size, bucket_count);
+    log_info("缓存预取: 剩余TTL≤%d%%且命中≥%u次时刷新", g_dns_cache.prefetch_percent, g_dns_cache.prefetch_min_hits);
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 条目占用的字节数：条目槽位、数据块头、报文和缓存键
+ */
+static size_t cache_entry_charge(int packet_len, int key_len) {
+    return sizeof(dns_cache_entry_t) + sizeof(dns_cache_blob_t) + (size_t)packet_len + (size_t)key_len;
+}
+
+/**
+ * @brief 条目字节数所属的大小分布档位（≤128为0档，每档翻倍，最后一档不设上限）
+ */
+static int cache_size_class(size_t charge) {
+    int size_class = 0;
+    size_t limit = 128;
+    while (charge > limit && size_class < DNS_CACHE_SIZE_CLASSES - 1) {
+        limit <<= 1;
+        size_class++;
+    }
+    return size_class;
+}
+
+/**
+ * @brief 把条目的字节数计入或移出分段统计（sign为1或-1，调用方持有分段写锁）
+ */
+static void cache_segment_account(dns_cache_segment_t* segment, const dns_cache_entry_t* entry, int sign) {
+    size_t charge = cache_entry_charge(entry->blob->packet_len, entry->key_len);
+    if (sign > 0) {
+        segment->bytes_used += charge;
+    } else {
+        segment->bytes_used -= charge;
+    }
+    segment->size_classes[cache_size_class(charge)] += sign;
+}
+
+/**
+ * @brief 将缓存条目移动到分段LRU链表头部
+ */
+void lru_move_to_head_segment(dns_cache_segment_t* segment, dns_cache_entry_t* entry) {
+    if (!segment || !entry) return;
+    
+    // 如果已经是头部，直接返回
+    if (segment->lru_head == entry) return;
+    
+    // 从当前位置移除
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    }
+    if (segment->lru_tail == entry) {
+        segment->lru_tail = entry->prev;
+    }
+    
+    // 插入到头部
+    entry->prev = NULL;
+    entry->next = segment->lru_head;
+    if (segment->lru_head) {
+        segment->lru_head->prev = entry;
+    }
+    segment->lru_head = entry;
+    
+    // 如果链表为空，设置尾部
+    if (!segment->lru_tail) {
+        segment->lru_tail = entry;
+    }
+}
+
+/**
+ * @brief 把条目挂到时间轮上：与当前刻度相差不足64^(L+1)秒的条目放在第L层，
+ * 槽位取过期时间第L组6位（调用方持有分段写锁）
+ */
+static void cache_wheel_insert(dns_cache_segment_t* segment, dns_cache_entry_t* entry) {
+    // 过期时间早于当前刻度时挂在当前刻度，下次推进即回收；DNS_CACHE_MAX_TTL远小于最高层覆盖范围
+    unsigned long long expire = (unsigned long long)(entry->expire_time > segment->wheel_time ?
+                                                     entry->expire_time : segment->wheel_time);
+    unsigned long long delta = expire - (unsigned long long)segment->wheel_time;
+    
+    int level = 0;
+    while (level < DNS_CACHE_WHEEL_LEVELS - 1 && delta >> (DNS_CACHE_WHEEL_BITS * (level + 1))) {
+        level++;
+    }
+    
+    dns_cache_entry_t** head = &segment->wheel[level][(expire >> (DNS_CACHE_WHEEL_BITS * level)) & (DNS_CACHE_WHEEL_SLOTS - 1)];
+    entry->wheel_next = *head;
+    entry->wheel_pprev = head;
+    if (*head) {
+        (*head)->wheel_pprev = &entry->wheel_next;
+    }
+    *head = entry;
+}
+
+/**
+ * @brief 把条目从时间轮上摘除（调用方持有分段写锁）
+ */
+static void cache_wheel_unlink(dns_cache_entry_t* entry) {
+    if (!entry->wheel_pprev) return;
+    
+    *entry->wheel_pprev = entry->wheel_next;
+    if (entry->wheel_next) {
+        entry->wheel_next->wheel_pprev = entry->wheel_pprev;
+    }
+    entry->wheel_next = NULL;
+    entry->wheel_pprev = NULL;
+}
+
+/**
+ * @brief 把条目从哈希桶、CLOCK链表和时间轮中摘除并扣减分段统计（不释放内存，调用方持有分段写锁）
+ */
+static void cache_segment_remove(dns_cache_segment_t* segment, dns_cache_entry_t* entry) {
+    cache_bucket_unlink(segment, entry);
+    cache_wheel_unlink(entry);
+    
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        segment->lru_head = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        segment->lru_tail = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+    
+    cache_segment_account(segment, entry, -1);
+    segment->current_size--;
+}
+
+/**
+ * @brief 移除分段LRU链表尾部条目并返回（不释放内存）
+ */
+dns_cache_entry_t* lru_remove_tail_segment(dns_cache_segment_t* segment) {
+    if (!segment || !segment->lru_tail) return NULL;
+    
+    dns_cache_entry_t* tail = segment->lru_tail;
+    cache_segment_remove(segment, tail);
+    segment->evictions++;
+    
+    log_debug("分段LRU缓存移除尾部条目: %016llx, 分段当前大小: %d", tail->key_hash, segment->current_size);
+    return tail;
+}
+
+/**
+ * @brief CLOCK淘汰：从尾部扫描，访问位为1的条目清位后移回头部（二次机会），
+ * 遇到访问位为0的条目时将其移除并返回（不释放内存）
+ *
+ * 调用方持有分段写锁，命中路径此时无法置位，因此最多转一圈就能找到淘汰对象。
+ */
+dns_cache_entry_t* clock_evict_segment(dns_cache_segment_t* segment) {
+    if (!segment) return NULL;
+    
+    for (int scanned = 0; segment->lru_tail && scanned < segment->current_size; scanned++) {
+        dns_cache_entry_t* tail = segment->lru_tail;
+        if (!platform_atomic_load_relaxed(&tail->referenced)) break;
+        platform_atomic_store_relaxed(&tail->referenced, 0);
+        lru_move_to_head_segment(segment, tail);
+    }
+    return lru_remove_tail_segment(segment);
+}
+
+// ============================================================================
+// 线路格式辅助函数
+// ============================================================================
+
+static unsigned int wire_read_u16(const char* p) {
+    return ((unsigned int)(unsigned char)p[0] << 8) | (unsigned char)p[1];
+}
+
+static unsigned int wire_read_u32(const char* p) {
+    return (wire_read_u16(p) << 16) | wire_read_u16(p + 2);
+}
+
+static void wire_write_u32(char* p, unsigned int value) {
+    p[0] = (char)(value >> 24);
+    p[1] = (char)(value >> 16);
+    p[2] = (char)(value >> 8);
+    p[3] = (char)value;
+}
+
+/**
+ * @brief 收集响应中各资源记录TTL字段的偏移，并计算最小TTL和否定应答的缓存时长
+ *
+ * 遍历回答、授权、附加三个部分；OPT伪记录的TTL字段是扩展RCODE和标志位，不收集。
+ * 授权部分的第一条SOA记录决定否定应答的缓存时长：min(SOA记录TTL, SOA MINIMUM)（RFC 2308）。
+ *
+ * @param offsets 输出TTL字段偏移
+ * @param max_offsets offsets容量
+ * @param min_ttl 输出最小TTL（没有资源记录时不修改）
+ * @param negative_ttl 输出否定应答缓存时长（授权部分没有SOA记录时为DNS_CACHE_NO_NEGATIVE_TTL）
+ * @return TTL字段数量，报文格式错误或记录数超过容量返回-1
+ */
+static int wire_collect_ttl_offsets(const char* packet, int packet_len, unsigned short* offsets,
+                                    int max_offsets, unsigned int* min_ttl, unsigned int* negative_ttl) {
+    dns_msg_view_t view;
+    *negative_ttl = DNS_CACHE_NO_NEGATIVE_TTL;
+    if (dns_msg_view_parse(&view, packet, packet_len) != MYSUCCESS || view.truncated) return -1;
+
+    int count = 0;
+    for (int i = 0; i < view.record_count; i++) {
+        const dns_rr_view_t* rr = &view.records[i];
+        if (rr->type == OPT) continue;
+        if (count >= max_offsets) return -1;
+
+        if (count == 0 || rr->ttl < *min_ttl) {
+            *min_ttl = rr->ttl;
+        }
+        offsets[count++] = rr->ttl_offset;
+
+        // RDATA为MNAME、RNAME两个域名加定长部分，MINIMUM是最后4个字节
+        int in_authority = i >= view.ancount && i < view.ancount + view.nscount;
+        if (in_authority && rr->type == SOA && *negative_ttl == DNS_CACHE_NO_NEGATIVE_TTL &&
+            rr->rdlength >= 2 + DNS_SOA_FIXED_SIZE) {
+            unsigned int minimum = wire_read_u32(packet + rr->rdata_offset + rr->rdlength - 4);
+            *negative_ttl = rr->ttl < minimum ? rr->ttl : minimum;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief 由报文中的问题构造缓存键：跟随压缩指针展开线路格式查询名，一遍完成小写化和哈希
+ *
+ * 标签按线路格式逐字节比较，含'.'或NUL的标签不会与其他域名混淆。
+ *
+ * @return 成功返回MYSUCCESS，查询名格式错误返回MYERROR
+ */
+int dns_cache_key_init(dns_cache_key_t* key, const dns_msg_view_t* view, const dns_question_view_t* question) {
+    if (!key || !view || !question) return MYERROR;
+
+    unsigned char* data = key->data;
+    int pos = dns_msg_view_read_wire_name(view, question->name_offset, data);
+    if (pos < 0) return MYERROR;
+
+    // 小写化与哈希一遍完成（原地折叠），QTYPE/QCLASS作为种子参与哈希
+    unsigned short qtype = question->qtype;
+    unsigned short qclass = question->qclass;
+    unsigned long long seed = ((unsigned long long)qtype << 16) | qclass;
+    key->hash = name_fold_hash((const char*)data, pos, (char*)data, seed);
+
+    data[pos++] = (unsigned char)(qtype >> 8);
+    data[pos++] = (unsigned char)qtype;
+    data[pos++] = (unsigned char)(qclass >> 8);
+    data[pos++] = (unsigned char)qclass;
+    key->len = pos;
+    return MYSUCCESS;
+}
+
+static const unsigned char* cache_blob_key(const dns_cache_blob_t* blob) {
+    return (const unsigned char*)blob->data + blob->packet_len;
+}
+
+/**
+ * @brief 创建响应数据块（报文之后紧跟缓存键），初始引用归缓存所有
+ *
+ * 副本中超过条目缓存时长ttl的TTL字段（否定应答的SOA记录、超过上限的TTL）改写为ttl，
+ * 命中时下游看到的TTL不会超过条目的剩余时间。
+ *
+ * @return 成功返回数据块，内存不足返回NULL
+ */
+static dns_cache_blob_t* cache_blob_create(const dns_cache_key_t* key, const char* packet, int packet_len,
+                                           const unsigned short* ttl_offsets, int ttl_count, int ttl, time_t now) {
+    dns_cache_blob_t* blob = (dns_cache_blob_t*)malloc(sizeof(dns_cache_blob_t) + (size_t)packet_len + key->len);
+    if (!blob) return NULL;
+
+    blob->refcount = 1;
+    blob->packet_len = packet_len;
+    blob->ttl_count = ttl_count;
+    blob->insert_time = now;
+    memcpy(blob->ttl_offsets, ttl_offsets, sizeof(unsigned short) * ttl_count);
+    memcpy(blob->data, packet, packet_len);
+    memcpy(blob->data + packet_len, key->data, key->len);
+    for (int i = 0; i < ttl_count; i++) {
+        if (wire_read_u32(blob->data + ttl_offsets[i]) > (unsigned int)ttl) {
+            wire_write_u32(blob->data + ttl_offsets[i], (unsigned int)ttl);
+        }
+    }
+    return blob;
+}
+
+/**
+ * @brief 放弃一个数据块引用，最后一个引用负责释放
+ */
+static void cache_blob_release(dns_cache_blob_t* blob) {
+    if (blob && platform_atomic_fetch_sub(&blob->refcount, 1) == 1) {
+        free(blob);
+    }
+}
+
+static int cache_entry_matches(const dns_cache_entry_t* entry, const dns_cache_key_t* key) {
+    return entry->key_len == key->len && entry->key_hash == key->hash &&
+           memcmp(cache_blob_key(entry->blob), key->data, key->len) == 0;
+}
+
+/**
+ * @brief 在一条哈希链中查找缓存条目
+ */
+static dns_cache_entry_t* cache_chain_find(dns_cache_entry_t* current, const dns_cache_key_t* key) {
+    while (current) {
+        if (cache_entry_matches(current, key)) {
+            return current;
+        }
+        current = current->hash_next;
+    }
+    return NULL;
+}
+
+/**
+ * @brief 内部函数：查找缓存条目（不检查过期，不移动LRU，调用方持有分段读锁或写锁）
+ * 再哈希期间尚未迁移的条目仍在旧桶数组中，当前桶数组未找到时再查旧桶
+ */
+static dns_cache_entry_t* dns_cache_find_entry_internal(dns_cache_segment_t* segment, const dns_cache_key_t* key) {
+    dns_cache_entry_t* entry = cache_chain_find(*get_cache_bucket(segment, key->hash), key);
+    if (!entry && segment->old_buckets) {
+        entry = cache_chain_find(segment->old_buckets[cache_bucket_index(key->hash, segment->old_bucket_mask)], key);
+    }
+    return entry;
+}
+
+/**
+ * @brief 将缓存报文拷贝到调用方缓冲区，并把各TTL改写为剩余时间（数据块只读，无需持锁）
+ */
+static void cache_blob_copy_packet(const dns_cache_blob_t* blob, time_t now, char* packet_buf) {
+    memcpy(packet_buf, blob->data, blob->packet_len);
+
+    unsigned int elapsed = now > blob->insert_time ? (unsigned int)(now - blob->insert_time) : 0;
+    for (int i = 0; i < blob->ttl_count; i++) {
+        unsigned int ttl = wire_read_u32(blob->data + blob->ttl_offsets[i]);
+        wire_write_u32(packet_buf + blob->ttl_offsets[i], ttl > elapsed ? ttl - elapsed : 0);
+    }
+}
+
+/**
+ * @brief 记录一次命中，并判断是否由本次命中认领对条目的预取刷新（调用方持有分段读锁）
+ *
+ * 命中计数只累加到预取门槛，此后热点条目不再产生写；剩余TTL进入预取窗口后，
+ * 多个并发命中中只有CAS成功的一个认领刷新，认领后DNS_CACHE_PREFETCH_RETRY秒内不再重复发起。
+ *
+ * @return 需要发起预取返回1，否则返回0
+ */
+static int cache_entry_claim_refresh(dns_cache_entry_t* entry, time_t now) {
+    if (g_dns_cache.prefetch_percent == 0) return 0;
+    
+    if (platform_atomic_load_relaxed(&entry->hits) < g_dns_cache.prefetch_min_hits) {
+        platform_atomic_add_relaxed(&entry->hits, 1);
+        return 0;
+    }
+    
+    long long ttl = (long long)(entry->expire_time - entry->blob->insert_time);
+    long long remaining = (long long)(entry->expire_time - now);
+    if (remaining * 100 > ttl * g_dns_cache.prefetch_percent) return 0;
+    
+    time_t last = platform_atomic_load_relaxed(&entry->refresh_time);
+    if (last != 0 && now - last < DNS_CACHE_PREFETCH_RETRY) return 0;
+    return platform_atomic_cas_weak(&entry->refresh_time, &last, now);
+}
+
+/**
+ * @brief 从缓存获取DNS响应（分段读写锁版本，支持查询类型）
+ *
+ * 读锁只覆盖查找和取得数据块引用；报文拷贝、TTL改写在锁外完成，ID由调用方改写。
+ * 命中只原子置位条目的CLOCK访问位，不移动链表，因此热点域名的并发读取互不阻塞。
+ *
+ * @param packet_buf 输出缓冲区
+ * @param packet_buf_size 输出缓冲区大小
+ * @param needs_refresh 输出本次命中是否认领了预取刷新（可为NULL，此时不参与预取）
+ * @return 命中返回报文长度，未命中返回0
+ */
+int dns_cache_get(const dns_cache_key_t* key, char* packet_buf, int packet_buf_size, int* needs_refresh) {
+    if (needs_refresh) *needs_refresh = 0;
+    if (!key || !packet_buf) return 0;
+    
+    // 获取对应的分段
+    dns_cache_segment_t* segment = get_cache_segment(key->hash);
+    
+    dns_cache_blob_t* blob = NULL;
+    time_t now = cache_clock_now();
+    
+    // 获取读锁
+    platform_rwlock_rdlock(&segment->rwlock);
+    
+    dns_cache_entry_t* current = dns_cache_find_entry_internal(segment, key);
+    
+    if (current) {
+        if (now > current->expire_time) {
+            // 已过期，按未命中处理
+            log_debug("缓存条目已过期: %016llx", key->hash);
+        } else if (current->blob->packet_len <= packet_buf_size) {
+            // 访问位已置位时不再写，避免热点条目的缓存行在各核之间来回失效
+            if (!platform_atomic_load_relaxed(&current->referenced)) {
+                platform_atomic_store_relaxed(&current->referenced, 1);
+            }
+            // 持读锁期间缓存的引用不会被放弃，这里只需宽松地加一
+            blob = current->blob;
+            platform_atomic_add_relaxed(&blob->refcount, 1);
+            
+            if (needs_refresh && cache_entry_claim_refresh(current, now)) {
+                *needs_refresh = 1;
+                platform_atomic_add_relaxed(&segment->prefetches, 1);
+            }
+        }
+    }
+    
+    platform_rwlock_unlock(&segment->rwlock);
+    
+    if (!blob) {
+        platform_atomic_add_relaxed(&segment->misses, 1);
+        return 0;
+    }
+    
+    platform_atomic_add_relaxed(&segment->hits, 1);
+    cache_blob_copy_packet(blob, now, packet_buf);
+    int result = blob->packet_len;
+    cache_blob_release(blob);
+    return result;
+}
+
+/**
+ * @brief 设置条目的数据块和过期时间（调用方持有分段写锁或条目尚未发布）
+ */
+static void cache_entry_set_blob(dns_cache_entry_t* entry, dns_cache_blob_t* blob, time_t now, int ttl) {
+    entry->blob = blob;
+    entry->expire_time = now + ttl;
+    entry->referenced = 0;
+    entry->hits = 0;            // 新应答重新统计热度，预取认领随之清除
+    entry->refresh_time = 0;
+}
+
+/**
+ * @brief 放弃已摘除条目的数据块引用，并把槽位归还本段空闲栈（调用方持有分段写锁）
+ */
+static void cache_entry_release_slot(dns_cache_segment_t* segment, dns_cache_entry_t* entry) {
+    int slot = entry->slot;
+    cache_blob_release(entry->blob);
+    memset(entry, 0, sizeof(dns_cache_entry_t));
+    entry->slot = slot;
+    free_stack_push(&segment->free_slots, slot);
+}
+
+/**
+ * @brief 迁移至多max_buckets个旧哈希桶到当前桶数组，旧桶全部迁移后释放旧数组（调用方持有分段写锁）
+ */
+static void cache_rehash_step(dns_cache_segment_t* segment, unsigned int max_buckets) {
+    if (!segment->old_buckets) return;
+    
+    unsigned int old_count = segment->old_bucket_mask + 1;
+    for (unsigned int n = 0; n < max_buckets && segment->rehash_pos < old_count; n++) {
+        dns_cache_entry_t* current = segment->old_buckets[segment->rehash_pos];
+        segment->old_buckets[segment->rehash_pos++] = NULL;
+        while (current) {
+            dns_cache_entry_t* next = current->hash_next;
+            dns_cache_entry_t** bucket = get_cache_bucket(segment, current->key_hash);
+            current->hash_next = *bucket;
+            *bucket = current;
+            current = next;
+        }
+    }
+    
+    if (segment->rehash_pos >= old_count) {
+        free(segment->old_buckets);
+        segment->old_buckets = NULL;
+        segment->old_bucket_mask = 0;
+        segment->rehash_pos = 0;
+        log_debug("缓存分段再哈希完成，哈希桶: %u", segment->bucket_mask + 1);
+    }
+}
+
+/**
+ * @brief 按CLOCK算法淘汰至多max_evictions个条目，直到本段还能再容纳extra_entries个条目、
+ * extra_bytes字节而不超出条目数和字节预算（调用方持有分段写锁）
+ */
+static void cache_make_room(dns_cache_segment_t* segment, int extra_entries, size_t extra_bytes, int max_evictions) {
+    for (int n = 0; n < max_evictions && segment->current_size > 0 &&
+                    (segment->current_size + extra_entries > segment->max_size ||
+                     segment->bytes_used + extra_bytes > segment->max_bytes); n++) {
+        dns_cache_entry_t* evicted_entry = clock_evict_segment(segment);
+        if (!evicted_entry) break;
+        cache_entry_release_slot(segment, evicted_entry);
+    }
+}
+
+/**
+ * @brief 向缓存添加DNS响应（分段读写锁版本，支持查询类型）
+ *
+ * 保存报文副本及各资源记录TTL字段的偏移，缓存时长取报文中的最小TTL。
+ * 否定应答（NXDOMAIN，或NOERROR且没有回答记录的NODATA）的缓存时长不超过授权部分
+ * SOA记录的min(TTL, MINIMUM)，没有SOA记录的否定应答不缓存。
+ * 最小TTL为0的响应、TC置位的截断响应，以及RCODE不是NOERROR/NXDOMAIN的响应不缓存，
+ * 已有条目保持不变。
+ *
+ * @param packet 上游响应报文
+ * @param packet_len 报文长度
+ * @return 成功（或按TTL、截断、RCODE、缺少SOA无需缓存）返回MYSUCCESS，报文格式无法识别或内存不足返回MYERROR
+ */
+int dns_cache_put(const dns_cache_key_t* key, const char* packet, int packet_len) {
+    if (!key || !packet || packet_len < DNS_HEADER_SIZE) return MYERROR;
+    
+    // 截断的应答和SERVFAIL/REFUSED等错误应答不缓存，也不覆盖已有条目
+    unsigned short flags = (unsigned short)(((unsigned char)packet[2] << 8) | (unsigned char)packet[3]);
+    unsigned short rcode = flags & DNS_RCODE_MASK;
+    if ((flags & DNS_FLAG_TC) || (rcode != DNS_RCODE_NOERROR && rcode != DNS_RCODE_NXDOMAIN)) {
+        log_debug("响应被截断或RCODE=%u，不缓存: %016llx", rcode, key->hash);
+        return MYSUCCESS;
+    }
+    
+    // 定位各资源记录的TTL字段，并据此确定缓存时长
+    unsigned short ttl_offsets[DNS_CACHE_MAX_TTL_OFFSETS];
+    unsigned int min_ttl = DEFAULT_TTL;
+    unsigned int negative_ttl;
+    int ttl_count = wire_collect_ttl_offsets(packet, packet_len, ttl_offsets, DNS_CACHE_MAX_TTL_OFFSETS,
+                                             &min_ttl, &negative_ttl);
+    if (ttl_count < 0) {
+        log_debug("响应报文无法识别或资源记录过多，不缓存: %016llx", key->hash);
+        return MYERROR;
+    }
+    
+    // 否定应答按SOA确定缓存时长；没有SOA时无从得知应缓存多久，不缓存
+    unsigned short ancount = (unsigned short)(((unsigned char)packet[6] << 8) | (unsigned char)packet[7]);
+    if (rcode == DNS_RCODE_NXDOMAIN || ancount == 0) {
+        if (negative_ttl == DNS_CACHE_NO_NEGATIVE_TTL) {
+            log_debug("否定应答缺少SOA记录，不缓存: %016llx", key->hash);
+            return MYSUCCESS;
+        }
+        if (negative_ttl < min_ttl) {
+            min_ttl = negative_ttl;
+        }
+    }
+    if (min_ttl == 0) {
+        log_debug("响应TTL为0，不缓存: %016llx", key->hash);
+        return MYSUCCESS;
+    }
+    int ttl = min_ttl > DNS_CACHE_MAX_TTL ? DNS_CACHE_MAX_TTL : (int)min_ttl;
+    
+    time_t now = cache_clock_now();
+    
+    size_t charge = cache_entry_charge(packet_len, key->len);
+    
+    // 报文和缓存键放在同一个数据块中，由引用计数管理释放
+    dns_cache_blob_t* blob = cache_blob_create(key, packet, packet_len, ttl_offsets, ttl_count, ttl, now);
+    if (!blob) {
+        log_error("缓存报文内存分配失败: %016llx (%d 字节)", key->hash, packet_len);
+        return MYERROR;
+    }
+    
+    // 获取对应的分段
+    dns_cache_segment_t* segment = get_cache_segment(key->hash);
+    
+    // 获取写锁
+    platform_rwlock_wrlock(&segment->rwlock);
+    
+    // 单个条目超过分段字节预算时不缓存，以免一次写入清空整段
+    if (charge > segment->max_bytes) {
+        platform_rwlock_unlock(&segment->rwlock);
+        cache_blob_release(blob);
+        log_debug("响应超过分段字节预算，不缓存: %016llx (%zu 字节)", key->hash, charge);
+        return MYSUCCESS;
+    }
+    
+    // 容量调整后的再哈希由写入分摊推进
+    cache_rehash_step(segment, DNS_CACHE_REHASH_STEP);
+    
+    // 使用内部函数查找，无论是否过期
+    dns_cache_entry_t* entry = dns_cache_find_entry_internal(segment, key);
+    if (entry) {
+        // --- 路径A：找到了条目（无论是有效的还是过期的），执行原地更新 ---
+        log_debug("复用现有缓存槽位进行更新: %016llx", key->hash);
+        
+        // 1. 换上新的数据块和过期时间，旧数据块可能仍被读者引用；字节统计随之更换
+        dns_cache_blob_t* old_blob = entry->blob;
+        cache_segment_account(segment, entry, -1);
+        cache_wheel_unlink(entry);
+        cache_entry_set_blob(entry, blob, now, ttl);
+        cache_wheel_insert(segment, entry);
+        cache_segment_account(segment, entry, 1);
+        
+        // 2. 因为被更新，所以它是最新的，移动到分段链表头部
+        lru_move_to_head_segment(segment, entry);
+        
+        // 新响应更大时可能超出字节预算，从尾部淘汰其他条目（本条目刚移到头部）
+        cache_make_room(segment, 0, 0, DNS_CACHE_MAX_EVICT_PER_PUT);
+        
+        platform_rwlock_unlock(&segment->rwlock);
+        
+        // 3. 放弃缓存对旧数据块的引用
+        cache_blob_release(old_blob);
+        log_debug("原地更新缓存条目: %016llx", key->hash);
+        return MYSUCCESS;
+    }    
+    
+    // --- 路径B：完全没找到条目，这是一个全新的缓存键，执行插入 ---
+    log_debug("为新缓存键创建缓存条目: %016llx", key->hash);
+    
+    // 按CLOCK算法淘汰近期未被访问的条目，直到条目数和字节预算都能容纳新条目，槽位归还本段；
+    // 单次淘汰数有上限，缩容后的超额部分由后续写入和维护逐步收敛
+    cache_make_room(segment, 1, charge, DNS_CACHE_MAX_EVICT_PER_PUT);
+    
+    // 空闲槽位用尽而分段未满时追加一个槽位块（扩容后的槽位按需分配）
+    if (free_stack_is_empty(&segment->free_slots) && cache_segment_add_chunk(segment) != MYSUCCESS) {
+        log_warn("缓存分段槽位块分配失败，当前大小: %d", segment->current_size);
+    }
+    
+    // 从本段空闲栈获取槽位（全程持有本段写锁，不涉及其他分段）
+    int free_index = free_stack_is_empty(&segment->free_slots) ? -1 : free_stack_pop(&segment->free_slots);
+    if (free_index < 0) {
+        platform_rwlock_unlock(&segment->rwlock);
+        log_error("无法从分段空闲栈获取缓存条目");
+        cache_blob_release(blob);
+        return MYERROR;
+    }
+    
+    dns_cache_entry_t* new_entry = cache_slot_entry(segment, free_index);
+    
+    // 填充条目
+    new_entry->key_hash = key->hash;
+    new_entry->key_len = key->len;
+    cache_entry_set_blob(new_entry, blob, now, ttl);
+    new_entry->prev = NULL;
+    new_entry->next = NULL;
+    
+    // 插入哈希桶
+    dns_cache_entry_t** bucket = get_cache_bucket(segment, key->hash);
+    new_entry->hash_next = *bucket;
+    *bucket = new_entry;
+    
+    int chain = 0;
+    for (dns_cache_entry_t* e = new_entry; e; e = e->hash_next) chain++;
+    if (chain > segment->max_chain) segment->max_chain = chain;
+    
+    // 插入分段链表头部，并按过期时间挂到时间轮上
+    lru_move_to_head_segment(segment, new_entry);
+    cache_wheel_insert(segment, new_entry);
+    segment->current_size++;
+    cache_segment_account(segment, new_entry, 1);
+    
+    platform_rwlock_unlock(&segment->rwlock);
+    
+    log_debug("添加新缓存条目: %016llx, TTL: %d, 分段当前大小: %d", key->hash, ttl, segment->current_size);
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 在线调整缓存总容量和字节预算（不停止服务）
+ *
+ * 每段只在写锁下做常数时间的切换：更新容量，需要时换上预先分配好的新桶数组并开始渐进式再哈希。
+ * 扩容的槽位在写入时按块追加；缩容的超额条目由后续写入和dns_cache_maintain()逐步淘汰，
+ * 已分配的槽位块保留在空闲栈中复用。上一次调整的再哈希尚未完成时先在写锁下完成它。
+ * 多次调整由resize_lock串行执行，桶数组是否需要更换在写锁内重新判断。
+ *
+ * @param max_size 新的缓存总容量（分段数不变，0表示保持不变）
+ * @param max_bytes 新的总字节预算（0表示保持不变）
+ * @return 成功返回MYSUCCESS，缓存未初始化或参数无效返回MYERROR
+ */
+int dns_cache_resize(int max_size, size_t max_bytes) {
+    if (!g_dns_cache.segments || max_size < 0) return MYERROR;
+    
+    platform_mutex_lock(&g_dns_cache.resize_lock);
+    int old_max_size = g_dns_cache.max_size;
+    size_t old_max_bytes = g_dns_cache.max_bytes;
+    if (max_size == 0) max_size = old_max_size;
+    if (max_size > DNS_CACHE_MAX_SIZE) max_size = DNS_CACHE_MAX_SIZE;
+    if (max_bytes == 0) max_bytes = old_max_bytes;
+    size_t segment_max_bytes = max_bytes / g_dns_cache.num_segments;
+    
+    int segment_max_size = max_size / g_dns_cache.num_segments;
+    if (segment_max_size <= 0) segment_max_size = 1;
+    unsigned int bucket_count = cache_bucket_count_for(segment_max_size);
+    
+    for (int i = 0; i < g_dns_cache.num_segments; i++) {
+        dns_cache_segment_t* segment = &g_dns_cache.segments[i];
+        
+        // 新桶数组在锁外分配，写锁内只做指针切换
+        platform_rwlock_rdlock(&segment->rwlock);
+        int need_rehash = segment->bucket_mask + 1 != bucket_count;
+        platform_rwlock_unlock(&segment->rwlock);
+        
+        dns_cache_entry_t** buckets = NULL;
+        if (need_rehash) {
+            buckets = (dns_cache_entry_t**)calloc(bucket_count, sizeof(dns_cache_entry_t*));
+            if (!buckets) {
+                log_warn("缓存分段%d新桶数组分配失败，保留原桶数组", i);
+            }
+        }
+        
+        platform_rwlock_wrlock(&segment->rwlock);
+        if (buckets && segment->bucket_mask + 1 != bucket_count) {
+            cache_rehash_step(segment, segment->old_bucket_mask + 1);
+            segment->old_buckets = segment->hash_buckets;
+            segment->old_bucket_mask = segment->bucket_mask;
+            segment->rehash_pos = 0;
+            segment->hash_buckets = buckets;
+            segment->bucket_mask = bucket_count - 1;
+            segment->max_chain = 0;
+            buckets = NULL;
+        }
+        segment->max_size = segment_max_size;
+        segment->max_bytes = segment_max_bytes;
+        platform_rwlock_unlock(&segment->rwlock);
+        free(buckets);
+    }
+    
+    g_dns_cache.max_size = max_size;
+    g_dns_cache.max_bytes = max_bytes;
+    platform_mutex_unlock(&g_dns_cache.resize_lock);
+    
+    log_info("DNS缓存容量调整: %d -> %d，字节预算: %zu -> %zu，每段容量: %d, 每段哈希桶: %u",
+             old_max_size, max_size, old_max_bytes, max_bytes, segment_max_size, bucket_count);
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 从缓存配置文件读取容量选项，覆盖config中对应的字段
+ *
+ * 每行一个选项，格式为"选项名 值"，#开头的行和空行忽略；选项名与命令行参数相同（不含前缀--）：
+ * cache-size（条目数）、cache-memory（MB）。未出现的选项保持config原值，无法识别的行给出警告。
+ *
+ * @return 成功返回MYSUCCESS，文件无法打开返回MYERROR
+ */
+int dns_cache_config_load(const char* filename, dns_cache_config_t* config) {
+    if (!filename || !config) return MYERROR;
+    
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        log_error("无法打开缓存配置文件: %s", filename);
+        return MYERROR;
+    }
+    
+    char line[256];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        char name[64];
+        char value[64];
+        int fields = sscanf(line, "%63s %63s", name, value);
+        if (fields <= 0 || name[0] == '#') continue;
+        
+        if (fields == 2 && strcmp(name, "cache-size") == 0) {
+            config->max_size = atoi(value);
+        } else if (fields == 2 && strcmp(name, "cache-memory") == 0) {
+            config->max_bytes = (size_t)strtoul(value, NULL, 10) << 20;
+        } else {
+            log_warn("缓存配置文件 %s 第%d行无法识别，已忽略", filename, line_number);
+        }
+    }
+    
+    fclose(file);
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 重新读取缓存配置文件并在线调整容量（收到重载信号时调用）
+ *
+ * 文件中未给出的选项保持当前值；分段数和预取参数在运行期间不变。
+ *
+ * @return 成功返回MYSUCCESS，文件无法读取或调整失败返回MYERROR
+ */
+int dns_cache_reload_config(const char* filename) {
+    dns_cache_config_t config;
+    dns_cache_config_init(&config);
+    if (dns_cache_config_load(filename, &config) != MYSUCCESS) return MYERROR;
+    
+    log_info("重新加载缓存配置: %s", filename);
+    return dns_cache_resize(config.max_size > 0 ? config.max_size : 0, config.max_bytes);
+}
+
+/**
+ * @brief 缓存维护：推进各分段未完成的再哈希，并淘汰超出条目数或字节预算的条目（由缓存维护线程周期调用）
+ *
+ * 每段每次至多处理DNS_CACHE_MAINTAIN_STEP个桶或条目，没有待办工作的分段只取读锁检查。
+ */
+void dns_cache_maintain(void) {
+    if (!g_dns_cache.segments) return;
+    
+    for (int i = 0; i < g_dns_cache.num_segments; i++) {
+        dns_cache_segment_t* segment = &g_dns_cache.segments[i];
+        platform_rwlock_rdlock(&segment->rwlock);
+        int pending = segment->old_buckets || segment->current_size > segment->max_size ||
+                      segment->bytes_used > segment->max_bytes;
+        platform_rwlock_unlock(&segment->rwlock);
+        if (!pending) continue;
+        
+        platform_rwlock_wrlock(&segment->rwlock);
+        cache_rehash_step(segment, DNS_CACHE_MAINTAIN_STEP);
+        cache_make_room(segment, 0, 0, DNS_CACHE_MAINTAIN_STEP);
+        platform_rwlock_unlock(&segment->rwlock);
+    }
+}
+
+/**
+ * @brief 把高层时间轮槽位中的条目按当前刻度重新分配到更低的层（调用方持有分段写锁）
+ */
+static void cache_wheel_cascade(dns_cache_segment_t* segment, int level) {
+    unsigned long long tick = (unsigned long long)segment->wheel_time;
+    dns_cache_entry_t** head = &segment->wheel[level][(tick >> (DNS_CACHE_WHEEL_BITS * level)) & (DNS_CACHE_WHEEL_SLOTS - 1)];
+    dns_cache_entry_t* current = *head;
+    *head = NULL;
+    
+    while (current) {
+        dns_cache_entry_t* next = current->wheel_next;
+        cache_wheel_insert(segment, current);
+        current = next;
+    }
+}
+
+/**
+ * @brief 推进分段时间轮：依次处理早于now的刻度，回收至多max_expire个过期条目（调用方持有分段写锁）
+ *
+ * 第0层当前刻度槽位中的条目恰好在该刻度过期；处理完一个刻度后进入下一刻度，
+ * 跨过高层槽位边界时把对应槽位的条目降层。回收数达到上限时停在当前刻度，下次继续。
+ *
+ * @return 回收的条目数
+ */
+static int cache_wheel_advance(dns_cache_segment_t* segment, time_t now, int max_expire) {
+    // 空分段的时间轮上没有条目，直接跳到当前时间
+    if (segment->current_size == 0) {
+        if (segment->wheel_time < now) segment->wheel_time = now;
+        return 0;
+    }
+    
+    int expired = 0;
+    for (int ticks = 0; segment->wheel_time < now && ticks < DNS_CACHE_WHEEL_MAX_TICKS; ticks++) {
+        dns_cache_entry_t** head = &segment->wheel[0][(unsigned long long)segment->wheel_time & (DNS_CACHE_WHEEL_SLOTS - 1)];
+        while (*head) {
+            if (expired >= max_expire) return expired;
+            
+            dns_cache_entry_t* entry = *head;
+            cache_segment_remove(segment, entry);
+            cache_entry_release_slot(segment, entry);
+            segment->expirations++;
+            expired++;
+        }
+        
+        segment->wheel_time++;
+        unsigned long long tick = (unsigned long long)segment->wheel_time;
+        for (int level = 1; level < DNS_CACHE_WHEEL_LEVELS &&
+                            (tick & ((1ULL << (DNS_CACHE_WHEEL_BITS * level)) - 1)) == 0; level++) {
+            cache_wheel_cascade(segment, level);
+        }
+    }
+    return expired;
+}
+
+/**
+ * @brief 清理过期的缓存条目（分段版本）
+ *
+ * 逐段推进时间轮，每段每次至多回收DNS_CACHE_EXPIRE_BATCH个条目，槽位立即归还本段空闲栈；
+ * 时间轮已追上当前时间的分段只取读锁检查。由缓存维护线程周期调用。
+ */
+void dns_cache_cleanup_expired() {
+    if (!g_dns_cache.segments) return;
+    
+    time_t now = cache_clock_now();
+    int total_cleaned = 0;
+    
+    for (int seg = 0; seg < g_dns_cache.num_segments; seg++) {
+        dns_cache_segment_t* segment = &g_dns_cache.segments[seg];
+        platform_rwlock_rdlock(&segment->rwlock);
+        int pending = segment->wheel_time < now;
+        platform_rwlock_unlock(&segment->rwlock);
+        if (!pending) continue;
+        
+        platform_rwlock_wrlock(&segment->rwlock);
+        total_cleaned += cache_wheel_advance(segment, now, DNS_CACHE_EXPIRE_BATCH);
+        platform_rwlock_unlock(&segment->rwlock);
+    }
+    
+    if (total_cleaned > 0) {
+        log_debug("清理了 %d 个过期缓存条目", total_cleaned);
+    }
+}
+
+/**
+ * @brief 缓存维护线程：周期更新粗粒度时钟，推进时间轮回收过期条目，并执行再哈希和超额淘汰
+ */
+static THREAD_RETURN_TYPE dns_cache_housekeeper_main(void* arg) {
+    (void)arg;
+    
+    platform_mutex_lock(&g_dns_cache.housekeeper_lock);
+    while (g_dns_cache.housekeeper_running) {
+        platform_cond_timedwait(&g_dns_cache.housekeeper_cond, &g_dns_cache.housekeeper_lock, DNS_CACHE_HOUSEKEEPING_MS);
+        if (!g_dns_cache.housekeeper_running) break;
+        platform_mutex_unlock(&g_dns_cache.housekeeper_lock);
+        
+        platform_atomic_store_relaxed(&g_dns_cache.clock, time(NULL));
+        dns_cache_cleanup_expired();
+        dns_cache_maintain();
+        
+        platform_mutex_lock(&g_dns_cache.housekeeper_lock);
+    }
+    platform_mutex_unlock(&g_dns_cache.housekeeper_lock);
+    return THREAD_RETURN_VALUE;
+}
+
+/**
+ * @brief 启动缓存维护线程
+ * @return 成功返回MYSUCCESS，失败返回MYERROR
+ */
+static int dns_cache_housekeeper_start(void) {
+    platform_mutex_init(&g_dns_cache.housekeeper_lock, NULL);
+    platform_cond_init(&g_dns_cache.housekeeper_cond, NULL);
+    g_dns_cache.housekeeper_running = 1;
+    
+    if (platform_thread_create(&g_dns_cache.housekeeper, NULL, dns_cache_housekeeper_main, NULL) != 0) {
+        log_error("缓存维护线程创建失败");
+        g_dns_cache.housekeeper_running = 0;
+        platform_cond_destroy(&g_dns_cache.housekeeper_cond);
+        platform_mutex_destroy(&g_dns_cache.housekeeper_lock);
+        return MYERROR;
+    }
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 通知缓存维护线程退出并等待其结束
+ */
+static void dns_cache_housekeeper_stop(void) {
+    // 运行标志只由启动和停止方写入，未启动或已停止时锁也已销毁
+    if (!g_dns_cache.housekeeper_running) return;
+    
+    platform_mutex_lock(&g_dns_cache.housekeeper_lock);
+    g_dns_cache.housekeeper_running = 0;
+    platform_cond_signal(&g_dns_cache.housekeeper_cond);
+    platform_mutex_unlock(&g_dns_cache.housekeeper_lock);
+    
+    platform_thread_join(g_dns_cache.housekeeper, NULL);
+    platform_cond_destroy(&g_dns_cache.housekeeper_cond);
+    platform_mutex_destroy(&g_dns_cache.housekeeper_lock);
+}
+
+/**
+ * @brief 汇总各分段的命中/未命中计数
+ */
+static void dns_cache_sum_counters(unsigned long* hits, unsigned long* misses) {
+    *hits = 0;
+    *misses = 0;
+    for (int i = 0; i < g_dns_cache.num_segments; i++) {
+        *hits += platform_atomic_load_relaxed(&g_dns_cache.segments[i].hits);
+        *misses += platform_atomic_load_relaxed(&g_dns_cache.segments[i].misses);
+    }
+}
+
+/**
+ * @brief 打印缓存统计信息（分段版本）
+ */
+void dns_cache_print_stats() {
+    if (!g_dns_cache.segments) return;
+    
+    unsigned long cache_hits, cache_misses;
+    dns_cache_sum_counters(&cache_hits, &cache_misses);
+    
+    double hit_rate = 0.0;
+    unsigned long total_requests = cache_hits + cache_misses;
+    if (total_requests > 0) {
+        hit_rate = (double)cache_hits / total_requests * 100.0;
+    }
+    
+    // 计算总的缓存使用量、字节占用、大小分布和最长冲突链
+    int total_current_size = 0;
+    int max_chain = 0;
+    size_t bytes_used = 0;
+    int size_classes[DNS_CACHE_SIZE_CLASSES] = {0};
+    unsigned long cache_evictions = 0;
+    unsigned long cache_expirations = 0;
+    unsigned long cache_prefetches = 0;
+    for (int i = 0; i < g_dns_cache.num_segments; i++) {
+        dns_cache_segment_t* segment = &g_dns_cache.segments[i];
+        total_current_size += segment->current_size;
+        bytes_used += segment->bytes_used;
+        cache_evictions += segment->evictions;
+        cache_expirations += segment->expirations;
+        cache_prefetches += platform_atomic_load_relaxed(&segment->prefetches);
+        for (int k = 0; k < DNS_CACHE_SIZE_CLASSES; k++) {
+            size_classes[k] += segment->size_classes[k];
+        }
+        if (segment->max_chain > max_chain) max_chain = segment->max_chain;
+    }
+    
+    // 大小分布：每档的上限字节数及条目数，最后一档不设上限
+    char distribution[256];
+    int written = 0;
+    for (int k = 0; k < DNS_CACHE_SIZE_CLASSES && written < (int)sizeof(distribution); k++) {
+        written += snprintf(distribution + written, sizeof(distribution) - written,
+                            k < DNS_CACHE_SIZE_CLASSES - 1 ? "%s<=%u:%d" : "%s>%u:%d",
+                            k ? " " : "", 128u << (k < DNS_CACHE_SIZE_CLASSES - 1 ? k : k - 1), size_classes[k]);
+    }
+    
+    platform_mutex_lock(&g_dns_cache.resize_lock);
+    int max_size = g_dns_cache.max_size;
+    size_t max_bytes = g_dns_cache.max_bytes;
+    platform_mutex_unlock(&g_dns_cache.resize_lock);
+    
+    log_info("=== DNS分段式缓存统计 ===");
+    log_info("当前大小: %d/%d", total_current_size, max_size);
+    log_info("字节占用: %zu/%zu，平均条目: %zu 字节", bytes_used, max_bytes,
+             total_current_size > 0 ? bytes_used / total_current_size : 0);
+    log_info("条目大小分布（字节）: %s", distribution);
+    log_info("分段数量: %d", g_dns_cache.num_segments);
+    log_info("缓存命中: %lu", cache_hits);
+    log_info("缓存未命中: %lu", cache_misses);
+    log_info("缓存驱逐: %lu", cache_evictions);
+    log_info("过期回收: %lu", cache_expirations);
+    log_info("预取刷新: %lu", cache_prefetches);
+    log_info("命中率: %.2f%%", hit_rate);
+    log_info("最长哈希冲突链: %d", max_chain);
+}
+
+/**
+ * @brief 销毁DNS缓存（分段版本）
+ */
+void dns_cache_destroy() {
+    if (!g_dns_cache.segments) return;
+    
+    // 先停止维护线程，再释放所有响应数据块和各分段的桶数组、槽位、空闲栈和锁
+    dns_cache_housekeeper_stop();
+    
+    for (int i = 0; i < g_dns_cache.num_segments; i++) {
+        dns_cache_segment_t* segment = &g_dns_cache.segments[i];
+        for (int k = 0; k < segment->chunk_count * DNS_CACHE_SLAB_CHUNK; k++) {
+            cache_blob_release(cache_slot_entry(segment, k)->blob);
+        }
+    }
+    dns_cache_free_segments(g_dns_cache.num_segments);
+    platform_mutex_destroy(&g_dns_cache.resize_lock);
+    
+    log_info("DNS分段式缓存已销毁");
+}
+// ============================================================================
+// 对外接口函数（用于集成到现有系统）
+// ============================================================================
+
+
+// ============================================================================
+// 统一查询接口实现
+// ============================================================================
+
+
+/**
+ * @brief 统一DNS查询接口
+ * 实现三级查询：本地表 -> 缓存 -> 上游DNS
+ *
+ * 结果写入调用方提供的结构体，缓存命中时响应报文（TTL已改写为剩余时间）写入packet_buf，
+ * 整个查询过程不分配内存。只使用请求的第一个问题；本地表按点分域名和类型匹配，
+ * 缓存键直接取自线路格式查询名。
+ *
+ * @param request 只解析了问题部分的请求视图（至少含一个问题）
+ * @param response 输出查询结果
+ * @param packet_buf 缓存命中时的报文输出缓冲区
+ * @param packet_buf_size 缓冲区大小
+ * @return 成功返回MYSUCCESS，参数无效或查询名含'.'/NUL标签返回MYERROR（不查本地表和缓存）
+ */
+int dns_relay_query(const dns_msg_view_t* request, dns_query_response_t* response,
+                    char* packet_buf, int packet_buf_size) {
+    if (!request || request->question_count == 0 || !response) return MYERROR;
+
+    const dns_question_view_t* question = &request->questions[0];
+    unsigned short qtype = question->qtype;
+    char domain[DNS_NAME_BUF_SIZE];
+    if (dns_msg_view_read_name(request, question->name_offset, domain, sizeof(domain)) < 0) return MYERROR;
+    
+    memset(response, 0, sizeof(dns_query_response_t));
+    
+    // 第一步：查询本地域名表
+    ip_address_entry_t* local_entry = domain_table_lookup(domain, qtype);
+    if (local_entry) {
+        // 检查是否为阻止地址
+        int is_blocked = 0;
+        if (qtype == A && strcmp(local_entry->ip, "0.0.0.0") == 0) {
+            is_blocked = 1;
+        } else if (qtype == AAAA && strcmp(local_entry->ip, "::") == 0) {
+            is_blocked = 1;
+        }
+        
+        if (is_blocked) {
+            response->result_type = QUERY_RESULT_BLOCKED;
+            log_info("域名被阻止: %s (type:%u)", domain, qtype);
+        } else {
+            response->result_type = QUERY_RESULT_LOCAL_HIT;
+            strncpy(response->resolved_ip, local_entry->ip, MAX_IP_LENGTH - 1);
+            log_info("本地表命中: %s (type:%u) -> %s", domain, qtype, local_entry->ip);
+        }
+        response->answer = local_entry->answer;
+        
+        return MYSUCCESS;
+    }
+    
+    // 第二步：查询缓存
+    dns_cache_key_t key;
+    int packet_len = 0;
+    if (packet_buf && dns_cache_key_init(&key, request, question) == MYSUCCESS) {
+        packet_len = dns_cache_get(&key, packet_buf, packet_buf_size, &response->needs_refresh);
+    }
+    if (packet_len > 0) {
+        response->result_type = QUERY_RESULT_CACHE_HIT;
+        response->packet_len = packet_len;
+        log_info("缓存命中: %s (type:%u)", domain, qtype);
+        return MYSUCCESS;
+    }
+    
+    // 第三步：需要查询上游DNS
+    response->result_type = QUERY_RESULT_CACHE_MISS;
+    log_debug("需要查询上游DNS: %s (type:%u)", domain, qtype);
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 初始化DNScache缓存和本地查询表
+ * @param cache_config 缓存配置（NULL时容量和分段数按CPU核心数推导）
+ */
+int dns_relay_init(const char* domain_file, const dns_cache_config_t* cache_config) {
+    log_info("初始化DNS中继服务（域名哈希内核: %s）...", name_hash_kernel_name());
+    
+    // 生成哈希密钥，必须早于任何表的建立
+    if (!name_hash_init()) {
+        log_warn("无法读取系统随机数，哈希密钥退化为时间混合");
+    }
+    
+    // 初始化本地域名表
+    if (domain_table_init() != MYSUCCESS) {
+        log_error("本地域名表初始化失败");
+        return MYERROR;
+    }
+    
+    // 加载域名表文件
+    if (domain_file && domain_table_load_from_file(domain_file) != MYSUCCESS) {
+        log_warn("加载域名表文件失败，继续运行");
+    }
+    
+    // 初始化DNS缓存
+    if (dns_cache_init(cache_config) != MYSUCCESS) {
+        log_error("DNS缓存初始化失败");
+        domain_table_destroy();
+        return MYERROR;
+    }
+    
+    log_info("DNS中继服务初始化完成");
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 清理DNScache缓存和本地查询表
+ */
+void dns_relay_cleanup(void) {
+    log_info("清理DNS中继服务...");
+    
+    // 打印统计信息
+    dns_cache_print_stats();
+    
+    // 清理资源
+    dns_cache_destroy();
+    domain_table_destroy();
+    
+    log_info("DNS中继服务已清理完成");
+}
+
+
+/**
+ * @brief 向缓存添加上游DNS响应
+ * 这个函数用于在收到上游DNS响应后将其添加到缓存，缓存键取自响应的第一个问题
+ * @param view 已完整解析的响应视图（至少含一个问题）
+ * @return 成功返回MYSUCCESS，查询名含'.'/NUL标签或无法缓存返回MYERROR
+ */
+int dns_relay_cache_response(const dns_msg_view_t* view) {
+    if (!view || view->question_count == 0) return MYERROR;
+
+    // 与查询路径一致：点分格式有歧义的查询名不进入缓存
+    const dns_question_view_t* question = &view->questions[0];
+    char domain[DNS_NAME_BUF_SIZE];
+    if (dns_msg_view_read_name(view, question->name_offset, domain, sizeof(domain)) < 0) return MYERROR;
+
+    dns_cache_key_t key;
+    if (dns_cache_key_init(&key, view, question) != MYSUCCESS) return MYERROR;
+
+    // 缓存时长由报文中的最小TTL决定
+    return dns_cache_put(&key, view->packet, view->packet_len);
+}
+
+/**
+ * @brief 获取全局域名表和缓存的引用（用于统计）
+ */
+void dns_relay_get_stats(int* domain_count, int* cache_size, unsigned long* cache_hits, unsigned long* cache_misses) {
+    if (domain_count) *domain_count = g_domain_table.total_entry_count;
+    
+    if (cache_size) {
+        // 计算所有分段的总缓存大小
+        int total_size = 0;
+        for (int i = 0; i < g_dns_cache.num_segments; i++) {
+            total_size += g_dns_cache.segments[i].current_size;
+        }
+        *cache_size = total_size;
+    }
+    
+    if (cache_hits || cache_misses) {
+        unsigned long hits, misses;
+        dns_cache_sum_counters(&hits, &misses);
+        if (cache_hits) *cache_hits = hits;
+        if (cache_misses) *cache_misses = misses;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "Thread/task_pool.h"
+#include "websocket/websocket.h"
+#include "debug/debug.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char* tier_names[TASK_TIER_COUNT] = { "小任务", "大任务", "按需分配" };
+
+#define FREE_HEAD_INDEX_MASK 0xFFFFFFFFULL
+
+// 由版本号和任务索引（-1表示栈空）打包栈顶
+static unsigned long long free_head_pack(unsigned long long version, int index) {
+    return (version << 32) | (unsigned long long)(unsigned int)(index + 1);
+}
+
+static int free_head_index(unsigned long long head) {
+    return (int)(head & FREE_HEAD_INDEX_MASK) - 1;
+}
+
+/**
+ * @brief 初始化单个分级：分配任务头和数据区，所有任务初始为空闲
+ */
+static int tier_pool_init(task_tier_pool_t* tier_pool, task_tier_t tier, int count, int buffer_size) {
+    memset(tier_pool, 0, sizeof(task_tier_pool_t));
+    if (count <= 0) {
+        return MYSUCCESS;  // 允许不启用某个分级
+    }
+
+    tier_pool->tasks = (dns_task_t*)calloc(count, sizeof(dns_task_t));
+    tier_pool->storage = (char*)malloc((size_t)count * buffer_size);
+    tier_pool->next_free = (int*)malloc(sizeof(int) * count);
+    if (!tier_pool->tasks || !tier_pool->storage || !tier_pool->next_free) {
+        log_error("%s分级内存分配失败，数量: %d", tier_names[tier], count);
+        free(tier_pool->tasks);
+        free(tier_pool->storage);
+        free(tier_pool->next_free);
+        return MYERROR;
+    }
+
+    // 初始时索引0位于栈顶，依次链接到count-1
+    for (int i = 0; i < count; i++) {
+        tier_pool->tasks[i].buffer = tier_pool->storage + (size_t)i * buffer_size;
+        tier_pool->tasks[i].buffer_capacity = buffer_size;
+        tier_pool->tasks[i].tier = tier;
+        tier_pool->tasks[i].pool_index = i;
+        tier_pool->next_free[i] = i + 1 < count ? i + 1 : -1;
+    }
+    tier_pool->buffer_size = buffer_size;
+    tier_pool->count = count;
+    tier_pool->free_head = free_head_pack(0, 0);
+    tier_pool->free_count = count;
+    return MYSUCCESS;
+}
+
+static void tier_pool_destroy(task_tier_pool_t* tier_pool) {
+    if (tier_pool->count == 0) return;
+
+    free(tier_pool->tasks);
+    free(tier_pool->storage);
+    free(tier_pool->next_free);
+    memset(tier_pool, 0, sizeof(task_tier_pool_t));
+}
+
+/**
+ * @brief 从分级中取出一个空闲任务，分级已耗尽返回NULL
+ */
+static dns_task_t* tier_pool_pop(task_tier_pool_t* tier_pool) {
+    if (tier_pool->count == 0) return NULL;
+
+    unsigned long long head = platform_atomic_load_acquire(&tier_pool->free_head);
+    int index;
+    for (;;) {
+        index = free_head_index(head);
+        if (index < 0) return NULL;
+
+        // 读取链接时该任务可能已被其他线程取走并归还，此时版本号已变化，CAS失败后重试
+        int next = platform_atomic_load_relaxed(&tier_pool->next_free[index]);
+        if (platform_atomic_cas_acq_rel(&tier_pool->free_head, &head, free_head_pack((head >> 32) + 1, next))) {
+            break;
+        }
+    }
+
+    platform_atomic_add_relaxed(&tier_pool->free_count, -1);
+    return &tier_pool->tasks[index];
+}
+
+/**
+ * @brief 将任务索引压回分级的空闲栈
+ */
+static void tier_pool_push(task_tier_pool_t* tier_pool, int index) {
+    unsigned long long head = platform_atomic_load_relaxed(&tier_pool->free_head);
+    do {
+        platform_atomic_store_relaxed(&tier_pool->next_free[index], free_head_index(head));
+    } while (!platform_atomic_cas_acq_rel(&tier_pool->free_head, &head, free_head_pack((head >> 32) + 1, index)));
+
+    platform_atomic_add_relaxed(&tier_pool->free_count, 1);
+}
+
+int task_pool_init(task_pool_t* pool, int small_count, int large_count) {
+    if (!pool) {
+        log_error("任务对象池初始化失败：参数无效");
+        return MYERROR;
+    }
+    memset(pool, 0, sizeof(task_pool_t));
+
+    if (tier_pool_init(&pool->tiers[TASK_TIER_SMALL], TASK_TIER_SMALL, small_count, TASK_BUFFER_SMALL_SIZE) != MYSUCCESS) {
+        return MYERROR;
+    }
+    if (tier_pool_init(&pool->tiers[TASK_TIER_LARGE], TASK_TIER_LARGE, large_count, TASK_BUFFER_LARGE_SIZE) != MYSUCCESS) {
+        tier_pool_destroy(&pool->tiers[TASK_TIER_SMALL]);
+        return MYERROR;
+    }
+    pool->is_initialized = 1;
+
+    log_info("任务对象池初始化成功：小任务 %d×%dB，大任务 %d×%dB，共 %.1f MB",
+             small_count, TASK_BUFFER_SMALL_SIZE, large_count, TASK_BUFFER_LARGE_SIZE,
+             ((double)small_count * TASK_BUFFER_SMALL_SIZE + (double)large_count * TASK_BUFFER_LARGE_SIZE) / (1024.0 * 1024.0));
+    return MYSUCCESS;
+}
+
+void task_pool_destroy(task_pool_t* pool) {
+    if (!pool || !pool->is_initialized) return;
+
+    tier_pool_destroy(&pool->tiers[TASK_TIER_SMALL]);
+    tier_pool_destroy(&pool->tiers[TASK_TIER_LARGE]);
+    pool->is_initialized = 0;
+    log_debug("任务对象池已销毁");
+}
+
+dns_task_t* task_pool_acquire(task_pool_t* pool, int packet_len) {
+    if (!pool || !pool->is_initialized || packet_len < 0) {
+        return NULL;
+    }
+
+    dns_task_t* task = NULL;
+
+    // 从能容纳数据包的最小分级开始尝试
+    task_tier_t tier = packet_len <= TASK_BUFFER_SMALL_SIZE ? TASK_TIER_SMALL : TASK_TIER_LARGE;
+    if (packet_len <= TASK_BUFFER_LARGE_SIZE) {
+        for (; tier < TASK_TIER_HEAP && !task; tier++) {
+            task = tier_pool_pop(&pool->tiers[tier]);
+        }
+    }
+
+    // 数据包超过大任务缓冲区或分级已耗尽：按需分配，任务头与缓冲区一次分配
+    if (!task) {
+        tier = TASK_TIER_HEAP;
+        task = (dns_task_t*)malloc(sizeof(dns_task_t) + (size_t)packet_len);
+        if (!task) {
+            platform_atomic_add_relaxed(&pool->acquire_failures, 1);
+            log_warn("任务分配失败，数据包长度: %d", packet_len);
+            return NULL;
+        }
+        memset(task, 0, sizeof(dns_task_t));
+        task->buffer = (char*)(task + 1);
+        task->buffer_capacity = packet_len;
+        task->tier = TASK_TIER_HEAP;
+        task->pool_index = -1;
+    } else {
+        tier = task->tier;
+    }
+
+    platform_atomic_add_relaxed(&pool->acquire_count[tier], 1);
+
+    task->buffer_len = 0;
+    return task;
+}
+
+void task_pool_release(task_pool_t* pool, dns_task_t* task) {
+    if (!pool || !task) return;
+
+    switch (task->tier) {
+        case TASK_TIER_SMALL:
+        case TASK_TIER_LARGE:
+            tier_pool_push(&pool->tiers[task->tier], task->pool_index);
+            break;
+        case TASK_TIER_HEAP:
+            free(task);
+            break;
+        default:
+            break;
+    }
+}
+
+int task_pool_available(task_pool_t* pool, task_tier_t tier) {
+    if (!pool || tier < TASK_TIER_SMALL || tier >= TASK_TIER_HEAP) return 0;
+
+    task_tier_pool_t* tier_pool = &pool->tiers[tier];
+    if (tier_pool->count == 0) return 0;
+
+    int available = platform_atomic_load_relaxed(&tier_pool->free_count);
+    return available < 0 ? 0 : available;
+}
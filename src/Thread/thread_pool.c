@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <stdint.h>
 
 // ============================================================================
 // 全局变量定义
@@ -17,20 +18,159 @@ static dns_thread_pool_t* g_thread_pool = NULL;
 // ============================================================================
 static int calculate_optimal_threads(void);
 static void update_worker_activity(worker_thread_t* worker);
-static void increment_stats_counter(dns_thread_pool_t* pool, const char* counter_type);
+static void worker_stats_increment(unsigned long* counter);
 
 // ============================================================================
 // 任务队列操作函数实现
 // ============================================================================
 
+#if TASK_QUEUE_LOCKFREE
+
+// 无锁MPMC环形队列（Vyukov有界队列）：
+// 每个槽位的sequence表示其轮次，入队方在sequence == pos时占用槽位，
+// 写入任务后把sequence置为pos+1交给出队方；出队方取走任务后置为pos+capacity交还入队方。
+// 生产者/消费者只在各自的位置上CAS，互不加锁；队列本身不挂起消费者，空闲工作线程在线程池的futex上挂起。
+
+int task_queue_init(task_queue_t* queue, int capacity) {
+    if (!queue || capacity <= 0) {
+        log_error("任务队列初始化失败：参数无效");
+        return MYERROR;
+    }
+
+    // 容量向上取整为2的幂，以便用掩码取模
+    size_t rounded = 1;
+    while (rounded < (size_t)capacity) {
+        rounded <<= 1;
+    }
+
+    memset(queue, 0, sizeof(task_queue_t));
+    queue->slots = (task_queue_slot_t*)malloc(sizeof(task_queue_slot_t) * rounded);
+    if (!queue->slots) {
+        log_error("任务队列初始化失败：内存分配失败");
+        return MYERROR;
+    }
+
+    for (size_t i = 0; i < rounded; i++) {
+        queue->slots[i].sequence = i;
+        queue->slots[i].task = NULL;
+    }
+    queue->capacity = (int)rounded;
+    queue->mask = rounded - 1;
+    return MYSUCCESS;
+}
+
+int task_queue_push(task_queue_t* queue, dns_task_t* task) {
+    if (!queue || !task) {
+        log_warn("任务入队失败：参数无效");
+        return MYERROR;
+    }
+
+    if (platform_atomic_load_relaxed(&queue->shutdown)) {
+        log_debug("任务入队失败：队列已关闭");
+        return MYERROR;
+    }
+
+    task_queue_slot_t* slot;
+    size_t pos = platform_atomic_load_relaxed(&queue->enqueue_pos);
+    for (;;) {
+        slot = &queue->slots[pos & queue->mask];
+        size_t seq = platform_atomic_load_acquire(&slot->sequence);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            // 槽位空闲，尝试占用
+            if (platform_atomic_cas_weak(&queue->enqueue_pos, &pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // 槽位仍被上一轮占用：队列已满
+            log_debug("任务入队失败：队列已满（%d）", queue->capacity);
+            return MYERROR;
+        } else {
+            // 其他生产者已推进位置，重新读取
+            pos = platform_atomic_load_relaxed(&queue->enqueue_pos);
+        }
+    }
+
+    slot->task = task;
+    platform_atomic_store_release(&slot->sequence, pos + 1);
+    return MYSUCCESS;
+}
+
+int task_queue_try_pop(task_queue_t* queue, dns_task_t** task) {
+    if (!queue || !task || !queue->slots) return 0;
+
+    task_queue_slot_t* slot;
+    size_t pos = platform_atomic_load_relaxed(&queue->dequeue_pos);
+    for (;;) {
+        slot = &queue->slots[pos & queue->mask];
+        size_t seq = platform_atomic_load_acquire(&slot->sequence);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+            if (platform_atomic_cas_weak(&queue->dequeue_pos, &pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0;  // 队列为空
+        } else {
+            pos = platform_atomic_load_relaxed(&queue->dequeue_pos);
+        }
+    }
+
+    *task = slot->task;
+    platform_atomic_store_release(&slot->sequence, pos + queue->mask + 1);
+    return 1;
+}
+
+int task_queue_size(task_queue_t* queue) {
+    if (!queue) return 0;
+
+    size_t dequeue_pos = platform_atomic_load_acquire(&queue->dequeue_pos);
+    size_t enqueue_pos = platform_atomic_load_acquire(&queue->enqueue_pos);
+    // 并发读取两个位置只得到近似值，限制在合法范围内
+    intptr_t size = (intptr_t)(enqueue_pos - dequeue_pos);
+    if (size < 0) size = 0;
+    if (size > queue->capacity) size = queue->capacity;
+    return (int)size;
+}
+
+int task_queue_is_empty(task_queue_t* queue) {
+    return task_queue_size(queue) == 0;
+}
+
+int task_queue_is_full(task_queue_t* queue) {
+    return queue ? task_queue_size(queue) >= queue->capacity : 0;
+}
+
+void task_queue_shutdown(task_queue_t* queue) {
+    if (!queue) return;
+
+    platform_atomic_store_release(&queue->shutdown, 1);
+}
+
+void task_queue_destroy(task_queue_t* queue) {
+    if (!queue) return;
+
+    task_queue_shutdown(queue);
+
+    // 释放内存
+    if (queue->slots) {
+        free(queue->slots);
+        queue->slots = NULL;
+    }
+
+    log_debug("任务队列已销毁");
+}
+
+#else
+
 int task_queue_init(task_queue_t* queue, int capacity) {
     if (!queue || capacity <= 0) {
         log_error("任务队列初始化失败：参数无效");
         return MYERROR;
     }
 
-    // 分配任务数组内存
-    queue->tasks = (dns_task_t*)malloc(sizeof(dns_task_t) * capacity);
+    // 分配任务指针数组内存
+    queue->tasks = (dns_task_t**)malloc(sizeof(dns_task_t*) * capacity);
     if (!queue->tasks) {
         log_error("任务队列初始化失败：内存分配失败");
         return MYERROR;
@@ -49,25 +189,10 @@ int task_queue_init(task_queue_t* queue, int capacity) {
         return MYERROR;
     }
 
-    if (platform_cond_init(&queue->not_empty, NULL) != 0) {
-        log_error("任务队列初始化失败：条件变量not_empty初始化失败");
-        platform_mutex_destroy(&queue->mutex);
-        free(queue->tasks);
-        return MYERROR;
-    }
-
-    if (platform_cond_init(&queue->not_full, NULL) != 0) {
-        log_error("任务队列初始化失败：条件变量not_full初始化失败");
-        platform_cond_destroy(&queue->not_empty);
-        platform_mutex_destroy(&queue->mutex);
-        free(queue->tasks);
-        return MYERROR;
-    }
-
     return MYSUCCESS;
 }
 
-int task_queue_push(task_queue_t* queue, const dns_task_t* task) {
+int task_queue_push(task_queue_t* queue, dns_task_t* task) {
     if (!queue || !task) {
         log_warn("任务入队失败：参数无效");
         return MYERROR;
@@ -85,73 +210,34 @@ int task_queue_push(task_queue_t* queue, const dns_task_t* task) {
     // 检查队列是否已满
     if (queue->count >= queue->capacity) {
         platform_mutex_unlock(&queue->mutex);
-        log_warn("任务入队失败：队列已满（%d/%d）", queue->count, queue->capacity);
+        log_debug("任务入队失败：队列已满（%d/%d）", queue->count, queue->capacity);
         return MYERROR;
     }
 
-    // 添加任务到队列
-    memcpy(&queue->tasks[queue->tail], task, sizeof(dns_task_t));
+    // 添加任务指针到队列
+    queue->tasks[queue->tail] = task;
     queue->tail = (queue->tail + 1) % queue->capacity;
     queue->count++;
-
-    // 通知等待的工作线程
-    platform_cond_signal(&queue->not_empty);
     platform_mutex_unlock(&queue->mutex);
 
     log_debug("任务成功入队，当前队列大小：%d/%d", queue->count, queue->capacity);
     return MYSUCCESS;
 }
 
-int task_queue_pop(task_queue_t* queue, dns_task_t* task, int timeout_ms) {
-    if (!queue || !task) {
-        log_warn("任务出队失败：参数无效");
-        return MYERROR;
-    }
+int task_queue_try_pop(task_queue_t* queue, dns_task_t** task) {
+    if (!queue || !task || !queue->tasks) return 0;
 
     platform_mutex_lock(&queue->mutex);
-
-    // 等待任务或关闭信号
-    while (queue->count == 0 && !queue->shutdown) {
-        int wait_result;
-        if (timeout_ms < 0) {
-            // 无限等待
-            wait_result = platform_cond_wait(&queue->not_empty, &queue->mutex);
-        } else {
-            // 超时等待
-            wait_result = platform_cond_timedwait(&queue->not_empty, &queue->mutex, timeout_ms);
-        }
-
-        if (wait_result > 0) {
-            // 超时
-            platform_mutex_unlock(&queue->mutex);
-            log_debug("任务出队超时");
-            return MYERROR;
-        } else if (wait_result < 0) {
-            // 其他错误
-            platform_mutex_unlock(&queue->mutex);
-            log_error("任务出队失败：条件变量等待错误");
-            return MYERROR;
-        }
-    }
-
-    // 检查是否因为关闭而退出等待
-    if (queue->shutdown && queue->count == 0) {
+    if (queue->count == 0) {
         platform_mutex_unlock(&queue->mutex);
-        log_debug("任务出队退出：队列已关闭");
-        return MYERROR;
+        return 0;
     }
 
-    // 从队列中取出任务
-    memcpy(task, &queue->tasks[queue->head], sizeof(dns_task_t));
+    *task = queue->tasks[queue->head];
     queue->head = (queue->head + 1) % queue->capacity;
     queue->count--;
-
-    // 通知可能等待的生产者
-    platform_cond_signal(&queue->not_full);
     platform_mutex_unlock(&queue->mutex);
-
-    log_debug("任务成功出队，当前队列大小：%d/%d", queue->count, queue->capacity);
-    return MYSUCCESS;
+    return 1;
 }
 
 int task_queue_size(task_queue_t* queue) {
@@ -184,18 +270,20 @@ int task_queue_is_full(task_queue_t* queue) {
     return full;
 }
 
-void task_queue_destroy(task_queue_t* queue) {
+void task_queue_shutdown(task_queue_t* queue) {
     if (!queue) return;
 
     platform_mutex_lock(&queue->mutex);
     queue->shutdown = 1;
-    platform_cond_broadcast(&queue->not_empty);
-    platform_cond_broadcast(&queue->not_full);
     platform_mutex_unlock(&queue->mutex);
+}
+
+void task_queue_destroy(task_queue_t* queue) {
+    if (!queue) return;
+
+    task_queue_shutdown(queue);
 
     // 销毁同步原语
-    platform_cond_destroy(&queue->not_empty);
-    platform_cond_destroy(&queue->not_full);
     platform_mutex_destroy(&queue->mutex);
 
     // 释放内存
@@ -207,85 +295,132 @@ void task_queue_destroy(task_queue_t* queue) {
     log_debug("任务队列已销毁");
 }
 
+#endif // TASK_QUEUE_LOCKFREE
+
 // ============================================================================
 // 工作线程函数实现
 // ============================================================================
 
-THREAD_RETURN_TYPE worker_thread_main(void* arg) {
-    dns_thread_pool_t* pool = (dns_thread_pool_t*)arg;
-    if (!pool) {
-        log_error("工作线程启动失败：线程池指针为空");
-        return THREAD_RETURN_VALUE;
+/**
+ * @brief 非阻塞获取任务：先取本地队列，再依次从相邻线程的队列窃取
+ *
+ * 本地队列一旦取空即发出批次中的响应，批次只在连续处理本地任务时累积，
+ * 不会在窃取、自旋或挂起期间滞留。
+ */
+static int worker_find_task(worker_thread_t* worker, dns_task_t** task) {
+    dns_thread_pool_t* pool = worker->pool;
+
+    if (task_queue_try_pop(&worker->local_queue, task)) {
+        return 1;
     }
 
-    // 找到当前线程的信息结构
-    // 由于线程ID比较的复杂性，我们使用一个简单的方法：
-    // 在创建线程时就设置好索引，这里通过遍历查找空闲的工作线程槽位
-    worker_thread_t* worker = NULL;
-    pthread_t self_id = platform_thread_self();
-    
-    // 简化的线程查找：使用第一个匹配的未活跃线程
-    for (int i = 0; i < pool->worker_count; i++) {
-        if (!pool->workers[i].is_active) {
-            worker = &pool->workers[i];
-            worker->thread_id = self_id;
-            break;
+    if (worker->send_batch.count > 0) {
+        send_batch_flush(&worker->send_batch);
+    }
+
+    for (int k = 1; k < pool->worker_count; k++) {
+        worker_thread_t* victim = &pool->workers[(worker->thread_index + k) % pool->worker_count];
+        if (task_queue_try_pop(&victim->local_queue, task)) {
+            worker_stats_increment(&worker->stolen_tasks);
+            return 1;
         }
     }
+    return 0;
+}
+
+/**
+ * @brief 获取下一个任务：短暂自旋后在线程池的futex上挂起，直到有新任务、超时或关闭
+ * @return 取到任务返回MYSUCCESS，超时或关闭返回MYERROR
+ */
+static int worker_wait_for_task(worker_thread_t* worker, dns_task_t** task, int timeout_ms) {
+    dns_thread_pool_t* pool = worker->pool;
 
-    if (!worker) {
-        log_error("工作线程启动失败：无法分配工作线程槽位");
+    for (int spin = 0; spin < TASK_QUEUE_SPIN_COUNT; spin++) {
+        if (worker_find_task(worker, task)) {
+            return MYSUCCESS;
+        }
+        if (platform_atomic_load_relaxed(&pool->shutdown_requested)) {
+            return MYERROR;
+        }
+        platform_cpu_relax();
+    }
+
+    // 登记为等待者后读取唤醒序号，再重试一次，避免错过登记前提交的任务
+    platform_atomic_fetch_add(&pool->sleepers, 1);
+    int wake_seq = platform_atomic_load_acquire(&pool->wake_seq);
+
+    if (worker_find_task(worker, task)) {
+        platform_atomic_fetch_sub(&pool->sleepers, 1);
+        return MYSUCCESS;
+    }
+    if (platform_atomic_load_acquire(&pool->shutdown_requested)) {
+        platform_atomic_fetch_sub(&pool->sleepers, 1);
+        return MYERROR;
+    }
+
+    platform_futex_wait(&pool->wake_seq, wake_seq, timeout_ms);
+    platform_atomic_fetch_sub(&pool->sleepers, 1);
+
+    return worker_find_task(worker, task) ? MYSUCCESS : MYERROR;
+}
+
+THREAD_RETURN_TYPE worker_thread_main(void* arg) {
+    worker_thread_t* worker = (worker_thread_t*)arg;
+    if (!worker || !worker->pool) {
+        log_error("工作线程启动失败：工作线程参数为空");
         return THREAD_RETURN_VALUE;
     }
+    dns_thread_pool_t* pool = worker->pool;
 
     log_debug("工作线程%d启动成功", worker->thread_index);
     worker->is_active = 1;
 
+    // 绑定本线程的批量发送缓冲区，处理过程中的响应只入批
+    if (pool->send_batch_size > 1) {
+        send_batch_bind_current_thread(&worker->send_batch);
+    }
+
     // 主工作循环
-    while (!pool->shutdown_requested) {
-        dns_task_t task;
-        
-        // 从队列获取任务
-        if (task_queue_pop(&pool->task_queue, &task, QUEUE_TIMEOUT_MS) != MYSUCCESS) {
-            continue; // 超时或错误，继续循环
+    while (!platform_atomic_load_relaxed(&pool->shutdown_requested)) {
+        dns_task_t* task;
+
+        // 获取任务（本地队列 -> 窃取 -> 挂起等待）
+        if (worker_wait_for_task(worker, &task, QUEUE_TIMEOUT_MS) != MYSUCCESS) {
+            continue; // 超时或关闭，继续循环
         }
 
         // 更新工作线程活动信息
         update_worker_activity(worker);
 
-        // 处理关闭任务
-        if (task.type == TASK_SHUTDOWN) {
-            log_debug("工作线程%d收到关闭信号", worker->thread_index);
-            break;
-        }
-
         // 处理DNS任务
-        log_debug("工作线程%d开始处理任务，类型：%d", worker->thread_index, task.type);
-
-        // 解析DNS数据包
-        DNS_ENTITY* dns_entity = parse_dns_packet(task.buffer, task.buffer_len);
-        if (!dns_entity) {
-            log_warn("工作线程%d：DNS数据包解析失败", worker->thread_index);
-            increment_stats_counter(pool, "dropped");
-            continue;
+        log_debug("工作线程%d开始处理任务，类型：%d", worker->thread_index, task->type);
+
+        // 所有报文都只按需解析：上游响应只改写ID后原样转发，客户端请求只解析头部和问题
+        if (task->type == TASK_UPSTREAM_RESPONSE) {
+            handle_upstream_responses(task->reply_socket, task->buffer, task->buffer_len, task->source_addr, task->source_addr_len);
+            worker_stats_increment(&worker->upstream_responses);
+        } else if (task->type == TASK_CLIENT_FORWARD) {
+            // I/O线程已校验报文并确认缓存未命中
+            forward_client_request(task->reply_socket, task->buffer, task->buffer_len, task->source_addr, task->source_addr_len);
+            worker_stats_increment(&worker->client_requests);
+        } else if (handle_client_requests(task->reply_socket, task->buffer, task->buffer_len,
+                                          task->source_addr, task->source_addr_len) == MYSUCCESS) {
+            worker_stats_increment(&worker->client_requests);
+        } else {
+            worker_stats_increment(&worker->dropped_tasks);
         }
 
-        // 根据任务类型分发处理
-        if (task.type == TASK_CLIENT_REQUEST) {
-            handle_client_requests(dns_entity, task.source_addr, task.source_addr_len, task.buffer_len);
-            increment_stats_counter(pool, "client_request");
-        } else if (task.type == TASK_UPSTREAM_RESPONSE) {
-            handle_upstream_responses(dns_entity, task.source_addr, task.source_addr_len, task.buffer_len);
-            increment_stats_counter(pool, "upstream_response");
-        }
+        // 处理完毕，归还任务缓冲区
+        task_pool_release(&pool->task_pool, task);
         
         // 更新统计信息
-        worker->processed_tasks++;
-        increment_stats_counter(pool, "processed");
+        worker_stats_increment(&worker->processed_tasks);
 
         log_debug("工作线程%d完成任务处理", worker->thread_index);
     }
 
+    send_batch_flush(&worker->send_batch);
+    send_batch_bind_current_thread(NULL);
     worker->is_active = 0;
     log_debug("工作线程%d退出", worker->thread_index);
     return THREAD_RETURN_VALUE;
@@ -320,27 +455,51 @@ int thread_pool_init(dns_thread_pool_t* pool,
     }
 
     pool->worker_count = worker_count;
+    pool->send_batch_size = DEFAULT_SEND_BATCH_SIZE;
     pool->server_socket = server_socket;
     pool->mapping_table = mapping_table;
 
     // 分配工作线程数组
-    pool->workers = (worker_thread_t*)malloc(sizeof(worker_thread_t) * worker_count);
+    pool->workers = (worker_thread_t*)calloc(worker_count, sizeof(worker_thread_t));
     if (!pool->workers) {
         log_error("线程池初始化失败：工作线程数组内存分配失败");
         return MYERROR;
     }
 
-    // 初始化工作线程信息
+    // 初始化工作线程信息及其本地队列（总容量平均分配，每个队列不少于WORKER_QUEUE_MIN_SIZE）
+    int local_capacity = queue_size / worker_count;
+    if (local_capacity < WORKER_QUEUE_MIN_SIZE) {
+        local_capacity = WORKER_QUEUE_MIN_SIZE;
+    }
     for (int i = 0; i < worker_count; i++) {
-        pool->workers[i].thread_index = i;
-        pool->workers[i].is_active = 0;
-        pool->workers[i].processed_tasks = 0;
-        pool->workers[i].last_activity = time(NULL);
+        worker_thread_t* worker = &pool->workers[i];
+        worker->thread_index = i;
+        worker->is_active = 0;
+        worker->processed_tasks = 0;
+        worker->stolen_tasks = 0;
+        worker->client_requests = 0;
+        worker->upstream_responses = 0;
+        worker->dropped_tasks = 0;
+        worker->last_activity = time(NULL);
+        worker->pool = pool;
+
+        if (task_queue_init(&worker->local_queue, local_capacity) != MYSUCCESS) {
+            log_error("线程池初始化失败：工作线程%d本地队列初始化失败", i);
+            for (int j = 0; j < i; j++) {
+                task_queue_destroy(&pool->workers[j].local_queue);
+            }
+            free(pool->workers);
+            return MYERROR;
+        }
+        pool->queue_capacity += worker->local_queue.capacity;
     }
 
-    // 初始化任务队列
-    if (task_queue_init(&pool->task_queue, queue_size) != MYSUCCESS) {
-        log_error("线程池初始化失败：任务队列初始化失败");
+    // 初始化任务对象池：小任务数与队列容量一致，大任务按比例预留，其余按需分配
+    if (task_pool_init(&pool->task_pool, queue_size, queue_size / TASK_POOL_LARGE_RATIO) != MYSUCCESS) {
+        log_error("线程池初始化失败：任务对象池初始化失败");
+        for (int i = 0; i < worker_count; i++) {
+            task_queue_destroy(&pool->workers[i].local_queue);
+        }
         free(pool->workers);
         return MYERROR;
     }
@@ -348,15 +507,10 @@ int thread_pool_init(dns_thread_pool_t* pool,
     // 初始化必要的互斥锁（移除mapping_table_mutex，已使用分段锁）
     if (platform_mutex_init(&pool->socket_mutex, NULL) != 0) {
         log_error("线程池初始化失败：Socket互斥锁初始化失败");
-        task_queue_destroy(&pool->task_queue);
-        free(pool->workers);
-        return MYERROR;
-    }
-
-    if (platform_mutex_init(&pool->stats_mutex, NULL) != 0) {
-        log_error("线程池初始化失败：统计互斥锁初始化失败");
-        platform_mutex_destroy(&pool->socket_mutex);
-        task_queue_destroy(&pool->task_queue);
+        task_pool_destroy(&pool->task_pool);
+        for (int i = 0; i < worker_count; i++) {
+            task_queue_destroy(&pool->workers[i].local_queue);
+        }
         free(pool->workers);
         return MYERROR;
     }
@@ -368,7 +522,8 @@ int thread_pool_init(dns_thread_pool_t* pool,
     pool->is_running = 0;
     pool->shutdown_requested = 0;
 
-    log_info("线程池初始化成功：%d个工作线程，队列容量：%d", worker_count, queue_size);
+    log_info("线程池初始化成功：%d个工作线程，本地队列容量：%d×%d",
+             worker_count, pool->workers[0].local_queue.capacity, worker_count);
     return MYSUCCESS;
 }
 
@@ -383,14 +538,29 @@ int thread_pool_start(dns_thread_pool_t* pool) {
         return MYSUCCESS;
     }
 
+    // 分配各工作线程的批量发送缓冲区
+    if (pool->send_batch_size > 1) {
+        for (int i = 0; i < pool->worker_count; i++) {
+            if (send_batch_init(&pool->workers[i].send_batch, pool->send_batch_size) != MYSUCCESS) {
+                log_error("线程池启动失败：工作线程%d批量发送缓冲区初始化失败", i);
+                for (int j = 0; j < i; j++) {
+                    send_batch_destroy(&pool->workers[j].send_batch);
+                }
+                return MYERROR;
+            }
+        }
+    }
+
     // 创建工作线程
     for (int i = 0; i < pool->worker_count; i++) {
         if (platform_thread_create(&pool->workers[i].thread_id, NULL, 
-                                  worker_thread_main, pool) != 0) {
+                                  worker_thread_main, &pool->workers[i]) != 0) {
             log_error("线程池启动失败：创建工作线程%d失败", i);
             
             // 清理已创建的线程
-            pool->shutdown_requested = 1;
+            platform_atomic_store_release(&pool->shutdown_requested, 1);
+            platform_atomic_fetch_add(&pool->wake_seq, 1);
+            platform_futex_wake(&pool->wake_seq, 0);
             for (int j = 0; j < i; j++) {
                 platform_thread_join(pool->workers[j].thread_id, NULL);
             }
@@ -412,23 +582,15 @@ int thread_pool_stop(dns_thread_pool_t* pool, int timeout_ms) {
     }
 
     log_debug("开始停止线程池...");
-    pool->shutdown_requested = 1;
 
-    // 向队列发送关闭任务
-    dns_task_t shutdown_task;
-    shutdown_task.type = TASK_SHUTDOWN;
-    shutdown_task.created_time = time(NULL);
-    
+    // 设置关闭标志并唤醒所有挂起的工作线程，随后关闭各本地队列（此后提交的任务入队失败）
+    platform_atomic_store_release(&pool->shutdown_requested, 1);
+    platform_atomic_fetch_add(&pool->wake_seq, 1);
+    platform_futex_wake(&pool->wake_seq, 0);
     for (int i = 0; i < pool->worker_count; i++) {
-        task_queue_push(&pool->task_queue, &shutdown_task);
+        task_queue_shutdown(&pool->workers[i].local_queue);
     }
 
-    // 关闭任务队列
-    platform_mutex_lock(&pool->task_queue.mutex);
-    pool->task_queue.shutdown = 1;
-    platform_cond_broadcast(&pool->task_queue.not_empty);
-    platform_mutex_unlock(&pool->task_queue.mutex);
-
     // 等待所有线程结束
     int success = 1;
     for (int i = 0; i < pool->worker_count; i++) {
@@ -460,15 +622,26 @@ void thread_pool_destroy(dns_thread_pool_t* pool) {
         thread_pool_stop(pool, 5000); // 5秒超时
     }
 
-    // 销毁任务队列
-    task_queue_destroy(&pool->task_queue);
+    // 归还各本地队列中未处理的任务，然后销毁队列和任务对象池
+    if (pool->is_initialized) {
+        for (int i = 0; i < pool->worker_count; i++) {
+            dns_task_t* pending_task;
+            while (task_queue_try_pop(&pool->workers[i].local_queue, &pending_task)) {
+                task_pool_release(&pool->task_pool, pending_task);
+            }
+            task_queue_destroy(&pool->workers[i].local_queue);
+        }
+    }
+    task_pool_destroy(&pool->task_pool);
 
     // 销毁互斥锁（移除mapping_table_mutex，已使用分段锁）
     platform_mutex_destroy(&pool->socket_mutex);
-    platform_mutex_destroy(&pool->stats_mutex);
 
     // 释放工作线程数组
     if (pool->workers) {
+        for (int i = 0; i < pool->worker_count; i++) {
+            send_batch_destroy(&pool->workers[i].send_batch);
+        }
         free(pool->workers);
         pool->workers = NULL;
     }
@@ -479,6 +652,18 @@ void thread_pool_destroy(dns_thread_pool_t* pool) {
     log_debug("线程池已销毁");
 }
 
+void thread_pool_set_send_batch_size(dns_thread_pool_t* pool, int batch_size) {
+    if (!pool) return;
+
+    if (pool->is_running) {
+        log_warn("线程池运行中，无法修改批量发送大小");
+        return;
+    }
+    if (batch_size < 1) batch_size = 1;
+    if (batch_size > SEND_BATCH_MAX) batch_size = SEND_BATCH_MAX;
+    pool->send_batch_size = batch_size;
+}
+
 // ============================================================================
 // 统计和监控函数实现
 // ============================================================================
@@ -486,9 +671,21 @@ void thread_pool_destroy(dns_thread_pool_t* pool) {
 void thread_pool_get_stats(dns_thread_pool_t* pool, thread_pool_stats_t* stats) {
     if (!pool || !stats) return;
 
-    platform_mutex_lock(&pool->stats_mutex);
-    memcpy(stats, &pool->stats, sizeof(thread_pool_stats_t));
-    platform_mutex_unlock(&pool->stats_mutex);
+    stats->start_time = pool->stats.start_time;
+    stats->total_tasks_queued = platform_atomic_load_relaxed(&pool->stats.total_tasks_queued);
+    stats->total_tasks_dropped = platform_atomic_load_relaxed(&pool->stats.total_tasks_dropped);
+    stats->total_tasks_processed = 0;
+    stats->client_requests = 0;
+    stats->upstream_responses = 0;
+
+    // 汇总各工作线程的计数（并发更新时为近似值）
+    for (int i = 0; i < pool->worker_count; i++) {
+        worker_thread_t* worker = &pool->workers[i];
+        stats->total_tasks_processed += platform_atomic_load_relaxed(&worker->processed_tasks);
+        stats->total_tasks_dropped += platform_atomic_load_relaxed(&worker->dropped_tasks);
+        stats->client_requests += platform_atomic_load_relaxed(&worker->client_requests);
+        stats->upstream_responses += platform_atomic_load_relaxed(&worker->upstream_responses);
+    }
 }
 
 void thread_pool_print_status(dns_thread_pool_t* pool) {
@@ -503,7 +700,11 @@ void thread_pool_print_status(dns_thread_pool_t* pool) {
     printf("\n=== DNS线程池状态 ===\n");
     printf("状态: %s\n", pool->is_running ? "运行中" : "已停止");
     printf("工作线程数: %d\n", pool->worker_count);
-    printf("队列大小: %d/%d\n", task_queue_size(&pool->task_queue), pool->task_queue.capacity);
+    int queued = 0;
+    for (int i = 0; i < pool->worker_count; i++) {
+        queued += task_queue_size(&pool->workers[i].local_queue);
+    }
+    printf("队列大小: %d/%d\n", queued, pool->queue_capacity);
     printf("运行时间: %.0f 秒\n", uptime);
     printf("\n--- 处理统计 ---\n");
     printf("总入队任务: %lu\n", stats.total_tasks_queued);
@@ -516,11 +717,43 @@ void thread_pool_print_status(dns_thread_pool_t* pool) {
         printf("处理速率: %.2f 任务/秒\n", stats.total_tasks_processed / uptime);
     }
 
+    // 批量发送统计：平均批次填充度 = 批量发出的数据包数 / sendmmsg调用次数
+    unsigned long batch_flushes = 0;
+    unsigned long batch_packets = 0;
+    unsigned long batch_drops = 0;
+    for (int i = 0; i < pool->worker_count; i++) {
+        batch_flushes += pool->workers[i].send_batch.flush_count;
+        batch_packets += pool->workers[i].send_batch.packet_count;
+        batch_drops += pool->workers[i].send_batch.drop_count;
+    }
+    printf("\n--- 批量发送 ---\n");
+    printf("批量大小: %d\n", pool->send_batch_size);
+    printf("sendmmsg批次: %lu, 数据包: %lu, 丢弃: %lu\n", batch_flushes, batch_packets, batch_drops);
+    if (batch_flushes > 0) {
+        printf("平均批次填充: %.2f/%d\n", (double)batch_packets / batch_flushes, pool->send_batch_size);
+    }
+
+    // 任务对象池统计
+    task_pool_t* task_pool = &pool->task_pool;
+    printf("\n--- 任务对象池 ---\n");
+    printf("小任务(%dB): 可用 %d/%d, 累计分配 %lu\n", TASK_BUFFER_SMALL_SIZE,
+           task_pool_available(task_pool, TASK_TIER_SMALL), task_pool->tiers[TASK_TIER_SMALL].count,
+           platform_atomic_load_relaxed(&task_pool->acquire_count[TASK_TIER_SMALL]));
+    printf("大任务(%dB): 可用 %d/%d, 累计分配 %lu\n", TASK_BUFFER_LARGE_SIZE,
+           task_pool_available(task_pool, TASK_TIER_LARGE), task_pool->tiers[TASK_TIER_LARGE].count,
+           platform_atomic_load_relaxed(&task_pool->acquire_count[TASK_TIER_LARGE]));
+    printf("按需分配: %lu, 分配失败: %lu\n",
+           platform_atomic_load_relaxed(&task_pool->acquire_count[TASK_TIER_HEAP]),
+           platform_atomic_load_relaxed(&task_pool->acquire_failures));
+
     printf("\n--- 工作线程状态 ---\n");
     for (int i = 0; i < pool->worker_count; i++) {
         worker_thread_t* worker = &pool->workers[i];
-        printf("线程%d: %s, 已处理: %lu\n", 
-               i, worker->is_active ? "活跃" : "空闲", worker->processed_tasks);
+        printf("线程%d: %s, 队列深度: %d/%d, 已处理: %lu, 窃取: %lu\n",
+               i, worker->is_active ? "活跃" : "空闲",
+               task_queue_size(&worker->local_queue), worker->local_queue.capacity,
+               platform_atomic_load_relaxed(&worker->processed_tasks),
+               platform_atomic_load_relaxed(&worker->stolen_tasks));
     }
     printf("===================\n\n");
 }
@@ -528,14 +761,18 @@ void thread_pool_print_status(dns_thread_pool_t* pool) {
 void thread_pool_reset_stats(dns_thread_pool_t* pool) {
     if (!pool) return;
 
-    platform_mutex_lock(&pool->stats_mutex);
-    memset(&pool->stats, 0, sizeof(thread_pool_stats_t));
+    platform_atomic_store_relaxed(&pool->stats.total_tasks_queued, 0);
+    platform_atomic_store_relaxed(&pool->stats.total_tasks_dropped, 0);
     pool->stats.start_time = time(NULL);
-    platform_mutex_unlock(&pool->stats_mutex);
 
-    // 重置工作线程统计
+    // 重置工作线程统计（与工作线程的更新并发时可能丢失少量计数）
     for (int i = 0; i < pool->worker_count; i++) {
-        pool->workers[i].processed_tasks = 0;
+        worker_thread_t* worker = &pool->workers[i];
+        platform_atomic_store_relaxed(&worker->processed_tasks, 0);
+        platform_atomic_store_relaxed(&worker->stolen_tasks, 0);
+        platform_atomic_store_relaxed(&worker->client_requests, 0);
+        platform_atomic_store_relaxed(&worker->upstream_responses, 0);
+        platform_atomic_store_relaxed(&worker->dropped_tasks, 0);
     }
 
     log_debug("线程池统计信息已重置");
@@ -550,7 +787,8 @@ int thread_pool_submit_task(dns_thread_pool_t* pool,
                            int buffer_len,
                            struct sockaddr_in source_addr,
                            socklen_t source_addr_len,
-                           task_type_t task_type) {
+                           task_type_t task_type,
+                           SOCKET reply_socket) {
     if (!pool || !buffer || buffer_len <= 0 || buffer_len > BUF_SIZE) {
         log_warn("提交任务失败：参数无效");
         return MYERROR;
@@ -561,24 +799,44 @@ int thread_pool_submit_task(dns_thread_pool_t* pool,
         return MYERROR;
     }
 
-    // 创建任务
-    dns_task_t task;
-    memcpy(task.buffer, buffer, buffer_len);
-    task.buffer_len = buffer_len;
-    task.source_addr = source_addr;
-    task.source_addr_len = source_addr_len;
-    task.type = task_type;
-    task.created_time = time(NULL);
-
-    // 提交任务到队列
-    if (task_queue_push(&pool->task_queue, &task) != MYSUCCESS) {
-        log_warn("提交任务失败：队列操作失败");
-        increment_stats_counter(pool, "dropped");
+    // 从对象池获取大小合适的任务，数据只在此拷贝一次
+    dns_task_t* task = task_pool_acquire(&pool->task_pool, buffer_len);
+    if (!task) {
+        log_warn("提交任务失败：任务对象分配失败");
+        platform_atomic_add_relaxed(&pool->stats.total_tasks_dropped, 1);
+        return MYERROR;
+    }
+    memcpy(task->buffer, buffer, buffer_len);
+    task->buffer_len = buffer_len;
+    task->source_addr = source_addr;
+    task->source_addr_len = source_addr_len;
+    task->type = task_type;
+    task->created_time = time(NULL);
+    task->reply_socket = reply_socket;
+
+    // 按轮询选择工作线程的本地队列，该队列已满时依次尝试后续线程
+    unsigned int start = platform_atomic_fetch_add(&pool->next_worker, 1u);
+    int pushed = 0;
+    for (int k = 0; k < pool->worker_count && !pushed; k++) {
+        worker_thread_t* worker = &pool->workers[(start + k) % pool->worker_count];
+        pushed = task_queue_push(&worker->local_queue, task) == MYSUCCESS;
+    }
+    if (!pushed) {
+        log_warn("提交任务失败：所有工作线程队列已满");
+        task_pool_release(&pool->task_pool, task);
+        platform_atomic_add_relaxed(&pool->stats.total_tasks_dropped, 1);
         return MYERROR;
     }
 
+    // 与工作线程登记挂起的顺序配对：要么其重试时看到任务，要么这里看到等待者
+    platform_atomic_fence();
+    if (platform_atomic_load_relaxed(&pool->sleepers) > 0) {
+        platform_atomic_fetch_add(&pool->wake_seq, 1);
+        platform_futex_wake(&pool->wake_seq, 1);
+    }
+
     // 更新统计信息
-    increment_stats_counter(pool, "queued");
+    platform_atomic_add_relaxed(&pool->stats.total_tasks_queued, 1);
     
     log_debug("任务提交成功，类型：%d，长度：%d", task_type, buffer_len);
     return MYSUCCESS;
@@ -628,24 +886,14 @@ static void update_worker_activity(worker_thread_t* worker) {
     worker->last_activity = time(NULL);
 }
 
-static void increment_stats_counter(dns_thread_pool_t* pool, const char* counter_type) {
-    if (!pool || !counter_type) return;
-
-    platform_mutex_lock(&pool->stats_mutex);
-    
-    if (strcmp(counter_type, "queued") == 0) {
-        pool->stats.total_tasks_queued++;
-    } else if (strcmp(counter_type, "processed") == 0) {
-        pool->stats.total_tasks_processed++;
-    } else if (strcmp(counter_type, "dropped") == 0) {
-        pool->stats.total_tasks_dropped++;
-    } else if (strcmp(counter_type, "client_request") == 0) {
-        pool->stats.client_requests++;
-    } else if (strcmp(counter_type, "upstream_response") == 0) {
-        pool->stats.upstream_responses++;
-    }
-    
-    platform_mutex_unlock(&pool->stats_mutex);
+/**
+ * @brief 递增工作线程自己的统计计数
+ *
+ * 计数只由所属工作线程写入，用relaxed加载和存储代替原子读改写即可，
+ * 统计线程读取时不会看到撕裂的值。
+ */
+static void worker_stats_increment(unsigned long* counter) {
+    platform_atomic_store_relaxed(counter, platform_atomic_load_relaxed(counter) + 1);
 }
 
 // ============================================================================
@@ -655,6 +903,7 @@ static void increment_stats_counter(dns_thread_pool_t* pool, const char* counter
 int thread_pool_add_mapping_safe(unsigned short original_id, 
                                  struct sockaddr_in* client_addr, 
                                  int client_addr_len, 
+                                 SOCKET client_sock,
                                  unsigned short* new_id) {
     if (!g_thread_pool || !g_thread_pool->mapping_table) {
         log_error("无法执行映射表操作：线程池未初始化");
@@ -662,7 +911,7 @@ int thread_pool_add_mapping_safe(unsigned short original_id,
     }
 
     // 分段锁版本：不需要全局锁，内部使用分段锁实现并发控制
-    return add_mapping(g_thread_pool->mapping_table, original_id, client_addr, client_addr_len, new_id);
+    return add_mapping(g_thread_pool->mapping_table, original_id, client_addr, client_addr_len, client_sock, new_id);
 }
 
 dns_mapping_entry_t* thread_pool_find_mapping_safe(unsigned short new_id) {
@@ -1,211 +1,590 @@
-#include "platform/platform.h"
-#include <stdio.h>
-#include <stdlib.h>
-
-#ifdef _WIN32
-#include <time.h>
-#include <sys/timeb.h>  // 为_ftime函数添加头文件
-#else
-#include <sys/time.h>
-#include <errno.h>
-#include <unistd.h>
-#include <sys/sysinfo.h>
-#endif
-
-
-
-void platform_init() {
-#ifdef _WIN32
-    WSADATA wsaData;
-    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-        perror("WSAStartup failed");
-        exit(EXIT_FAILURE);
-    }
-#endif
-}
-
-void platform_cleanup() {
-#ifdef _WIN32
-    WSACleanup();
-#endif
-}
-
-SOCKET create_socket() {
-    return socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-}
-
-int set_socket_reuseaddr(SOCKET sock) {
-    int optval = 1;
-#ifdef _WIN32
-    return setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char *)&optval, sizeof(optval));
-#else
-    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
-    return setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval));
-    
-#endif
-}
-
-int set_socket_nonblocking(SOCKET sock) {
-#ifdef _WIN32
-    u_long mode = 1;
-    return ioctlsocket(sock, FIONBIO, &mode);
-#else
-    int flags = fcntl(sock, F_GETFL, 0);
-    if (flags == -1) return -1;
-    return fcntl(sock, F_SETFL, flags | O_NONBLOCK);
-#endif
-}
-
-int platform_get_last_error() {
-#ifdef _WIN32
-    return WSAGetLastError();
-#else
-    return errno;
-#endif
-}
-
-// ============================================================================
-// 跨平台线程函数实现 - 现在Windows下也使用mingw64 pthread
-// ============================================================================
-
-int platform_mutex_init(pthread_mutex_t* mutex, const pthread_mutexattr_t* attr) {
-    return pthread_mutex_init(mutex, attr);
-}
-
-int platform_mutex_destroy(pthread_mutex_t* mutex) {
-    return pthread_mutex_destroy(mutex);
-}
-
-int platform_mutex_lock(pthread_mutex_t* mutex) {
-    return pthread_mutex_lock(mutex);
-}
-
-int platform_mutex_unlock(pthread_mutex_t* mutex) {
-    return pthread_mutex_unlock(mutex);
-}
-
-// ============================================================================
-// 跨平台读写锁函数实现 - 现在Windows下也使用mingw64 pthread
-// ============================================================================
-
-int platform_rwlock_init(pthread_rwlock_t* rwlock, const pthread_rwlockattr_t* attr) {
-    return pthread_rwlock_init(rwlock, attr);
-}
-
-int platform_rwlock_destroy(pthread_rwlock_t* rwlock) {
-    return pthread_rwlock_destroy(rwlock);
-}
-
-int platform_rwlock_rdlock(pthread_rwlock_t* rwlock) {
-    return pthread_rwlock_rdlock(rwlock);
-}
-
-int platform_rwlock_wrlock(pthread_rwlock_t* rwlock) {
-    return pthread_rwlock_wrlock(rwlock);
-}
-
-int platform_rwlock_unlock(pthread_rwlock_t* rwlock) {
-    return pthread_rwlock_unlock(rwlock);
-}
-
-int platform_cond_init(pthread_cond_t* cond, const pthread_condattr_t* attr) {
-    return pthread_cond_init(cond, attr);
-}
-
-int platform_cond_destroy(pthread_cond_t* cond) {
-    return pthread_cond_destroy(cond);
-}
-
-int platform_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
-    return pthread_cond_wait(cond, mutex);
-}
-
-int platform_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, int timeout_ms) {
-#ifdef _WIN32
-    // Windows下使用mingw64的pthread实现
-    struct timespec ts;
-    struct _timeb tb;
-    _ftime(&tb);
-    
-    ts.tv_sec = tb.time + timeout_ms / 1000;
-    ts.tv_nsec = (tb.millitm + (timeout_ms % 1000)) * 1000000;
-    
-    // 处理纳秒溢出
-    if (ts.tv_nsec >= 1000000000) {
-        ts.tv_sec++;
-        ts.tv_nsec -= 1000000000;
-    }
-    
-    int result = pthread_cond_timedwait(cond, mutex, &ts);
-    if (result == ETIMEDOUT) {
-        return 1; // 超时
-    } else if (result != 0) {
-        return -1; // 其他错误
-    }
-    return 0; // 成功
-#else
-    struct timespec ts;
-    struct timeval now;
-    gettimeofday(&now, NULL);
-    
-    ts.tv_sec = now.tv_sec + timeout_ms / 1000;
-    ts.tv_nsec = (now.tv_usec + (timeout_ms % 1000) * 1000) * 1000;
-    
-    // 处理纳秒溢出
-    if (ts.tv_nsec >= 1000000000) {
-        ts.tv_sec++;
-        ts.tv_nsec -= 1000000000;
-    }
-    
-    int result = pthread_cond_timedwait(cond, mutex, &ts);
-    if (result == ETIMEDOUT) {
-        return 1; // 超时
-    } else if (result != 0) {
-        return -1; // 其他错误
-    }
-    return 0; // 成功
-#endif
-}
-
-int platform_cond_signal(pthread_cond_t* cond) {
-    return pthread_cond_signal(cond);
-}
-
-int platform_cond_broadcast(pthread_cond_t* cond) {
-    return pthread_cond_broadcast(cond);
-}
-
-int platform_thread_create(pthread_t* thread, const pthread_attr_t* attr, 
-                          THREAD_RETURN_TYPE (*start_routine)(void*), void* arg) {
-    return pthread_create(thread, attr, (void*(*)(void*))start_routine, arg);
-}
-
-int platform_thread_join(pthread_t thread, void** retval) {
-    return pthread_join(thread, retval);
-}
-
-int platform_thread_detach(pthread_t thread) {
-    return pthread_detach(thread);
-}
-
-pthread_t platform_thread_self(void) {
-    return pthread_self();
-}
-
-void platform_sleep_ms(int ms) {
-#ifdef _WIN32
-    Sleep((DWORD)ms);
-#else
-    usleep(ms * 1000);
-#endif
-}
-
-int platform_get_cpu_count(void) {
-#ifdef _WIN32
-    SYSTEM_INFO sysinfo;
-    GetSystemInfo(&sysinfo);
-    return (int)sysinfo.dwNumberOfProcessors;
-#else
-    return get_nprocs();
-#endif
-}
+#ifndef _WIN32
+#define _GNU_SOURCE  // recvmmsg/sendmmsg
+#elif !defined(_WIN32_WINNT)
+#define _WIN32_WINNT 0x0602  // WaitOnAddress需要Windows 8及以上
+#endif
+#include "platform/platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#ifdef _WIN32
+#include <time.h>
+#include <sys/timeb.h>  // 为_ftime函数添加头文件
+#else
+#include <sys/time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/sysinfo.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <signal.h>
+#endif
+
+
+
+void platform_init() {
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        perror("WSAStartup failed");
+        exit(EXIT_FAILURE);
+    }
+#endif
+}
+
+void platform_cleanup() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+SOCKET create_socket() {
+    return socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+}
+
+int set_socket_reuseaddr(SOCKET sock) {
+    int optval = 1;
+#ifdef _WIN32
+    return setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (const char *)&optval, sizeof(optval));
+#else
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+    return setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval));
+    
+#endif
+}
+
+int set_socket_nonblocking(SOCKET sock) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(sock, FIONBIO, &mode);
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags == -1) return -1;
+    return fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+#endif
+}
+
+int platform_get_last_error() {
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+// ============================================================================
+// 批量数据报收发实现
+// ============================================================================
+
+static int platform_error_is_wouldblock(int error) {
+#ifdef _WIN32
+    return error == WSAEWOULDBLOCK;
+#else
+    return error == EAGAIN || error == EWOULDBLOCK;
+#endif
+}
+
+int platform_recv_batch(SOCKET sock, platform_dgram_t* dgrams, int count) {
+    if (!dgrams || count <= 0) return 0;
+    if (count > PLATFORM_DGRAM_BATCH_MAX) count = PLATFORM_DGRAM_BATCH_MAX;
+
+#ifdef _WIN32
+    int received = 0;
+    while (received < count) {
+        platform_dgram_t* dgram = &dgrams[received];
+        int addr_len = sizeof(dgram->addr);
+        int len = recvfrom(sock, dgram->buffer, dgram->buffer_size, 0,
+                           (struct sockaddr*)&dgram->addr, &addr_len);
+        if (len == SOCKET_ERROR) {
+            if (received > 0 || platform_error_is_wouldblock(platform_get_last_error())) {
+                break;
+            }
+            return SOCKET_ERROR;
+        }
+        dgram->length = len;
+        dgram->addr_len = addr_len;
+        received++;
+    }
+    return received;
+#else
+    struct mmsghdr msgs[PLATFORM_DGRAM_BATCH_MAX];
+    struct iovec iovecs[PLATFORM_DGRAM_BATCH_MAX];
+
+    memset(msgs, 0, sizeof(struct mmsghdr) * count);
+    for (int i = 0; i < count; i++) {
+        iovecs[i].iov_base = dgrams[i].buffer;
+        iovecs[i].iov_len = dgrams[i].buffer_size;
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &dgrams[i].addr;
+        msgs[i].msg_hdr.msg_namelen = sizeof(dgrams[i].addr);
+    }
+
+    int received = recvmmsg(sock, msgs, count, MSG_DONTWAIT, NULL);
+    if (received < 0) {
+        return platform_error_is_wouldblock(errno) ? 0 : SOCKET_ERROR;
+    }
+
+    for (int i = 0; i < received; i++) {
+        dgrams[i].length = (int)msgs[i].msg_len;
+        dgrams[i].addr_len = msgs[i].msg_hdr.msg_namelen;
+    }
+    return received;
+#endif
+}
+
+int platform_send_batch(SOCKET sock, const platform_dgram_t* dgrams, int count) {
+    if (!dgrams || count <= 0) return 0;
+    if (count > PLATFORM_DGRAM_BATCH_MAX) count = PLATFORM_DGRAM_BATCH_MAX;
+
+    int sent = 0;
+#ifdef _WIN32
+    for (int i = 0; i < count; i++) {
+        int result = dgrams[i].addr_len == 0
+                         ? send(sock, dgrams[i].buffer, dgrams[i].length, 0)
+                         : sendto(sock, dgrams[i].buffer, dgrams[i].length, 0,
+                                  (const struct sockaddr*)&dgrams[i].addr, sizeof(dgrams[i].addr));
+        if (result != SOCKET_ERROR) {
+            sent++;
+        }
+    }
+#else
+    struct mmsghdr msgs[PLATFORM_DGRAM_BATCH_MAX];
+    struct iovec iovecs[PLATFORM_DGRAM_BATCH_MAX];
+
+    memset(msgs, 0, sizeof(struct mmsghdr) * count);
+    for (int i = 0; i < count; i++) {
+        iovecs[i].iov_base = dgrams[i].buffer;
+        iovecs[i].iov_len = dgrams[i].length;
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        // 已连接套接字不能再指定目的地址（BSD/macOS返回EISCONN）
+        if (dgrams[i].addr_len != 0) {
+            msgs[i].msg_hdr.msg_name = (void*)&dgrams[i].addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(dgrams[i].addr);
+        }
+    }
+
+    // sendmmsg可能只发送部分数据报：被信号中断时重试；发送缓冲区已满时停止，剩余数据报由调用方计为丢弃；
+    // 其他错误由位于offset处的数据报引起，只跳过这一个继续发送
+    int offset = 0;
+    while (offset < count) {
+        int result = sendmmsg(sock, msgs + offset, count - offset, MSG_DONTWAIT);
+        if (result > 0) {
+            sent += result;
+            offset += result;
+            continue;
+        }
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result == 0 || platform_error_is_wouldblock(errno)) {
+            break;
+        }
+        offset++;
+    }
+#endif
+    return sent;
+}
+
+// ============================================================================
+// 事件循环实现
+// ============================================================================
+
+int platform_event_loop_init(platform_event_loop_t* loop) {
+    if (!loop) return -1;
+    memset(loop, 0, sizeof(*loop));
+
+#ifdef _WIN32
+    return 0;
+#else
+    loop->timer_fd = -1;
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    return loop->epoll_fd == -1 ? -1 : 0;
+#endif
+}
+
+int platform_event_loop_add(platform_event_loop_t* loop, SOCKET sock, void* data) {
+    if (!loop || sock == INVALID_SOCKET) return -1;
+
+#ifdef _WIN32
+    if (loop->socket_count >= FD_SETSIZE) return -1;
+    loop->sockets[loop->socket_count] = sock;
+    loop->socket_data[loop->socket_count] = data;
+    loop->socket_count++;
+    return 0;
+#else
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = data;
+    return epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, sock, &ev);
+#endif
+}
+
+int platform_event_loop_remove(platform_event_loop_t* loop, SOCKET sock) {
+    if (!loop || sock == INVALID_SOCKET) return -1;
+
+#ifdef _WIN32
+    for (int i = 0; i < loop->socket_count; i++) {
+        if (loop->sockets[i] == sock) {
+            loop->socket_count--;
+            loop->sockets[i] = loop->sockets[loop->socket_count];
+            loop->socket_data[i] = loop->socket_data[loop->socket_count];
+            return 0;
+        }
+    }
+    return -1;
+#else
+    return epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, sock, NULL);
+#endif
+}
+
+int platform_event_loop_set_timer(platform_event_loop_t* loop, int interval_ms, void* data) {
+    if (!loop || interval_ms <= 0) return -1;
+    loop->timer_data = data;
+
+#ifdef _WIN32
+    loop->timer_interval_ms = interval_ms;
+    loop->timer_next_tick = GetTickCount64() + (ULONGLONG)interval_ms;
+    return 0;
+#else
+    if (loop->timer_fd == -1) {
+        loop->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (loop->timer_fd == -1) return -1;
+
+        // 定时器事件以timer_fd字段地址作为标记，与用户注册的数据区分
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.ptr = &loop->timer_fd;
+        if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->timer_fd, &ev) == -1) {
+            close(loop->timer_fd);
+            loop->timer_fd = -1;
+            return -1;
+        }
+    }
+
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = interval_ms / 1000;
+    spec.it_interval.tv_nsec = (long)(interval_ms % 1000) * 1000000L;
+    spec.it_value = spec.it_interval;
+    return timerfd_settime(loop->timer_fd, 0, &spec, NULL);
+#endif
+}
+
+int platform_event_loop_wait(platform_event_loop_t* loop, platform_event_t* events, int max_events, int timeout_ms) {
+    if (!loop || !events || max_events <= 0) return -1;
+    if (max_events > PLATFORM_EVENT_MAX) max_events = PLATFORM_EVENT_MAX;
+
+#ifdef _WIN32
+    // select不支持边沿触发，这里退化为水平触发：调用方读空套接字后语义一致
+    ULONGLONG now = GetTickCount64();
+    int wait_ms = timeout_ms;
+    if (loop->timer_interval_ms > 0) {
+        int timer_ms = loop->timer_next_tick > now ? (int)(loop->timer_next_tick - now) : 0;
+        if (wait_ms < 0 || timer_ms < wait_ms) wait_ms = timer_ms;
+    }
+
+    int ready = 0;
+    if (loop->socket_count > 0) {
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        for (int i = 0; i < loop->socket_count; i++) {
+            FD_SET(loop->sockets[i], &read_fds);
+        }
+
+        struct timeval tv;
+        struct timeval* tv_ptr = NULL;
+        if (wait_ms >= 0) {
+            tv.tv_sec = wait_ms / 1000;
+            tv.tv_usec = (wait_ms % 1000) * 1000;
+            tv_ptr = &tv;
+        }
+
+        int activity = select(0, &read_fds, NULL, NULL, tv_ptr);
+        if (activity == SOCKET_ERROR) return -1;
+
+        for (int i = 0; i < loop->socket_count && activity > 0 && ready < max_events; i++) {
+            if (FD_ISSET(loop->sockets[i], &read_fds)) {
+                events[ready].data = loop->socket_data[i];
+                events[ready].is_timer = 0;
+                ready++;
+            }
+        }
+    } else if (wait_ms > 0) {
+        Sleep((DWORD)wait_ms);
+    }
+
+    if (loop->timer_interval_ms > 0 && ready < max_events) {
+        now = GetTickCount64();
+        if (now >= loop->timer_next_tick) {
+            // 错过多个周期时只触发一次
+            while (loop->timer_next_tick <= now) {
+                loop->timer_next_tick += (ULONGLONG)loop->timer_interval_ms;
+            }
+            events[ready].data = loop->timer_data;
+            events[ready].is_timer = 1;
+            ready++;
+        }
+    }
+    return ready;
+#else
+    struct epoll_event ready_events[PLATFORM_EVENT_MAX];
+    int ready = epoll_wait(loop->epoll_fd, ready_events, max_events, timeout_ms);
+    if (ready < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    for (int i = 0; i < ready; i++) {
+        if (ready_events[i].data.ptr == &loop->timer_fd) {
+            // 读取超时次数以清空timerfd，错过多个周期时只触发一次
+            uint64_t expirations;
+            if (read(loop->timer_fd, &expirations, sizeof(expirations)) < 0) {
+                // 非阻塞读取失败说明计数已被清空，忽略
+            }
+            events[i].data = loop->timer_data;
+            events[i].is_timer = 1;
+        } else {
+            events[i].data = ready_events[i].data.ptr;
+            events[i].is_timer = 0;
+        }
+    }
+    return ready;
+#endif
+}
+
+void platform_event_loop_destroy(platform_event_loop_t* loop) {
+    if (!loop) return;
+
+#ifdef _WIN32
+    loop->socket_count = 0;
+    loop->timer_interval_ms = 0;
+#else
+    if (loop->timer_fd != -1) {
+        close(loop->timer_fd);
+        loop->timer_fd = -1;
+    }
+    if (loop->epoll_fd != -1) {
+        close(loop->epoll_fd);
+        loop->epoll_fd = -1;
+    }
+#endif
+}
+
+// ============================================================================
+// 等待/唤醒实现
+// ============================================================================
+
+int platform_futex_wait(int* addr, int expected, int timeout_ms) {
+#ifdef _WIN32
+    DWORD wait_ms = timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms;
+    if (!WaitOnAddress((volatile VOID*)addr, &expected, sizeof(int), wait_ms)) {
+        return GetLastError() == ERROR_TIMEOUT ? 1 : 0;
+    }
+    return 0;
+#else
+    struct timespec ts;
+    struct timespec* ts_ptr = NULL;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+        ts_ptr = &ts;
+    }
+    // EAGAIN（值已改变）和EINTR都视为被唤醒，由调用方重新检查条件
+    if (syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, ts_ptr, NULL, 0) == -1 && errno == ETIMEDOUT) {
+        return 1;
+    }
+    return 0;
+#endif
+}
+
+void platform_futex_wake(int* addr, int count) {
+#ifdef _WIN32
+    if (count == 1) {
+        WakeByAddressSingle((PVOID)addr);
+    } else {
+        WakeByAddressAll((PVOID)addr);
+    }
+#else
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count <= 0 ? INT_MAX : count, NULL, NULL, 0);
+#endif
+}
+
+// ============================================================================
+// 跨平台线程函数实现 - 现在Windows下也使用mingw64 pthread
+// ============================================================================
+
+int platform_mutex_init(pthread_mutex_t* mutex, const pthread_mutexattr_t* attr) {
+    return pthread_mutex_init(mutex, attr);
+}
+
+int platform_mutex_destroy(pthread_mutex_t* mutex) {
+    return pthread_mutex_destroy(mutex);
+}
+
+int platform_mutex_lock(pthread_mutex_t* mutex) {
+    return pthread_mutex_lock(mutex);
+}
+
+int platform_mutex_unlock(pthread_mutex_t* mutex) {
+    return pthread_mutex_unlock(mutex);
+}
+
+// ============================================================================
+// 跨平台读写锁函数实现 - 现在Windows下也使用mingw64 pthread
+// ============================================================================
+
+int platform_rwlock_init(pthread_rwlock_t* rwlock, const pthread_rwlockattr_t* attr) {
+    return pthread_rwlock_init(rwlock, attr);
+}
+
+int platform_rwlock_destroy(pthread_rwlock_t* rwlock) {
+    return pthread_rwlock_destroy(rwlock);
+}
+
+int platform_rwlock_rdlock(pthread_rwlock_t* rwlock) {
+    return pthread_rwlock_rdlock(rwlock);
+}
+
+int platform_rwlock_wrlock(pthread_rwlock_t* rwlock) {
+    return pthread_rwlock_wrlock(rwlock);
+}
+
+int platform_rwlock_unlock(pthread_rwlock_t* rwlock) {
+    return pthread_rwlock_unlock(rwlock);
+}
+
+int platform_cond_init(pthread_cond_t* cond, const pthread_condattr_t* attr) {
+    return pthread_cond_init(cond, attr);
+}
+
+int platform_cond_destroy(pthread_cond_t* cond) {
+    return pthread_cond_destroy(cond);
+}
+
+int platform_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex) {
+    return pthread_cond_wait(cond, mutex);
+}
+
+int platform_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, int timeout_ms) {
+#ifdef _WIN32
+    // Windows下使用mingw64的pthread实现
+    struct timespec ts;
+    struct _timeb tb;
+    _ftime(&tb);
+    
+    ts.tv_sec = tb.time + timeout_ms / 1000;
+    ts.tv_nsec = (tb.millitm + (timeout_ms % 1000)) * 1000000;
+    
+    // 处理纳秒溢出
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    
+    int result = pthread_cond_timedwait(cond, mutex, &ts);
+    if (result == ETIMEDOUT) {
+        return 1; // 超时
+    } else if (result != 0) {
+        return -1; // 其他错误
+    }
+    return 0; // 成功
+#else
+    struct timespec ts;
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    
+    ts.tv_sec = now.tv_sec + timeout_ms / 1000;
+    ts.tv_nsec = (now.tv_usec + (timeout_ms % 1000) * 1000) * 1000;
+    
+    // 处理纳秒溢出
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    
+    int result = pthread_cond_timedwait(cond, mutex, &ts);
+    if (result == ETIMEDOUT) {
+        return 1; // 超时
+    } else if (result != 0) {
+        return -1; // 其他错误
+    }
+    return 0; // 成功
+#endif
+}
+
+int platform_cond_signal(pthread_cond_t* cond) {
+    return pthread_cond_signal(cond);
+}
+
+int platform_cond_broadcast(pthread_cond_t* cond) {
+    return pthread_cond_broadcast(cond);
+}
+
+int platform_thread_create(pthread_t* thread, const pthread_attr_t* attr, 
+                          THREAD_RETURN_TYPE (*start_routine)(void*), void* arg) {
+    return pthread_create(thread, attr, (void*(*)(void*))start_routine, arg);
+}
+
+int platform_thread_join(pthread_t thread, void** retval) {
+    return pthread_join(thread, retval);
+}
+
+int platform_thread_detach(pthread_t thread) {
+    return pthread_detach(thread);
+}
+
+pthread_t platform_thread_self(void) {
+    return pthread_self();
+}
+
+void platform_sleep_ms(int ms) {
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
+int platform_get_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO sysinfo;
+    GetSystemInfo(&sysinfo);
+    return (int)sysinfo.dwNumberOfProcessors;
+#else
+    return get_nprocs();
+#endif
+}
+
+// 重载请求标志：信号处理函数只做一次无锁原子写
+static int g_reload_requested = 0;
+
+#ifndef _WIN32
+static void platform_reload_signal_handler(int signo) {
+    (void)signo;
+    __atomic_store_n(&g_reload_requested, 1, __ATOMIC_RELAXED);
+}
+#endif
+
+int platform_reload_signal_install(void) {
+#ifdef _WIN32
+    return -1;
+#else
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = platform_reload_signal_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    return sigaction(SIGHUP, &action, NULL) == 0 ? 0 : -1;
+#endif
+}
+
+int platform_reload_signal_take(void) {
+    return __atomic_exchange_n(&g_reload_requested, 0, __ATOMIC_RELAXED);
+}
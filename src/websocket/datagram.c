@@ -1,973 +1,210 @@
-#include "websocket/datagram.h" // 包含 DNS 报头和问题结构的定义
-#include <string.h> // 为 strcpy, strcat, strlen 函数添加头文件
-#include <stdlib.h> // 为 malloc, free 函数添加头文件
-
-// 函数：将域名格式化为DNS查询格式 (例如 "www.baidu.com" -> "3www5baidu3com0")
-// DNS协议要求域名以一种特殊的格式表示，每个标签前有一个字节表示该标签的长度。
-void format_domain_name(char* dns, const char* host) {
-    int lock = 0;
-    char temp_host[256];
-    strcpy(temp_host, host); // 复制域名，因为我们需要在末尾添加一个点
-    strcat(temp_host, ".");  // 在域名末尾添加一个点，方便处理
-
-    // 遍历域名字符串
-    for (size_t i = 0; i < strlen(temp_host); i++) {        // 当遇到点时，表示一个标签结束
-        if (temp_host[i] == '.') {
-            *dns++ = (char)(i - lock); // 写入标签的长度
-            // 写入标签本身
-            for (; lock < (int)i; lock++) {
-                *dns++ = temp_host[lock];
-            }
-            lock++; // 更新下一个标签的起始位置
-        }
-    }
-    *dns++ = '\0'; // 以一个长度为0的字节结束，表示根域
-}
-
-
-
-// 函数：构造一个DNS响应实体
-DNS_ENTITY* build_response(const DNS_ENTITY* request, const char* ip_address) {
-    DNS_ENTITY* response = (DNS_ENTITY*)malloc(sizeof(DNS_ENTITY));
-    if (!response) {
-        return NULL;
-    }
-    memset(response, 0, sizeof(DNS_ENTITY));
-
-    response->id = request->id;
-    response->qdcount = request->qdcount;
-
-    // 复制问题部分
-    if (response->qdcount > 0) {
-        response->questions = (DNS_QUESTION_ENTITY*)malloc(sizeof(DNS_QUESTION_ENTITY) * response->qdcount);
-        if (!response->questions) {
-            free(response);
-            return NULL;
-        }
-        for (int i = 0; i < response->qdcount; i++) {
-            response->questions[i].qname = strdup(request->questions[i].qname);
-            response->questions[i].qtype = request->questions[i].qtype;
-            response->questions[i].qclass = request->questions[i].qclass;
-        }
-    }
-
-    // 检查IP地址是否为 "0.0.0.0"
-    if (strcmp(ip_address, "0.0.0.0") == 0) {
-        // 域名不存在
-        response->flags = 0x8183; // QR=1, Opcode=0, AA=0, TC=0, RD=1, RA=1, Z=0, RCODE=3 (Name Error)
-        response->ancount = 0;
-        response->answers = NULL;
-    } else {
-        // 构造成功响应
-        response->flags = 0x8180; // QR=1, Opcode=0, AA=0, TC=0, RD=1, RA=1, Z=0, RCODE=0 (No Error)
-        response->ancount = request->qdcount; // 假设每个问题都有一个答案
-        if (response->ancount > 0) {
-            response->answers = (R_DATA_ENTITY*)malloc(sizeof(R_DATA_ENTITY) * response->ancount);
-            if (!response->answers) {
-                free_dns_entity(response); // free_dns_entity 会处理已经分配的 questions
-                return NULL;
-            }
-            for (int i = 0; i < response->ancount; i++) {
-                response->answers[i].name = strdup(request->questions[i].qname);
-                response->answers[i].type = A; // IPv4 地址
-                response->answers[i]._class = 1; // IN
-                response->answers[i].ttl = 3600; // 1 小时
-                response->answers[i].data_len = 4;
-                response->answers[i].rdata = (char*)malloc(4);
-                if (response->answers[i].rdata) {
-                    inet_pton(AF_INET, ip_address, response->answers[i].rdata);
-                }
-            }
-        }
-    }
-
-    response->nscount = 0;
-    response->arcount = 0;
-    response->authorities = NULL;
-    response->additionals = NULL;
-
-    return response;
-}
-
-// 函数：将DNS_ENTITY序列化为DNS协议格式的字节流
-int serialize_dns_packet(char* buffer, const DNS_ENTITY* dns_entity) {    int offset = 0;
-    
-    // 写入DNS头部
-    *((unsigned short*)(buffer + offset)) = htons(dns_entity->id);
-    offset += 2;
-    *((unsigned short*)(buffer + offset)) = htons(dns_entity->flags);
-    offset += 2;    
-    *((unsigned short*)(buffer + offset)) = htons(dns_entity->qdcount);
-    offset += 2;
-    *((unsigned short*)(buffer + offset)) = htons(dns_entity->ancount);
-    offset += 2;
-    *((unsigned short*)(buffer + offset)) = htons(dns_entity->nscount);
-    offset += 2;
-    *((unsigned short*)(buffer + offset)) = htons(dns_entity->arcount);
-    offset += 2;    
-    // 写入问题部分
-    for (int i = 0; i < dns_entity->qdcount; i++) {
-        // 始终将域名转换为DNS格式
-        char dns_formatted[256];
-        format_domain_name(dns_formatted, dns_entity->questions[i].qname);
-        int qname_len = get_dns_name_length(dns_formatted);
-        memcpy(buffer + offset, dns_formatted, qname_len);
-        offset += qname_len;
-        
-        // 写入qtype和qclass
-        *((unsigned short*)(buffer + offset)) = htons(dns_entity->questions[i].qtype);
-        offset += 2;
-        *((unsigned short*)(buffer + offset)) = htons(dns_entity->questions[i].qclass);
-        offset += 2;
-    }    // 写入答案部分
-    for (int i = 0; i < dns_entity->ancount; i++) {
-        // 始终将域名转换为DNS格式
-        char dns_formatted[256];
-        format_domain_name(dns_formatted, dns_entity->answers[i].name);
-        int name_len = get_dns_name_length(dns_formatted);
-        memcpy(buffer + offset, dns_formatted, name_len);
-        offset += name_len;
-        
-        // 写入type、class、ttl、data_len
-        *((unsigned short*)(buffer + offset)) = htons(dns_entity->answers[i].type);
-        offset += 2;
-        *((unsigned short*)(buffer + offset)) = htons(dns_entity->answers[i]._class);
-        offset += 2;
-        *((unsigned int*)(buffer + offset)) = htonl(dns_entity->answers[i].ttl);
-        offset += 4;
-        *((unsigned short*)(buffer + offset)) = htons(dns_entity->answers[i].data_len);
-        offset += 2;        
-        // 写入rdata
-        if (dns_entity->answers[i].type == CNAME) {
-            // 对于CNAME记录，需要将字符串格式的域名转换为DNS格式
-            char dns_formatted_rdata[256];
-            format_domain_name(dns_formatted_rdata, dns_entity->answers[i].rdata);
-            int cname_len = get_dns_name_length(dns_formatted_rdata);
-            
-            // 更新data_len为实际的DNS格式长度（回退到data_len字段位置）
-            *((unsigned short*)(buffer + offset - 2)) = htons(cname_len);
-            
-            // 写入DNS格式的CNAME数据
-            memcpy(buffer + offset, dns_formatted_rdata, cname_len);
-            offset += cname_len;
-        } else {
-            // 对于其他类型的记录，直接复制原始数据
-            memcpy(buffer + offset, dns_entity->answers[i].rdata, dns_entity->answers[i].data_len);
-            offset += dns_entity->answers[i].data_len;
-        }
-    }    // 写入权威记录部分
-    for (int i = 0; i < dns_entity->nscount; i++) {
-        // 始终将域名转换为DNS格式
-        char dns_formatted[256];
-        format_domain_name(dns_formatted, dns_entity->authorities[i].name);
-        int name_len = get_dns_name_length(dns_formatted);
-        memcpy(buffer + offset, dns_formatted, name_len);
-        offset += name_len;
-        
-        // 写入type、class、ttl、data_len
-        *((unsigned short*)(buffer + offset)) = htons(dns_entity->authorities[i].type);
-        offset += 2;
-        *((unsigned short*)(buffer + offset)) = htons(dns_entity->authorities[i]._class);
-        offset += 2;
-        *((unsigned int*)(buffer + offset)) = htonl(dns_entity->authorities[i].ttl);
-        offset += 4;
-        *((unsigned short*)(buffer + offset)) = htons(dns_entity->authorities[i].data_len);
-        offset += 2;        
-        // 写入rdata
-        if (dns_entity->authorities[i].type == CNAME) {
-            // 对于CNAME记录，需要将字符串格式的域名转换为DNS格式
-            char dns_formatted_rdata[256];
-            format_domain_name(dns_formatted_rdata, dns_entity->authorities[i].rdata);
-            int cname_len = get_dns_name_length(dns_formatted_rdata);
-            
-            // 更新data_len为实际的DNS格式长度
-            *((unsigned short*)(buffer + offset - 2)) = htons(cname_len);
-            
-            // 写入DNS格式的CNAME数据
-            memcpy(buffer + offset, dns_formatted_rdata, cname_len);
-            offset += cname_len;
-        } else {
-            // 对于其他类型的记录，直接复制原始数据
-            memcpy(buffer + offset, dns_entity->authorities[i].rdata, dns_entity->authorities[i].data_len);
-            offset += dns_entity->authorities[i].data_len;
-        }
-    }
-
-    // 写入附加记录部分
-    for (int i = 0; i < dns_entity->arcount; i++) {
-        // 始终将域名转换为DNS格式
-        char dns_formatted[256];
-        format_domain_name(dns_formatted, dns_entity->additionals[i].name);
-        int name_len = get_dns_name_length(dns_formatted);
-        memcpy(buffer + offset, dns_formatted, name_len);
-        offset += name_len;
-        
-        // 写入type、class、ttl、data_len
-        *((unsigned short*)(buffer + offset)) = htons(dns_entity->additionals[i].type);
-        offset += 2;
-        *((unsigned short*)(buffer + offset)) = htons(dns_entity->additionals[i]._class);
-        offset += 2;
-        *((unsigned int*)(buffer + offset)) = htonl(dns_entity->additionals[i].ttl);
-        offset += 4;
-        *((unsigned short*)(buffer + offset)) = htons(dns_entity->additionals[i].data_len);
-        offset += 2;        
-        // 写入rdata
-        if (dns_entity->additionals[i].type == CNAME) {
-            // 对于CNAME记录，需要将字符串格式的域名转换为DNS格式
-            char dns_formatted_rdata[256];
-            format_domain_name(dns_formatted_rdata, dns_entity->additionals[i].rdata);
-            int cname_len = get_dns_name_length(dns_formatted_rdata);
-            
-            // 更新data_len为实际的DNS格式长度
-            *((unsigned short*)(buffer + offset - 2)) = htons(cname_len);
-            
-            // 写入DNS格式的CNAME数据
-            memcpy(buffer + offset, dns_formatted_rdata, cname_len);
-            offset += cname_len;
-        } else {
-            // 对于其他类型的记录，直接复制原始数据
-            memcpy(buffer + offset, dns_entity->additionals[i].rdata, dns_entity->additionals[i].data_len);
-            offset += dns_entity->additionals[i].data_len;
-        }
-    }    
-    
-    return offset;
-}
-
-// 函数：从缓冲区中读取域名（处理DNS压缩）
-int read_name_from_buffer(const char* buffer, int buffer_len, int* offset, char* name, int max_name_len) {
-    int pos = *offset;
-    int jumped = 0;
-    int name_len = 0;
-    
-    while (pos < buffer_len && buffer[pos] != 0) {
-        if ((buffer[pos] & 0xC0) == 0xC0) {
-            // 压缩指针
-            if (!jumped) {
-                *offset = pos + 2;
-            }
-            pos = ((buffer[pos] & 0x3F) << 8) | (unsigned char)buffer[pos + 1];
-            jumped = 1;
-        } else {
-            // 标签长度
-            int label_len = buffer[pos];
-            pos++;
-            
-            if (name_len + label_len + 1 >= max_name_len) {
-                return -1; // 名称太长
-            }
-            
-            if (name_len > 0) {
-                name[name_len++] = '.';
-            }
-            
-            for (int i = 0; i < label_len && pos < buffer_len; i++) {
-                name[name_len++] = buffer[pos++];
-            }
-        }
-    }
-    
-    name[name_len] = '\0';
-    
-    if (!jumped) {
-        *offset = pos + 1;
-    }
-    
-    return name_len;
-}
-
-// 函数：从DNS协议格式的字节流解析为DNS_ENTITY
-DNS_ENTITY* parse_dns_packet(const char* buffer, int buffer_len) {
-    if (buffer_len < 12) return NULL; // DNS头部至少12字节
-    
-    DNS_ENTITY* entity = (DNS_ENTITY*)malloc(sizeof(DNS_ENTITY));
-    if (!entity) return NULL;
-    
-    int offset = 0;
-    
-    // 解析DNS头部
-    entity->id = ntohs(*((unsigned short*)(buffer + offset)));
-    offset += 2;
-    entity->flags = ntohs(*((unsigned short*)(buffer + offset)));
-    offset += 2;
-    entity->qdcount = ntohs(*((unsigned short*)(buffer + offset)));
-    offset += 2;
-    entity->ancount = ntohs(*((unsigned short*)(buffer + offset)));
-    offset += 2;
-    entity->nscount = ntohs(*((unsigned short*)(buffer + offset)));
-    offset += 2;
-    entity->arcount = ntohs(*((unsigned short*)(buffer + offset)));
-    offset += 2;
-    
-
-
-    // 解析问题部分
-    if (entity->qdcount > 0) {
-        entity->questions = (DNS_QUESTION_ENTITY*)malloc(sizeof(DNS_QUESTION_ENTITY) * entity->qdcount);
-        if (!entity->questions) {
-            free(entity);
-            return NULL;
-        }
-        
-        for (int i = 0; i < entity->qdcount; i++) {
-            // 读取域名
-            entity->questions[i].qname = (char*)malloc(256);
-            if (!entity->questions[i].qname) {
-                // 清理已分配的内存
-                for (int j = 0; j < i; j++) {
-                    free(entity->questions[j].qname);
-                }
-                free(entity->questions);
-                free(entity);
-                return NULL;
-            }
-            
-            read_name_from_buffer(buffer, buffer_len, &offset, entity->questions[i].qname, 256);
-            
-            // 读取qtype和qclass
-            entity->questions[i].qtype = ntohs(*((unsigned short*)(buffer + offset)));
-            offset += 2;
-            entity->questions[i].qclass = ntohs(*((unsigned short*)(buffer + offset)));
-            offset += 2;
-        }
-    } else {
-        entity->questions = NULL;
-    }
-    
-    // 解析回答部分
-    if (entity->ancount > 0) {
-        entity->answers = (R_DATA_ENTITY*)malloc(sizeof(R_DATA_ENTITY) * entity->ancount);
-        if (!entity->answers) {
-            free(entity);
-            return NULL;
-        }
-        
-        for (int i = 0; i < entity->ancount; i++) {
-            // 读取域名
-            entity->answers[i].name = (char*)malloc(256);
-            if (!entity->answers[i].name) {
-                // 清理已分配的内存
-                for (int j = 0; j < i; j++) {
-                    free(entity->answers[j].name);
-                    free(entity->answers[j].rdata);
-                }
-                free(entity->answers);
-                free(entity);
-                return NULL;
-            }
-            
-            read_name_from_buffer(buffer, buffer_len, &offset, entity->answers[i].name, 256);
-            
-            // 读取资源记录的固定部分
-            entity->answers[i].type = ntohs(*((unsigned short*)(buffer + offset)));
-            offset += 2;
-            entity->answers[i]._class = ntohs(*((unsigned short*)(buffer + offset)));
-            offset += 2;
-            entity->answers[i].ttl = ntohl(*((unsigned int*)(buffer + offset)));
-            offset += 4;
-            entity->answers[i].data_len = ntohs(*((unsigned short*)(buffer + offset)));
-            offset += 2;            // 读取RDATA
-            // 对于CNAME记录，需要更多内存来存储解析后的域名字符串
-            int rdata_size = (entity->answers[i].type == CNAME) ? 256 : entity->answers[i].data_len;
-            entity->answers[i].rdata = (char*)malloc(rdata_size);
-            if (!entity->answers[i].rdata) {
-                free(entity->answers[i].name);
-                // 清理已分配的内存
-                for (int j = 0; j < i; j++) {
-                    free(entity->answers[j].name);
-                    free(entity->answers[j].rdata);
-                }
-                free(entity->answers);
-                free(entity);
-                return NULL;
-            }
-            
-            // 如果是CNAME记录，需要特殊处理域名解析
-            if (entity->answers[i].type == CNAME) {
-                // 对于CNAME记录，解析域名而不是直接拷贝字节
-                char cname[256];
-                int temp_offset = offset;
-                if (read_name_from_buffer(buffer, buffer_len, &temp_offset, cname, sizeof(cname)) > 0) {
-                    // 将解析后的域名存储为字符串
-                    strcpy(entity->answers[i].rdata, cname);
-                } else {
-                    strcpy(entity->answers[i].rdata, "(parse error)");
-                }
-            } else {
-                // 对于其他类型的记录，直接拷贝原始数据
-                memcpy(entity->answers[i].rdata, buffer + offset, entity->answers[i].data_len);
-            }
-              offset += entity->answers[i].data_len;
-        }    } else {
-        entity->answers = NULL;
-    }
-    
-    // 解析权威记录部分
-    if (entity->nscount > 0) {
-        entity->authorities = (R_DATA_ENTITY*)malloc(sizeof(R_DATA_ENTITY) * entity->nscount);
-        if (!entity->authorities) {
-            // 清理已分配的内存
-            if (entity->questions) {
-                for (int j = 0; j < entity->qdcount; j++) {
-                    free(entity->questions[j].qname);
-                }
-                free(entity->questions);
-            }
-            if (entity->answers) {
-                for (int j = 0; j < entity->ancount; j++) {
-                    free(entity->answers[j].name);
-                    free(entity->answers[j].rdata);
-                }
-                free(entity->answers);
-            }
-            free(entity);
-            return NULL;
-        }
-        
-        for (int i = 0; i < entity->nscount; i++) {
-            // 读取域名
-            entity->authorities[i].name = (char*)malloc(256);
-            if (!entity->authorities[i].name) {
-                // 清理已分配的内存
-                for (int j = 0; j < i; j++) {
-                    free(entity->authorities[j].name);
-                    free(entity->authorities[j].rdata);
-                }
-                free(entity->authorities);
-                // 清理其他已分配的内存
-                if (entity->questions) {
-                    for (int j = 0; j < entity->qdcount; j++) {
-                        free(entity->questions[j].qname);
-                    }
-                    free(entity->questions);
-                }
-                if (entity->answers) {
-                    for (int j = 0; j < entity->ancount; j++) {
-                        free(entity->answers[j].name);
-                        free(entity->answers[j].rdata);
-                    }
-                    free(entity->answers);
-                }
-                free(entity);
-                return NULL;
-            }
-            
-            read_name_from_buffer(buffer, buffer_len, &offset, entity->authorities[i].name, 256);
-            
-            // 读取资源记录的固定部分
-            entity->authorities[i].type = ntohs(*((unsigned short*)(buffer + offset)));
-            offset += 2;
-            entity->authorities[i]._class = ntohs(*((unsigned short*)(buffer + offset)));
-            offset += 2;
-            entity->authorities[i].ttl = ntohl(*((unsigned int*)(buffer + offset)));
-            offset += 4;
-            entity->authorities[i].data_len = ntohs(*((unsigned short*)(buffer + offset)));
-            offset += 2;
-            
-            // 读取RDATA
-            int rdata_size = (entity->authorities[i].type == CNAME) ? 256 : entity->authorities[i].data_len;
-            entity->authorities[i].rdata = (char*)malloc(rdata_size);
-            if (!entity->authorities[i].rdata) {
-                free(entity->authorities[i].name);
-                // 清理已分配的内存
-                for (int j = 0; j < i; j++) {
-                    free(entity->authorities[j].name);
-                    free(entity->authorities[j].rdata);
-                }
-                free(entity->authorities);
-                // 清理其他已分配的内存
-                if (entity->questions) {
-                    for (int j = 0; j < entity->qdcount; j++) {
-                        free(entity->questions[j].qname);
-                    }
-                    free(entity->questions);
-                }
-                if (entity->answers) {
-                    for (int j = 0; j < entity->ancount; j++) {
-                        free(entity->answers[j].name);
-                        free(entity->answers[j].rdata);
-                    }
-                    free(entity->answers);
-                }
-                free(entity);
-                return NULL;
-            }
-            
-            // 如果是CNAME记录，需要特殊处理域名解析
-            if (entity->authorities[i].type == CNAME) {
-                char cname[256];
-                int temp_offset = offset;
-                if (read_name_from_buffer(buffer, buffer_len, &temp_offset, cname, sizeof(cname)) > 0) {
-                    strcpy(entity->authorities[i].rdata, cname);
-                } else {
-                    strcpy(entity->authorities[i].rdata, "(parse error)");
-                }
-            } else {
-                memcpy(entity->authorities[i].rdata, buffer + offset, entity->authorities[i].data_len);
-            }
-            
-            offset += entity->authorities[i].data_len;
-        }
-    } else {
-        entity->authorities = NULL;
-    }
-    
-    // 解析附加记录部分
-    if (entity->arcount > 0) {
-        entity->additionals = (R_DATA_ENTITY*)malloc(sizeof(R_DATA_ENTITY) * entity->arcount);
-        if (!entity->additionals) {
-            // 清理已分配的内存
-            if (entity->questions) {
-                for (int j = 0; j < entity->qdcount; j++) {
-                    free(entity->questions[j].qname);
-                }
-                free(entity->questions);
-            }
-            if (entity->answers) {
-                for (int j = 0; j < entity->ancount; j++) {
-                    free(entity->answers[j].name);
-                    free(entity->answers[j].rdata);
-                }
-                free(entity->answers);
-            }
-            if (entity->authorities) {
-                for (int j = 0; j < entity->nscount; j++) {
-                    free(entity->authorities[j].name);
-                    free(entity->authorities[j].rdata);
-                }
-                free(entity->authorities);
-            }
-            free(entity);
-            return NULL;
-        }
-        
-        for (int i = 0; i < entity->arcount; i++) {
-            // 读取域名
-            entity->additionals[i].name = (char*)malloc(256);
-            if (!entity->additionals[i].name) {
-                // 清理已分配的内存
-                for (int j = 0; j < i; j++) {
-                    free(entity->additionals[j].name);
-                    free(entity->additionals[j].rdata);
-                }
-                free(entity->additionals);
-                // 清理其他已分配的内存
-                if (entity->questions) {
-                    for (int j = 0; j < entity->qdcount; j++) {
-                        free(entity->questions[j].qname);
-                    }
-                    free(entity->questions);
-                }
-                if (entity->answers) {
-                    for (int j = 0; j < entity->ancount; j++) {
-                        free(entity->answers[j].name);
-                        free(entity->answers[j].rdata);
-                    }
-                    free(entity->answers);
-                }
-                if (entity->authorities) {
-                    for (int j = 0; j < entity->nscount; j++) {
-                        free(entity->authorities[j].name);
-                        free(entity->authorities[j].rdata);
-                    }
-                    free(entity->authorities);
-                }
-                free(entity);
-                return NULL;
-            }
-            
-            read_name_from_buffer(buffer, buffer_len, &offset, entity->additionals[i].name, 256);
-            
-            // 读取资源记录的固定部分
-            entity->additionals[i].type = ntohs(*((unsigned short*)(buffer + offset)));
-            offset += 2;
-            entity->additionals[i]._class = ntohs(*((unsigned short*)(buffer + offset)));
-            offset += 2;
-            entity->additionals[i].ttl = ntohl(*((unsigned int*)(buffer + offset)));
-            offset += 4;
-            entity->additionals[i].data_len = ntohs(*((unsigned short*)(buffer + offset)));
-            offset += 2;
-            
-            // 读取RDATA
-            int rdata_size = (entity->additionals[i].type == CNAME) ? 256 : entity->additionals[i].data_len;
-            entity->additionals[i].rdata = (char*)malloc(rdata_size);
-            if (!entity->additionals[i].rdata) {
-                free(entity->additionals[i].name);
-                // 清理已分配的内存
-                for (int j = 0; j < i; j++) {
-                    free(entity->additionals[j].name);
-                    free(entity->additionals[j].rdata);
-                }
-                free(entity->additionals);
-                // 清理其他已分配的内存
-                if (entity->questions) {
-                    for (int j = 0; j < entity->qdcount; j++) {
-                        free(entity->questions[j].qname);
-                    }
-                    free(entity->questions);
-                }
-                if (entity->answers) {
-                    for (int j = 0; j < entity->ancount; j++) {
-                        free(entity->answers[j].name);
-                        free(entity->answers[j].rdata);
-                    }
-                    free(entity->answers);
-                }
-                if (entity->authorities) {
-                    for (int j = 0; j < entity->nscount; j++) {
-                        free(entity->authorities[j].name);
-                        free(entity->authorities[j].rdata);
-                    }
-                    free(entity->authorities);
-                }
-                free(entity);
-                return NULL;
-            }
-            
-            // 如果是CNAME记录，需要特殊处理域名解析
-            if (entity->additionals[i].type == CNAME) {
-                char cname[256];
-                int temp_offset = offset;
-                if (read_name_from_buffer(buffer, buffer_len, &temp_offset, cname, sizeof(cname)) > 0) {
-                    strcpy(entity->additionals[i].rdata, cname);
-                } else {
-                    strcpy(entity->additionals[i].rdata, "(parse error)");
-                }
-            } else {
-                memcpy(entity->additionals[i].rdata, buffer + offset, entity->additionals[i].data_len);
-            }
-            
-            offset += entity->additionals[i].data_len;
-        }
-    } else {
-        entity->additionals = NULL;
-    }
-    
-    return entity;
-}
-
-// 函数：释放DNS_ENTITY及其相关资源
-void free_dns_entity(DNS_ENTITY* entity) {
-    if (!entity) return;
-    
-    if (entity->questions) {
-        for (int i = 0; i < entity->qdcount; i++) {
-            free(entity->questions[i].qname);
-        }
-        free(entity->questions);
-    }
-    
-    if (entity->answers) {
-        for (int i = 0; i < entity->ancount; i++) {
-            free(entity->answers[i].name);
-            free(entity->answers[i].rdata);
-        }
-        free(entity->answers);
-    }
-    
-    if (entity->authorities) {
-        for (int i = 0; i < entity->nscount; i++) {
-            free(entity->authorities[i].name);
-            free(entity->authorities[i].rdata);
-        }
-        free(entity->authorities);
-    }
-    
-    if (entity->additionals) {
-        for (int i = 0; i < entity->arcount; i++) {
-            free(entity->additionals[i].name);
-            free(entity->additionals[i].rdata);
-        }
-        free(entity->additionals);
-    }
-      free(entity);
-}
-
-// 函数：获取DNS记录类型的字符串表示
-const char* get_record_type_name(unsigned short type) {
-    switch(type) {
-        case A: return "A";
-        case AAAA: return "AAAA";
-        case CNAME: return "CNAME";
-        case MX: return "MX";
-        case 2: return "NS";
-        case 6: return "SOA";
-        case 12: return "PTR";
-        case 16: return "TXT";
-        default: return "UNKNOWN";
-    }
-}
-
-// 函数：格式化IP地址
-void format_ip_address(char* output, const R_DATA_ENTITY* record) {
-    if (record->type == A && record->data_len == 4) {
-        // IPv4地址
-        unsigned char* ip = (unsigned char*)record->rdata;
-        sprintf(output, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
-    } else if (record->type == AAAA && record->data_len == 16) {
-        // IPv6地址
-        unsigned char* ip = (unsigned char*)record->rdata;
-        sprintf(output, "%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x",
-                ip[0], ip[1], ip[2], ip[3], ip[4], ip[5], ip[6], ip[7],
-                ip[8], ip[9], ip[10], ip[11], ip[12], ip[13], ip[14], ip[15]);
-    } else if (record->type == CNAME) {
-        // CNAME记录
-        strcpy(output, record->rdata);
-    } else {
-        // 其他类型显示数据长度
-        sprintf(output, "[%d bytes of data]", record->data_len);
-    }
-}
-
-// 函数：将DNS_ENTITY转换为格式化的字符串表示
-char* dns_entity_to_string(const DNS_ENTITY* entity) {
-    if (!entity) return NULL;
-    
-    // 分配一个足够大的缓冲区来存储格式化的字符串
-    char* result = (char*)malloc(8192); // 8KB应该足够大
-    if (!result) return NULL;
-    
-    char temp[1024];
-    result[0] = '\0'; // 初始化为空字符串
-    
-    // DNS头部信息
-    sprintf(temp, "=== DNS Message ===\n");
-    strcat(result, temp);
-    
-    sprintf(temp, "Transaction ID: 0x%04X (%d)\n", entity->id, entity->id);
-    strcat(result, temp);
-    
-    // 解析标志位
-    sprintf(temp, "Flags: 0x%04X\n", entity->flags);
-    strcat(result, temp);
-    
-    sprintf(temp, "  QR: %d (%s)\n", (entity->flags >> 15) & 1, 
-            ((entity->flags >> 15) & 1) ? "Response" : "Query");
-    strcat(result, temp);
-    
-    sprintf(temp, "  Opcode: %d\n", (entity->flags >> 11) & 0xF);
-    strcat(result, temp);
-    
-    sprintf(temp, "  AA: %d (Authoritative Answer)\n", (entity->flags >> 10) & 1);
-    strcat(result, temp);
-    
-    sprintf(temp, "  TC: %d (Truncated)\n", (entity->flags >> 9) & 1);
-    strcat(result, temp);
-    
-    sprintf(temp, "  RD: %d (Recursion Desired)\n", (entity->flags >> 8) & 1);
-    strcat(result, temp);
-    
-    sprintf(temp, "  RA: %d (Recursion Available)\n", (entity->flags >> 7) & 1);
-    strcat(result, temp);
-    
-    sprintf(temp, "  RCODE: %d\n", entity->flags & 0xF);
-    strcat(result, temp);
-    
-    // 计数信息
-    sprintf(temp, "\n=== Counts ===\n");
-    strcat(result, temp);
-    
-    sprintf(temp, "Questions: %d\n", entity->qdcount);
-    strcat(result, temp);
-    
-    sprintf(temp, "Answers: %d\n", entity->ancount);
-    strcat(result, temp);
-    
-    sprintf(temp, "Authority Records: %d\n", entity->nscount);
-    strcat(result, temp);
-    
-    sprintf(temp, "Additional Records: %d\n", entity->arcount);
-    strcat(result, temp);
-    
-    // 问题部分
-    if (entity->qdcount > 0 && entity->questions) {
-        sprintf(temp, "\n=== Questions ===\n");
-        strcat(result, temp);
-          for (int i = 0; i < entity->qdcount; i++) {
-            sprintf(temp, "Question %d:\n", i + 1);
-            strcat(result, temp);
-              // 域名已经在parse_dns_packet中转换为可读格式
-            sprintf(temp, "  Name: %s\n", entity->questions[i].qname ? entity->questions[i].qname : "(null)");
-            strcat(result, temp);
-            
-            sprintf(temp, "  Type: %d (%s)\n", entity->questions[i].qtype, 
-                    get_record_type_name(entity->questions[i].qtype));
-            strcat(result, temp);
-            
-            sprintf(temp, "  Class: %d (%s)\n", entity->questions[i].qclass,
-                    entity->questions[i].qclass == 1 ? "IN" : "OTHER");
-            strcat(result, temp);
-        }
-    }
-    
-    // 答案部分
-    if (entity->ancount > 0 && entity->answers) {
-        sprintf(temp, "\n=== Answers ===\n");
-        strcat(result, temp);
-        
-        for (int i = 0; i < entity->ancount; i++) {
-            sprintf(temp, "Answer %d:\n", i + 1);
-            strcat(result, temp);
-            
-            sprintf(temp, "  Name: %s\n", entity->answers[i].name ? entity->answers[i].name : "(null)");
-            strcat(result, temp);
-            
-            sprintf(temp, "  Type: %d (%s)\n", entity->answers[i].type,
-                    get_record_type_name(entity->answers[i].type));
-            strcat(result, temp);
-            
-            sprintf(temp, "  Class: %d (%s)\n", entity->answers[i]._class,
-                    entity->answers[i]._class == 1 ? "IN" : "OTHER");
-            strcat(result, temp);
-            
-            sprintf(temp, "  TTL: %u seconds\n", entity->answers[i].ttl);
-            strcat(result, temp);
-            
-            sprintf(temp, "  Data Length: %d bytes\n", entity->answers[i].data_len);
-            strcat(result, temp);
-            
-            char data_str[512];
-            format_ip_address(data_str, &entity->answers[i]);
-            sprintf(temp, "  Data: %s\n", data_str);
-            strcat(result, temp);
-        }
-    }
-    
-    // 权威记录部分
-    if (entity->nscount > 0 && entity->authorities) {
-        sprintf(temp, "\n=== Authority Records ===\n");
-        strcat(result, temp);
-        
-        for (int i = 0; i < entity->nscount; i++) {
-            sprintf(temp, "Authority %d:\n", i + 1);
-            strcat(result, temp);
-            
-            sprintf(temp, "  Name: %s\n", entity->authorities[i].name ? entity->authorities[i].name : "(null)");
-            strcat(result, temp);
-            
-            sprintf(temp, "  Type: %d (%s)\n", entity->authorities[i].type,
-                    get_record_type_name(entity->authorities[i].type));
-            strcat(result, temp);
-            
-            sprintf(temp, "  Class: %d (%s)\n", entity->authorities[i]._class,
-                    entity->authorities[i]._class == 1 ? "IN" : "OTHER");
-            strcat(result, temp);
-            
-            sprintf(temp, "  TTL: %u seconds\n", entity->authorities[i].ttl);
-            strcat(result, temp);
-            
-            sprintf(temp, "  Data Length: %d bytes\n", entity->authorities[i].data_len);
-            strcat(result, temp);
-            
-            char data_str[512];
-            format_ip_address(data_str, &entity->authorities[i]);
-            sprintf(temp, "  Data: %s\n", data_str);
-            strcat(result, temp);
-        }
-    }
-    
-    // 附加记录部分
-    if (entity->arcount > 0 && entity->additionals) {
-        sprintf(temp, "\n=== Additional Records ===\n");
-        strcat(result, temp);
-        
-        for (int i = 0; i < entity->arcount; i++) {
-            sprintf(temp, "Additional %d:\n", i + 1);
-            strcat(result, temp);
-            
-            sprintf(temp, "  Name: %s\n", entity->additionals[i].name ? entity->additionals[i].name : "(null)");
-            strcat(result, temp);
-            
-            sprintf(temp, "  Type: %d (%s)\n", entity->additionals[i].type,
-                    get_record_type_name(entity->additionals[i].type));
-            strcat(result, temp);
-            
-            sprintf(temp, "  Class: %d (%s)\n", entity->additionals[i]._class,
-                    entity->additionals[i]._class == 1 ? "IN" : "OTHER");
-            strcat(result, temp);
-            
-            sprintf(temp, "  TTL: %u seconds\n", entity->additionals[i].ttl);
-            strcat(result, temp);
-            
-            sprintf(temp, "  Data Length: %d bytes\n", entity->additionals[i].data_len);
-            strcat(result, temp);
-            
-            char data_str[512];
-            format_ip_address(data_str, &entity->additionals[i]);
-            sprintf(temp, "  Data: %s\n", data_str);
-            strcat(result, temp);
-        }
-    }
-    
-    sprintf(temp, "\n=== End of DNS Message ===\n");
-    strcat(result, temp);    
-    return result;
-}
-
-// 函数：计算DNS格式域名的实际长度
-// DNS域名格式：每个标签前有长度字节，以0结尾
-// 例如：3www5baidu3com0 - 需要计算到最后的0字节（包含）
-int get_dns_name_length(const char* dns_name) {
-    if (!dns_name) return 0;
-    
-    int length = 0;
-    
-    while (1) {
-        unsigned char label_len = (unsigned char)dns_name[length];
-        
-        // 检查是否是压缩指针
-        if ((label_len & 0xC0) == 0xC0) {
-            length += 2; // 指针长度为2字节
-            break;
-        }
-        
-        // 检查是否是域名结尾
-        if (label_len == 0) {
-            length += 1; // 包含结尾的0字节
-            break;
-        }
-        
-        // 普通标签，跳过长度字节和标签内容
-        length += 1 + label_len;
-    }
-    
-    return length;
-}
-
-// 函数：构造一个表示服务器错误的DNS响应实体
-DNS_ENTITY* build_error_response(const DNS_ENTITY* request) {
-    DNS_ENTITY* response = (DNS_ENTITY*)malloc(sizeof(DNS_ENTITY));
-    if (!response) {
-        return NULL;
-    }
-    memset(response, 0, sizeof(DNS_ENTITY));
-
-    response->id = request->id;
-    response->qdcount = request->qdcount;
-
-    // 复制问题部分
-    if (response->qdcount > 0) {
-        response->questions = (DNS_QUESTION_ENTITY*)malloc(sizeof(DNS_QUESTION_ENTITY) * response->qdcount);
-        if (!response->questions) {
-            free(response);
-            return NULL;
-        }
-        for (int i = 0; i < response->qdcount; i++) {
-            response->questions[i].qname = strdup(request->questions[i].qname);
-            response->questions[i].qtype = request->questions[i].qtype;
-            response->questions[i].qclass = request->questions[i].qclass;
-        }
-    }
-
-    // 设置标志为服务器错误 (Server Failure, RCODE=2)
-    response->flags = 0x8182;
-
-    response->ancount = 0;
-    response->answers = NULL;
-    response->nscount = 0;
-    response->authorities = NULL;
-    response->arcount = 0;
-    response->additionals = NULL;
-
-    return response;
-}
\ No newline at end of file
+#include "websocket/datagram.h" // 包含 DNS 报头和问题结构的定义
+#include <string.h> // 为 memcpy, memset 函数添加头文件
+#include "websocket/websocket.h" // MYSUCCESS/MYERROR
+
+// ============================================================================
+// 报文校验与报文视图
+// ============================================================================
+
+static unsigned int wire_read_u16(const char* p) {
+    return ((unsigned int)(unsigned char)p[0] << 8) | (unsigned char)p[1];
+}
+
+static unsigned int wire_read_u32(const char* p) {
+    return (wire_read_u16(p) << 16) | wire_read_u16(p + 2);
+}
+
+/**
+ * @brief 校验报文中pos处的域名，可选地解码为点分格式或展开为不含压缩指针的线路格式
+ *
+ * 压缩指针必须指向当前片段起始之前且不早于报文头，目标严格递减，因此不会出现指针环；
+ * 域名线路长度超过DNS_MAX_NAME_WIRE_LEN视为错误。
+ * 点分格式无法区分标签内的'.'和NUL，解码为点分格式时含这两种字节的标签视为错误。
+ *
+ * @param name 输出点分格式域名，为NULL时不解码
+ * @param name_size name缓冲区大小
+ * @param wire 输出展开后的线路格式域名（容量至少DNS_MAX_NAME_WIRE_LEN），为NULL时不展开
+ * @param end 输出域名在原位置之后的偏移（不跟随压缩指针），可为NULL
+ * @return 点分格式域名长度，格式错误、越界或缓冲区不足返回-1
+ */
+static int wire_walk_name(const char* packet, int packet_len, int pos, char* name, int name_size,
+                          unsigned char* wire, int* end) {
+    int limit = pos;      // 压缩指针目标上限
+    int next = -1;        // 域名之后的偏移
+    int wire_len = 0;     // 展开后的线路格式长度
+    int name_len = 0;
+
+    for (;;) {
+        if (pos >= packet_len) return -1;
+        unsigned char label_len = (unsigned char)packet[pos];
+
+        if ((label_len & 0xC0) == 0xC0) {
+            if (pos + 2 > packet_len) return -1;
+            int target = ((label_len & 0x3F) << 8) | (unsigned char)packet[pos + 1];
+            if (target < DNS_HEADER_SIZE || target >= limit) return -1;
+            if (next < 0) next = pos + 2;
+            limit = target;
+            pos = target;
+            continue;
+        }
+        if (label_len > DNS_MAX_LABEL_LEN) return -1;  // 保留的标签类型
+
+        if (wire_len + label_len + 1 > DNS_MAX_NAME_WIRE_LEN) return -1;
+        if (label_len == 0) {
+            if (wire) wire[wire_len] = 0;
+            if (next < 0) next = pos + 1;
+            break;
+        }
+        if (pos + 1 + label_len > packet_len) return -1;
+
+        if (wire) memcpy(wire + wire_len, packet + pos, label_len + 1);
+        wire_len += label_len + 1;
+
+        if (name) {
+            const char* label = packet + pos + 1;
+            if (memchr(label, '.', label_len) || memchr(label, '\0', label_len)) return -1;
+            if (name_len + label_len + 2 > name_size) return -1;  // 分隔点和结尾NUL
+            if (name_len > 0) name[name_len++] = '.';
+            memcpy(name + name_len, packet + pos + 1, label_len);
+        } else if (name_len > 0) {
+            name_len++;
+        }
+        name_len += label_len;
+        pos += label_len + 1;
+    }
+
+    if (name) {
+        if (name_size < 1) return -1;
+        name[name_len] = '\0';
+    }
+    if (end) *end = next;
+    return name_len;
+}
+
+int dns_msg_view_parse_question(dns_msg_view_t* view, const char* packet, int packet_len) {
+    if (!view || !packet || packet_len < DNS_HEADER_SIZE) return MYERROR;
+
+    view->packet = packet;
+    view->packet_len = packet_len;
+    view->id = (unsigned short)wire_read_u16(packet);
+    view->flags = (unsigned short)wire_read_u16(packet + 2);
+    view->qdcount = (unsigned short)wire_read_u16(packet + 4);
+    view->ancount = (unsigned short)wire_read_u16(packet + 6);
+    view->nscount = (unsigned short)wire_read_u16(packet + 8);
+    view->arcount = (unsigned short)wire_read_u16(packet + 10);
+    view->question_count = 0;
+    view->record_count = 0;
+    view->records_parsed = 0;
+    view->truncated = 0;
+
+    int pos = DNS_HEADER_SIZE;
+    for (int i = 0; i < view->qdcount; i++) {
+        int name_offset = pos;
+        if (wire_walk_name(packet, packet_len, pos, NULL, 0, NULL, &pos) < 0) return MYERROR;
+        if (pos + 4 > packet_len) return MYERROR;
+
+        if (view->question_count < DNS_VIEW_MAX_QUESTIONS) {
+            dns_question_view_t* q = &view->questions[view->question_count++];
+            q->name_offset = (unsigned short)name_offset;
+            q->qtype = (unsigned short)wire_read_u16(packet + pos);
+            q->qclass = (unsigned short)wire_read_u16(packet + pos + 2);
+        } else {
+            view->truncated = 1;
+        }
+        pos += 4;
+    }
+
+    view->end_offset = pos;
+    return MYSUCCESS;
+}
+
+int dns_msg_view_parse_records(dns_msg_view_t* view) {
+    if (!view || !view->packet) return MYERROR;
+    if (view->records_parsed) return MYSUCCESS;
+
+    const char* packet = view->packet;
+    int packet_len = view->packet_len;
+    int pos = view->end_offset;
+    int rrcount = view->ancount + view->nscount + view->arcount;
+    for (int i = 0; i < rrcount; i++) {
+        int name_offset = pos;
+        if (wire_walk_name(packet, packet_len, pos, NULL, 0, NULL, &pos) < 0) return MYERROR;
+        if (pos + 10 > packet_len) return MYERROR;
+
+        int rdlength = (int)wire_read_u16(packet + pos + 8);
+        if (pos + 10 + rdlength > packet_len) return MYERROR;
+
+        if (view->record_count < DNS_VIEW_MAX_RECORDS) {
+            dns_rr_view_t* rr = &view->records[view->record_count++];
+            rr->name_offset = (unsigned short)name_offset;
+            rr->type = (unsigned short)wire_read_u16(packet + pos);
+            rr->rclass = (unsigned short)wire_read_u16(packet + pos + 2);
+            rr->ttl = wire_read_u32(packet + pos + 4);
+            rr->ttl_offset = (unsigned short)(pos + 4);
+            rr->rdlength = (unsigned short)rdlength;
+            rr->rdata_offset = (unsigned short)(pos + 10);
+        } else {
+            view->truncated = 1;
+        }
+        pos += 10 + rdlength;
+    }
+
+    view->end_offset = pos;
+    view->records_parsed = 1;
+    return MYSUCCESS;
+}
+
+int dns_msg_view_parse(dns_msg_view_t* view, const char* packet, int packet_len) {
+    if (dns_msg_view_parse_question(view, packet, packet_len) != MYSUCCESS) return MYERROR;
+    return dns_msg_view_parse_records(view);
+}
+
+int dns_msg_view_read_name(const dns_msg_view_t* view, int name_offset, char* name, int name_size) {
+    if (!view || !name) return -1;
+    return wire_walk_name(view->packet, view->packet_len, name_offset, name, name_size, NULL, NULL);
+}
+
+int dns_msg_view_read_wire_name(const dns_msg_view_t* view, int name_offset, unsigned char* wire) {
+    if (!view || !wire) return -1;
+    int name_len = wire_walk_name(view->packet, view->packet_len, name_offset, NULL, 0, wire, NULL);
+    if (name_len < 0) return -1;
+    return name_len == 0 ? 1 : name_len + 2;  // 各标签长度字节比分隔点多一个，另加根标签
+}
+
+int build_template_response(const dns_msg_view_t* request, unsigned short flags, unsigned short ancount,
+                            const char* answer, int answer_len, char* buffer, int buffer_size) {
+    if (!request || request->question_count == 0) return -1;
+
+    // 第一个问题的查询名不可能含压缩指针（指针只能指向报文头之后、当前位置之前），可整体拷贝
+    int question_end;
+    if (wire_walk_name(request->packet, request->packet_len, DNS_HEADER_SIZE, NULL, 0, NULL, &question_end) < 0) return -1;
+    question_end += 4;  // QTYPE + QCLASS
+
+    int packet_len = question_end + answer_len;
+    if (packet_len > buffer_size) return -1;
+
+    unsigned short header[6] = { htons(request->id), htons(flags), htons(1), htons(ancount), 0, 0 };
+    memcpy(buffer, header, DNS_HEADER_SIZE);
+    memcpy(buffer + DNS_HEADER_SIZE, request->packet + DNS_HEADER_SIZE, question_end - DNS_HEADER_SIZE);
+    if (answer_len > 0) {
+        memcpy(buffer + question_end, answer, answer_len);
+    }
+    return packet_len;
+}
+
+int dns_append_opt_record(char* packet, int packet_len, int buffer_size, unsigned short udp_payload) {
+    if (!packet || packet_len < DNS_HEADER_SIZE || packet_len + DNS_OPT_RR_SIZE > buffer_size) return -1;
+
+    // 根名、TYPE=OPT、CLASS=UDP载荷上限、扩展RCODE/版本/标志全0、RDLENGTH=0
+    char* rr = packet + packet_len;
+    memset(rr, 0, DNS_OPT_RR_SIZE);
+    rr[1] = (char)(OPT >> 8);
+    rr[2] = (char)OPT;
+    rr[3] = (char)(udp_payload >> 8);
+    rr[4] = (char)udp_payload;
+
+    unsigned int arcount = wire_read_u16(packet + 10) + 1;
+    packet[10] = (char)(arcount >> 8);
+    packet[11] = (char)arcount;
+    return packet_len + DNS_OPT_RR_SIZE;
+}
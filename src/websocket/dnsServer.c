@@ -1,434 +1,892 @@
-#include "websocket/dnsServer.h"
-#include "platform/platform.h"
-#include "Thread/thread_pool.h"
-#include "DNScache/relayBuild.h"
-#include <time.h>  // 添加时间相关的头文件支持
-#include <string.h> // 包含 memset 和 strcmp
-
-
-/*
- * ============================================================================
- * 全局变量声明
- * ============================================================================
- */
-
-// 全局映射表：维护客户端请求ID与上游服务器响应ID的映射关系
-// 这是实现并发处理的核心数据结构，确保响应能正确返回给对应的客户端
-static dns_mapping_table_t g_mapping_table;
-
-// 上游DNS套接字（全局，避免重复创建和销毁）
-// 使用单个全局socket可以减少系统调用开销，提高性能
-static SOCKET server_socket = INVALID_SOCKET;
-
-// 线程池实例（用于多线程处理）
-static dns_thread_pool_t g_dns_thread_pool;
-
-
-/*
- * ============================================================================
- * 并发请求处理函数
- * ============================================================================
- */
-
-/**
- * @brief 处理客户端请求
- * 
- * 这个函数处理来自客户端的DNS请求，实现了：
- * 1. 批量处理所有等待的请求（非阻塞接收）
- * 2. 为每个请求创建ID映射
- * 3. 修改请求ID避免冲突
- * 4. 转发请求到上游DNS服务器
- * 
- * 处理流程：
- * 客户端请求 -> 接收 -> 创建映射 -> 修改ID -> 转发上游
- * 
- * @param server_socket 服务器socket，用于接收客户端请求
- */
-void handle_client_requests(DNS_ENTITY* dns_entity,struct sockaddr_in client_addr, int client_addr_len,int request_len) {
-    log_debug("收到来自 %s:%d 的DNS请求 (%d 字节)",
-            inet_ntoa(client_addr.sin_addr), 
-            ntohs(client_addr.sin_port), request_len);
-
-    log_debug("%s",dns_entity_to_string(dns_entity));
-    // 查询本地表
-    dns_query_response_t* response = dns_relay_query(dns_entity->questions->qname,dns_entity->questions->qtype);
-    DNS_ENTITY* result;
-    switch (response->result_type){
-        case QUERY_RESULT_BLOCKED:
-            log_debug("响应来源: 域名被屏蔽 - 返回域名不存在");
-            result = build_response(dns_entity,"0.0.0.0");
-            break;
-        case QUERY_RESULT_LOCAL_HIT:
-            log_debug("响应来源: 本地域名表命中 - IP: %s", response->resolved_ip);
-            result = build_response(dns_entity,response->resolved_ip);
-            break;
-        case QUERY_RESULT_CACHE_HIT:
-            log_debug("响应来源: 缓存命中 - 直接返回缓存结果");
-            result = response->dns_response;
-            break;
-        case QUERY_RESULT_CACHE_MISS:
-            log_debug("响应来源: 缓存未命中 - 需要向上游DNS服务器查询");
-            log_debug("%s",dns_entity_to_string(dns_entity));
-            log_debug("原始ID: %d",dns_entity->id);
-            // === 提取并验证原始Transaction ID ===
-            // DNS头部的前2个字节是Transaction ID（网络字节序）
-            unsigned short original_id = dns_entity->id;
-            unsigned short new_id;
-                
-            // === 创建ID映射关系 ===      
-            if (thread_pool_add_mapping_safe(original_id, &client_addr, client_addr_len, &new_id) != MYSUCCESS) {
-                log_error("为来自 %s:%d 的请求添加映射失败 (原始ID=%d)",
-                            inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port), original_id);
-                client_addr_len = sizeof(client_addr);  // 重置地址长度
-                return;
-            }    
-            // === 修改请求的Transaction ID ===
-            dns_entity->id = new_id;
-            log_debug("修改请求ID: %d -> %d", original_id, new_id);
-            
-            // === 转轮询请求到随机选择的上游DNS服务器 ===
-            if (sendDnsPacketToNextUpstream(server_socket, dns_entity) != MYSUCCESS) {
-                log_error("转发请求到上游服务器失败 (新ID=%d)", new_id);
-                // 转发失败，清理刚创建的映射
-                thread_pool_remove_mapping_safe(new_id);
-            } else {
-                log_debug("成功转发请求到随机上游服务器，上游ID=%d", new_id);
-            }
-            break;
-    }
-
-    if(response->result_type !=QUERY_RESULT_CACHE_MISS)
-    {
-        result->id = dns_entity->id;
-        if (sendDnsPacket(server_socket, client_addr, result) == MYERROR) 
-        {
-            int send_error = platform_get_last_error();
-            log_error("向客户端 %s:%d 发送响应失败: %d",
-            inet_ntoa(client_addr.sin_addr), 
-            ntohs(client_addr.sin_port), send_error);
-        } 
-        else 
-        {
-            log_info("已向客户端 %s:%d 发送响应 (原始ID=%d)",
-            inet_ntoa(client_addr.sin_addr), 
-            ntohs(client_addr.sin_port), dns_entity->id);
-        }
-    }
-
-}
-
-/**
- * @brief 处理上游服务器响应
- * 
- * 这个函数处理来自上游DNS服务器的响应，实现了：
- * 1. 批量处理所有等待的响应（非阻塞接收）
- * 2. 根据响应ID查找对应的客户端映射
- * 3. 恢复原始Transaction ID
- * 4. 将响应转发回原始客户端
- * 5. 清理完成的映射关系
- * 
- * 处理流程：
- * 上游响应 -> 接收 -> 查找映射 -> 恢复原始ID -> 转发客户端 -> 清理映射
- * 
- * @param server_socket 服务器socket，用于向客户端发送响应
- */
-void handle_upstream_responses(DNS_ENTITY* dns_entity,struct sockaddr_in source_addr,int source_len,int response_len) 
-{    // === 批量处理所有等待的上游响应 ===
-    /*
-     * 与处理客户端请求类似，批量处理所有等待的响应。
-     * 这样可以减少select()调用次数，提高处理效率。
-     */
-    (void)source_addr; // 标记参数已使用，避免编译警告
-    (void)source_len;  // 标记参数已使用，避免编译警告=== 提取响应Transaction ID ===
-    // 这是我们之前分配给上游请求的新ID
-    unsigned short response_id = dns_entity->id;
-    log_debug("响应来源: 上游DNS服务器 - 处理响应ID: %d", response_id);
-    log_debug("正在处理上游ID为 %d 的响应", response_id);
-    log_debug("%s",dns_entity_to_string(dns_entity));
-    dns_mapping_entry_t* mapping = thread_pool_find_mapping_safe(response_id);
-    if (!mapping) {
-        log_warn("未找到响应ID %d 对应的映射，丢弃响应", response_id);
-        source_len = sizeof(source_addr);  // 重置地址长度
-        return ;
-    }    
-    // === 恢复原始Transaction ID ===
-     unsigned short original_id = mapping->original_id;
-    dns_entity->id = original_id;
-    
-    log_debug("恢复响应ID: %d -> %d，目标客户端 %s:%d", 
-             response_id, original_id,
-             inet_ntoa(mapping->client_addr.sin_addr), 
-             ntohs(mapping->client_addr.sin_port));
-    
-    if (sendDnsPacket(server_socket, mapping->client_addr, dns_entity) == MYERROR) 
-    {
-        int send_error = platform_get_last_error();
-        log_error("向客户端 %s:%d 发送响应失败: %d",
-        inet_ntoa(mapping->client_addr.sin_addr), 
-        ntohs(mapping->client_addr.sin_port), send_error);
-    } 
-    else 
-    {
-        log_info("已向客户端 %s:%d 发送响应 (%d 字节，原始ID=%d)",
-        inet_ntoa(mapping->client_addr.sin_addr), 
-        ntohs(mapping->client_addr.sin_port), response_len, original_id);
-    }
-        
-    // === 清理完成的映射关系 ===
-    thread_pool_remove_mapping_safe(response_id);
-    
-    // === 将查询结果插入缓存 ===
-    if (dns_relay_cache_response(dns_entity->questions->qname, dns_entity->questions->qtype, dns_entity) != MYSUCCESS) {
-        log_warn("将响应缓存失败: %s", dns_entity->questions->qname);
-    } else {
-        log_debug("已将响应缓存: %s", dns_entity->questions->qname);
-    }
-
-
-}
-
-/**
- * @brief 多线程版本的DNS代理服务器主函数
- * 
- * 这是DNS代理服务器的多线程版本，实现了：
- * 1. I/O线程负责网络数据接收和发送
- * 2. 工作线程池负责DNS数据包解析和处理
- * 3. 线程安全的ID映射表操作
- * 4. 高并发性能和多核CPU利用
- * 
- * 架构特点：
- * - 主线程作为I/O线程，专门处理网络事件
- * - 工作线程池处理CPU密集型任务
- * - 线程安全的资源访问
- * - 优雅的关闭机制
- * 
- * @return int 成功返回 MYSUCCESS，失败返回 MYERROR
- */
-int start_dns_proxy_server_threaded() {
-    struct sockaddr_in server_addr; // 服务器地址结构    
-    log_info("=== 启动多线程DNS代理服务器 ===");    
-    
-
-    // === 第一步：初始化映射表 ===
-    init_mapping_table(&g_mapping_table);
-    log_debug("初始化映射表 (最大并发请求数: %d)", MAX_CONCURRENT_REQUESTS);
-
-
-    // === 第二步：创建服务器socket ===
-    server_socket = create_socket();
-    if (server_socket == INVALID_SOCKET) {
-        log_error("创建SOCKET失败，错误代码: %d", platform_get_last_error());
-        return MYERROR;
-    }
-    log_debug("SOCKET 创建成功");
-
-    // === 第三步：设置服务器socket为非阻塞模式 ===
-    if (set_socket_nonblocking(server_socket) == SOCKET_ERROR) {
-        log_error("设置socket非阻塞失败: %d", platform_get_last_error());
-        closesocket(server_socket);
-        return MYERROR;
-    }
-    log_debug("设置socket非阻塞成功");
-
-    // === 第四步：设置socket选项 ===
-    if (set_socket_reuseaddr(server_socket) == SOCKET_ERROR) {
-        log_warn("setsockopt(SO_REUSEADDR) 失败，错误码: %d", platform_get_last_error());
-    }
-
-    // === 第五步：配置并绑定服务器地址 ===
-    memset(&server_addr, 0, sizeof(server_addr)); // 清零结构体
-    server_addr.sin_family = AF_INET;              // IPv4协议族
-    server_addr.sin_addr.s_addr = INADDR_ANY;      // 监听所有网络接口
-    server_addr.sin_port = htons(DNS_PORT);        // DNS标准端口53
-
-    // 将套接字绑定到指定的IP地址和端口
-    if (bind(server_socket, (struct sockaddr*)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
-        log_error("监听端口号 %d 失败，错误码: %d", DNS_PORT, platform_get_last_error());
-        closesocket(server_socket);
-        return MYERROR;
-    }
-
-    log_info("DNS服务成功绑定到端口: %d", DNS_PORT);
-
-    // === 第六步：初始化线程池 ===
-    int worker_count = 0; // 使用默认线程数（基于CPU核心数）
-    int queue_size = 0;   // 使用默认队列大小
-    
-    if (thread_pool_init(&g_dns_thread_pool, worker_count, queue_size, 
-                        server_socket, &g_mapping_table) != MYSUCCESS) {
-        log_error("线程池初始化失败");
-        closesocket(server_socket);
-        return MYERROR;
-    }
-
-    // 设置全局线程池实例，以便其他模块可以访问互斥锁
-    thread_pool_set_global_instance(&g_dns_thread_pool);
-
-    // === 第七步：启动线程池 ===
-    if (thread_pool_start(&g_dns_thread_pool) != MYSUCCESS) {
-        log_error("线程池启动失败");
-        thread_pool_destroy(&g_dns_thread_pool);
-        closesocket(server_socket);
-        return MYERROR;
-    }
-
-    // === 第八步：主I/O事件循环 ===
-    /*
-     * 在多线程架构中，主线程专门负责I/O操作：
-     * 1. 监听网络事件（socket可读）
-     * 2. 接收UDP数据包
-     * 3. 将数据包封装成任务并提交给线程池
-     * 4. 定期执行维护任务
-     * 
-     * 这种设计的优势：
-     * - I/O操作不被CPU密集型任务阻塞
-     * - 工作线程专注于数据处理
-     * - 充分利用多核CPU
-     * - 提高系统整体吞吐量
-     */
-    int server_running = 1;
-    time_t last_cleanup = time(NULL);
-    time_t last_status_print = time(NULL);
-    
-    while (server_running) {
-        fd_set read_fds;        // 可读文件描述符集合
-        struct timeval timeout; // select()超时设置
-        
-        // === 准备监听的socket集合 ===
-        FD_ZERO(&read_fds);                    // 清空文件描述符集合
-        FD_SET(server_socket, &read_fds);      // 添加服务器socket
-        
-        // === 设置select超时时间 ===
-        // 较短的超时时间确保及时响应维护任务
-        timeout.tv_sec = 1;
-        timeout.tv_usec = 0;
-        
-        // === 调用select()等待网络事件 ===
-        int activity = select(server_socket + 1, &read_fds, NULL, NULL, &timeout);
-        
-        // === 处理select()返回值 ===
-        if (activity == SOCKET_ERROR) {
-            log_error("select() 调用失败，错误码: %d", platform_get_last_error());
-            break; // 发生严重错误，退出主循环
-        }
-        
-        // === 处理网络数据接收 ===
-        if (activity > 0 && FD_ISSET(server_socket, &read_fds)) {
-            handle_receive_threaded();
-        }
-        
-        // === 定期维护任务 ===
-        time_t current_time = time(NULL);
-        
-        // 每10秒清理一次过期映射
-        if (current_time - last_cleanup > 10) {
-            thread_pool_cleanup_mappings_safe();
-            last_cleanup = current_time;
-            log_debug("定期清理过期映射完成");
-        }
-        
-        // 每30秒打印一次服务器状态
-        if (current_time - last_status_print > 30) {
-            thread_pool_print_status(&g_dns_thread_pool);
-            last_status_print = current_time;
-        }
-    }    // === 清理资源 ===
-    log_info("正在关闭多线程DNS代理服务器...");
-    
-    // 停止线程池（给工作线程5秒时间完成当前任务）
-    thread_pool_stop(&g_dns_thread_pool, 5000);
-    
-    // 销毁线程池
-    thread_pool_destroy(&g_dns_thread_pool);
-    
-    // 清除全局线程池实例
-    thread_pool_set_global_instance(NULL);
-    
-    // 清理DNS上游服务器池
-    upstream_pool_destroy(&g_upstream_pool);
-    log_debug("DNS上游服务器池已清理");
-
-    // 清理DNS缓存
-    dns_cache_destroy();
-
-    // 关闭服务器socket
-    closesocket(server_socket);
-    
-    log_info("多线程DNS代理服务器已关闭");
-    return MYSUCCESS;
-}
-
-/**
- * @brief 多线程版本的网络数据接收处理函数
- * 
- * 与单线程版本的主要区别：
- * 1. 不直接解析和处理DNS数据包
- * 2. 将接收到的原始数据提交给线程池
- * 3. 由工作线程异步处理具体的DNS逻辑
- * 4. 提高I/O处理的响应速度
- */
-int handle_receive_threaded() {
-    char receive_buffer[BUF_SIZE]; // 存储接收数据的缓冲区
-    struct sockaddr_in source_addr; // 接收数据的源地址
-    socklen_t source_addr_len = sizeof(source_addr);
-    int receive_len = 0; // 接收到的数据长度
-    int receive_processed = 0;     // 本次处理的数据计数
-
-    // === 批量处理接收到的数据 ===
-    // 使用while循环确保一次select事件中处理所有可用数据
-    while((receive_len = recvfrom(server_socket, receive_buffer, BUF_SIZE, 0, 
-                                 (struct sockaddr*)&source_addr, &source_addr_len)) > 0) {
-        receive_processed++;
-        char* source_ip = inet_ntoa(source_addr.sin_addr);
-        
-        // === 验证请求数据完整性 ===
-        if (receive_len < 2) {
-            log_warn("请求数据过短 (%d 字节)，来源: %s，忽略处理", receive_len, source_ip);
-            source_addr_len = sizeof(source_addr);  // 重置地址长度
-            continue;
-        }
-
-        // === 确定任务类型 ===
-        task_type_t task_type;
-        if (upstream_pool_contains_server(&g_upstream_pool, source_ip) == 0) {
-            // 来自客户端的请求
-            task_type = TASK_CLIENT_REQUEST;
-            log_debug("收到客户端请求: %s, 长度: %d 字节", source_ip, receive_len);
-        } else {
-            // 来自上游DNS服务器的响应
-            task_type = TASK_UPSTREAM_RESPONSE;
-            log_debug("收到上游响应: %s, 长度: %d 字节", source_ip, receive_len);
-        }
-
-        // === 提交任务到线程池 ===
-        if (thread_pool_submit_task(&g_dns_thread_pool, receive_buffer, receive_len,
-                                   source_addr, source_addr_len, task_type) != MYSUCCESS) {
-            log_warn("任务提交失败，可能是队列已满，来源: %s", source_ip);
-        }
-
-        // 重置地址长度，为下一次接收准备
-        source_addr_len = sizeof(source_addr);
-    }
-
-    // 记录批量处理结果
-    if (receive_processed > 0) {
-        log_debug("批量接收处理完成，本次处理: %d 个数据包", receive_processed);
-    }
-
-    // 检查是否是由于错误而退出循环
-    if (receive_len < 0) {
-        int error = platform_get_last_error();
-        // 对于非阻塞socket，EAGAIN/EWOULDBLOCK是正常的
-#ifdef _WIN32
-        if (error != WSAEWOULDBLOCK) {
-#else
-        if (error != EAGAIN && error != EWOULDBLOCK) {
-#endif
-            log_error("recvfrom() 失败，错误码: %d", error);
-            return MYERROR;
-        }
-    }
-    
-    return MYSUCCESS;
-}
-
+#include "websocket/dnsServer.h"
+#include "platform/platform.h"
+#include "Thread/thread_pool.h"
+#include "DNScache/relayBuild.h"
+#include <time.h>  // 添加时间相关的头文件支持
+#include <string.h> // 包含 memset 和 strcmp
+
+
+/*
+ * ============================================================================
+ * 全局变量声明
+ * ============================================================================
+ */
+
+// 全局映射表：维护客户端请求ID与上游服务器响应ID的映射关系
+// 这是实现并发处理的核心数据结构，确保响应能正确返回给对应的客户端
+static dns_mapping_table_t g_mapping_table;
+
+// 监听分片（SO_REUSEPORT）：每个分片一个绑定到DNS端口的套接字
+// 由内核按客户端四元组把流量分散到各分片，各分片的I/O线程独立收包
+static dns_listen_shard_t g_listen_shards[MAX_LISTEN_SHARDS];
+static int g_listen_shard_count = 0;
+
+// 上游接收端点：每个上游专用的已连接套接字，轮流挂到各监听分片的事件循环上
+// 数据报类型由套接字确定，无需按源地址判断
+static dns_listen_shard_t g_upstream_receivers[MAX_UPSTREAM_SERVERS];
+static int g_upstream_receiver_count = 0;
+
+// 服务器运行标志（分片I/O线程据此退出）
+static volatile int g_server_running = 0;
+
+// 线程池实例（用于多线程处理）
+static dns_thread_pool_t g_dns_thread_pool;
+
+
+/*
+ * ============================================================================
+ * 并发请求处理函数
+ * ============================================================================
+ */
+
+/**
+ * @brief 为即将过期的热点缓存条目向上游发起一次预取
+ *
+ * 用请求的第一个问题构造一个查询（RD、CD位沿用原请求），附带声明DNS_EDNS_UDP_PAYLOAD字节载荷的OPT记录，
+ * 使超过512字节的应答不被截断；以INVALID_SOCKET作为映射的客户端套接字，
+ * 上游响应到达后只写入缓存、不回送客户端；失败时条目保持原样，由后续命中或过期自然处理。
+ *
+ * @param sock 接收该请求的监听套接字（与转发路径一致传给上游发送函数）
+ * @param request 命中缓存的请求视图
+ */
+static void refresh_cache_entry(SOCKET sock, const dns_msg_view_t* request) {
+    char query[DNS_HEADER_SIZE + DNS_MAX_NAME_WIRE_LEN + 4 + DNS_OPT_RR_SIZE];
+    unsigned short flags = request->flags & (DNS_FLAG_RD | DNS_FLAG_CD);
+    int query_len = build_template_response(request, flags, 0, NULL, 0, query, sizeof(query));
+    if (query_len >= 0) {
+        query_len = dns_append_opt_record(query, query_len, sizeof(query), DNS_EDNS_UDP_PAYLOAD);
+    }
+    if (query_len < 0) {
+        return;
+    }
+
+    struct sockaddr_in no_client;
+    memset(&no_client, 0, sizeof(no_client));
+    unsigned short new_id;
+    if (thread_pool_add_mapping_safe(0, &no_client, sizeof(no_client), INVALID_SOCKET, &new_id) != MYSUCCESS) {
+        log_debug("预取映射添加失败，跳过本次刷新");
+        return;
+    }
+    *(unsigned short*)query = htons(new_id);
+
+    if (sendDnsRawPacketToNextUpstream(sock, query, query_len) != MYSUCCESS) {
+        log_debug("预取请求发送失败 (上游ID=%d)", new_id);
+        thread_pool_remove_mapping_safe(new_id);
+    } else {
+        log_debug("已向上游发起缓存预取，上游ID=%d", new_id);
+    }
+}
+
+/**
+ * @brief 用本地域名表或缓存直接应答客户端请求
+ *
+ * 命中本地表（含屏蔽域名）时用预编译的应答模板拼出响应，命中缓存时直接发送缓存报文（只改写ID），经sock发回客户端。
+ * 命中的热点条目进入TTL末段时，应答发出后再向上游预取一次，使条目在过期前被新响应替换。
+ * 只用到请求的报文头和第一个问题，查询名在此按需解码。
+ * 工作线程和启用快速路径的I/O线程共用此函数。
+ *
+ * @param sock 接收该请求的监听套接字，用于发送响应
+ * @param request 只解析了问题部分的请求视图（至少含一个问题）
+ * @return 已应答返回1，缓存未命中返回0（需转发上游）
+ */
+static int answer_client_request_locally(SOCKET sock, const dns_msg_view_t* request, struct sockaddr_in client_addr) {
+    // 查询本地表和缓存，缓存命中的报文直接写入栈上缓冲区；查询名无法无歧义解码时交给上游
+    dns_query_response_t response;
+    char packet[BUF_SIZE];
+    if (dns_relay_query(request, &response, packet, sizeof(packet)) != MYSUCCESS) {
+        return 0;
+    }
+
+    int send_result;
+    switch (response.result_type){
+        case QUERY_RESULT_BLOCKED:
+            log_debug("响应来源: 域名被屏蔽 - 返回域名不存在");
+            break;
+        case QUERY_RESULT_LOCAL_HIT:
+            log_debug("响应来源: 本地域名表命中 - IP: %s", response.resolved_ip);
+            break;
+        case QUERY_RESULT_CACHE_HIT:
+            log_debug("响应来源: 缓存命中 - 直接返回缓存报文");
+            break;
+        default:
+            log_debug("响应来源: 缓存未命中 - 需要向上游DNS服务器查询");
+            return 0;
+    }
+
+    if (response.result_type == QUERY_RESULT_CACHE_HIT) {
+        // 缓存报文的TTL已改写为剩余时间，这里只需写入请求的ID
+        *((unsigned short*)packet) = htons(request->id);
+        send_result = sendDnsRawPacket(sock, &client_addr, packet, response.packet_len);
+    } else {
+        // 本地表应答：报文头和问题照抄请求，回答记录直接使用加载时预编译的模板
+        const dns_answer_template_t* answer = &response.answer;
+        int packet_len = build_template_response(request, answer->flags, answer->ancount,
+                                                 answer->rr, answer->rr_len, packet, sizeof(packet));
+        if (packet_len < 0) {
+            log_error("构造本地响应失败 (ID=%d)", request->id);
+            return 1;
+        }
+        send_result = sendDnsRawPacket(sock, &client_addr, packet, packet_len);
+    }
+
+    if (send_result == MYERROR) 
+    {
+        int send_error = platform_get_last_error();
+        log_error("向客户端 %s:%d 发送响应失败: %d",
+        inet_ntoa(client_addr.sin_addr), 
+        ntohs(client_addr.sin_port), send_error);
+    } 
+    else 
+    {
+        log_info("已向客户端 %s:%d 发送响应 (原始ID=%d)",
+        inet_ntoa(client_addr.sin_addr), 
+        ntohs(client_addr.sin_port), request->id);
+    }
+
+    if (response.result_type == QUERY_RESULT_CACHE_HIT && response.needs_refresh) {
+        refresh_cache_entry(sock, request);
+    }
+    return 1;
+}
+
+/**
+ * @brief 将缓存未命中的客户端请求转发到上游
+ *
+ * 为请求创建ID映射、在原报文上改写Transaction ID，再原样轮询发往上游DNS服务器
+ * （EDNS等附加记录随报文一起转发，不重新编码）。
+ *
+ * @param sock 接收该请求的监听套接字（上游响应经此返回客户端）
+ * @param packet 已校验过的请求报文，ID会被原地改写
+ * @param packet_len 报文长度
+ */
+void forward_client_request(SOCKET sock, char* packet, int packet_len, struct sockaddr_in client_addr, int client_addr_len) {
+    if (packet_len < DNS_HEADER_SIZE) {
+        return;
+    }
+
+    // === 提取原始Transaction ID ===
+    // DNS头部的前2个字节是Transaction ID（网络字节序）
+    unsigned short original_id = ntohs(*(unsigned short*)packet);
+    unsigned short new_id;
+        
+    // === 创建ID映射关系 ===      
+    if (thread_pool_add_mapping_safe(original_id, &client_addr, client_addr_len, sock, &new_id) != MYSUCCESS) {
+        log_error("为来自 %s:%d 的请求添加映射失败 (原始ID=%d)",
+                    inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port), original_id);
+        return;
+    }    
+    // === 修改请求的Transaction ID ===
+    *(unsigned short*)packet = htons(new_id);
+    log_debug("修改请求ID: %d -> %d", original_id, new_id);
+    
+    // === 转轮询请求到上游DNS服务器 ===
+    if (sendDnsRawPacketToNextUpstream(sock, packet, packet_len) != MYSUCCESS) {
+        log_error("转发请求到上游服务器失败 (新ID=%d)", new_id);
+        // 转发失败，清理刚创建的映射
+        thread_pool_remove_mapping_safe(new_id);
+    } else {
+        log_debug("成功转发请求到轮询上游服务器，上游ID=%d", new_id);
+    }
+}
+
+/**
+ * @brief 处理客户端请求
+ * 
+ * 这个函数处理来自客户端的DNS请求，实现了：
+ * 1. 只解析报文头和问题部分（回答、授权、附加记录不解析）
+ * 2. 查询本地域名表和缓存，命中则直接应答
+ * 3. 为未命中的请求创建ID映射、修改请求ID并原样转发到上游DNS服务器
+ * 
+ * 处理流程：
+ * 客户端请求 -> 头部+问题 -> 本地表/缓存 -> (未命中) 创建映射 -> 修改ID -> 转发上游
+ * 
+ * @param sock 接收该请求的监听套接字，用于转发请求和发送响应
+ * @param packet 请求报文（转发时ID会被原地改写）
+ * @return 已处理返回MYSUCCESS，报文无效返回MYERROR
+ */
+int handle_client_requests(SOCKET sock, char* packet, int packet_len, struct sockaddr_in client_addr, int client_addr_len) {
+    log_debug("收到来自 %s:%d 的DNS请求 (%d 字节)",
+            inet_ntoa(client_addr.sin_addr), 
+            ntohs(client_addr.sin_port), packet_len);
+
+    dns_msg_view_t request;
+    if (dns_msg_view_parse_question(&request, packet, packet_len) != MYSUCCESS || request.question_count == 0) {
+        log_warn("来自 %s:%d 的请求无效或不含问题部分",
+                 inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+        return MYERROR;
+    }
+
+    if (!answer_client_request_locally(sock, &request, client_addr)) {
+        forward_client_request(sock, packet, packet_len, client_addr, client_addr_len);
+    }
+    return MYSUCCESS;
+}
+
+/**
+ * @brief I/O线程快速路径：在收包线程内直接应答本地表和缓存命中的请求
+ *
+ * 命中时不经过线程池，解析、查询、发送都在当前I/O线程完成；
+ * 未命中时返回0，由调用方以TASK_CLIENT_FORWARD提交线程池，工作线程不再重复解析和查询。
+ *
+ * @param shard 收到该请求的监听分片
+ * @param dgram 请求数据报
+ * @return 已应答返回1，需要转发上游返回0，数据包无效返回-1
+ */
+static int handle_client_request_inline(dns_listen_shard_t* shard, const platform_dgram_t* dgram) {
+    dns_msg_view_t request;
+    if (dns_msg_view_parse_question(&request, dgram->buffer, dgram->length) != MYSUCCESS) {
+        log_warn("分片%d：DNS数据包解析失败，来源: %s", shard->index, inet_ntoa(dgram->addr.sin_addr));
+        return -1;
+    }
+    if (request.question_count == 0) {
+        log_warn("分片%d：请求不含问题部分，来源: %s", shard->index, inet_ntoa(dgram->addr.sin_addr));
+        return -1;
+    }
+
+    return answer_client_request_locally(shard->sock, &request, dgram->addr);
+}
+
+/**
+ * @brief 处理上游服务器响应
+ * 
+ * 这个函数处理来自上游DNS服务器的响应，实现了：
+ * 1. 从报文头读取响应ID，查找对应的客户端映射
+ * 2. 原地改写报文前2字节恢复原始Transaction ID
+ * 3. 将报文原样转发回原始客户端（保留上游的名字压缩）
+ * 4. 清理完成的映射关系
+ * 5. 按线路格式将报文插入缓存（解析仅用于取出问题部分）
+ * 缓存预取发起的请求没有客户端（映射的client_sock为INVALID_SOCKET），跳过第2、3步。
+ * 
+ * 处理流程：
+ * 上游响应 -> 读取ID -> 查找映射 -> 改写ID -> 原样转发客户端 -> 清理映射 -> 缓存
+ * 
+ * @param sock 接收该响应的上游专用套接字（响应经映射中记录的监听套接字返回客户端）
+ * @param packet 响应报文（ID字段会被原地改写）
+ * @param response_len 报文长度
+ */
+void handle_upstream_responses(SOCKET sock, char* packet, int response_len, struct sockaddr_in source_addr, int source_len) 
+{
+    (void)sock;        // 标记参数已使用，避免编译警告
+    (void)source_addr; // 标记参数已使用，避免编译警告
+    (void)source_len;  // 标记参数已使用，避免编译警告
+
+    if (response_len < DNS_HEADER_SIZE) {
+        log_warn("上游响应过短 (%d 字节)，丢弃", response_len);
+        return;
+    }
+
+    // === 提取响应Transaction ID ===
+    // 这是我们之前分配给上游请求的新ID（报文前2字节，网络字节序）
+    unsigned short response_id = ntohs(*((unsigned short*)packet));
+    log_debug("响应来源: 上游DNS服务器 - 处理响应ID: %d", response_id);
+
+    dns_mapping_entry_t* mapping = thread_pool_find_mapping_safe(response_id);
+    if (!mapping) {
+        log_warn("未找到响应ID %d 对应的映射，丢弃响应", response_id);
+        return ;
+    }
+    // 映射删除后不可再访问，先取出需要的字段
+    unsigned short original_id = mapping->original_id;
+    struct sockaddr_in client_addr = mapping->client_addr;
+    SOCKET client_sock = mapping->client_sock;
+
+    if (client_sock == INVALID_SOCKET) {
+        // 缓存预取的响应：没有等待中的客户端，只刷新缓存
+        log_debug("收到缓存预取的上游响应 (上游ID=%d)", response_id);
+    } else {
+        // === 恢复原始Transaction ID：只改写报文前2字节 ===
+        *((unsigned short*)packet) = htons(original_id);
+
+        log_debug("恢复响应ID: %d -> %d，目标客户端 %s:%d", 
+                 response_id, original_id,
+                 inet_ntoa(client_addr.sin_addr), 
+                 ntohs(client_addr.sin_port));
+
+        if (sendDnsRawPacket(client_sock, &client_addr, packet, response_len) == MYERROR) 
+        {
+            int send_error = platform_get_last_error();
+            log_error("向客户端 %s:%d 发送响应失败: %d",
+            inet_ntoa(client_addr.sin_addr), 
+            ntohs(client_addr.sin_port), send_error);
+        } 
+        else 
+        {
+            log_info("已向客户端 %s:%d 发送响应 (%d 字节，原始ID=%d)",
+            inet_ntoa(client_addr.sin_addr), 
+            ntohs(client_addr.sin_port), response_len, original_id);
+        }
+    }
+        
+    // === 清理完成的映射关系 ===
+    thread_pool_remove_mapping_safe(response_id);
+    
+    // === 将查询结果插入缓存（响应已发出，解析不再影响应答延迟） ===
+    // 报文视图只记录偏移，不分配内存；查询名按需解码
+    dns_msg_view_t view;
+    char qname[DNS_NAME_BUF_SIZE];
+    if (dns_msg_view_parse(&view, packet, response_len) != MYSUCCESS || view.question_count == 0 ||
+        dns_msg_view_read_name(&view, view.questions[0].name_offset, qname, sizeof(qname)) < 0) {
+        log_debug("上游响应无法解析、不含问题部分或查询名含'.'/NUL标签，不缓存 (ID=%d)", original_id);
+        return;
+    }
+    if (dns_relay_cache_response(&view) != MYSUCCESS) {
+        log_warn("将响应缓存失败: %s", qname);
+    } else {
+        log_debug("已将响应缓存: %s", qname);
+    }
+}
+
+/**
+ * @brief 使用默认值填充服务器配置
+ */
+void dns_server_config_init(dns_server_config_t* config) {
+    if (!config) return;
+
+    config->recv_batch_size = DEFAULT_RECV_BATCH_SIZE;
+    config->send_batch_size = DEFAULT_SEND_BATCH_SIZE;
+    config->listen_shards = DEFAULT_LISTEN_SHARDS;
+    config->inline_fast_path = DEFAULT_INLINE_FAST_PATH;
+    config->cache_config_file = NULL;
+}
+
+/**
+ * @brief 创建并绑定一个监听套接字（非阻塞，设置SO_REUSEADDR/SO_REUSEPORT）
+ * @return 成功返回套接字，失败返回INVALID_SOCKET
+ */
+static SOCKET create_listen_socket(void) {
+    struct sockaddr_in server_addr; // 服务器地址结构
+
+    SOCKET sock = create_socket();
+    if (sock == INVALID_SOCKET) {
+        log_error("创建SOCKET失败，错误代码: %d", platform_get_last_error());
+        return INVALID_SOCKET;
+    }
+
+    if (set_socket_nonblocking(sock) == SOCKET_ERROR) {
+        log_error("设置socket非阻塞失败: %d", platform_get_last_error());
+        closesocket(sock);
+        return INVALID_SOCKET;
+    }
+
+    // 多个分片绑定同一端口依赖SO_REUSEPORT，必须在bind之前设置
+    if (set_socket_reuseaddr(sock) == SOCKET_ERROR) {
+        log_warn("setsockopt(SO_REUSEADDR) 失败，错误码: %d", platform_get_last_error());
+    }
+
+    memset(&server_addr, 0, sizeof(server_addr)); // 清零结构体
+    server_addr.sin_family = AF_INET;              // IPv4协议族
+    server_addr.sin_addr.s_addr = INADDR_ANY;      // 监听所有网络接口
+    server_addr.sin_port = htons(DNS_PORT);        // DNS标准端口53
+
+    if (bind(sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
+        log_error("监听端口号 %d 失败，错误码: %d", DNS_PORT, platform_get_last_error());
+        closesocket(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+/**
+ * @brief 初始化监听分片：创建套接字、批量接收缓冲区和事件循环
+ *
+ * 启用I/O线程快速路径且批量发送大小大于1时，分片另持有一个批量发送缓冲区，
+ * 收包线程内直接应答的响应在一轮接收结束后统一发出。
+ */
+static int listen_shard_init(dns_listen_shard_t* shard, int index, const dns_server_config_t* config) {
+    int batch_size = config->recv_batch_size;
+
+    memset(shard, 0, sizeof(*shard));
+    shard->index = index;
+    shard->sock = INVALID_SOCKET;
+    shard->inline_fast_path = config->inline_fast_path;
+
+    if (batch_size < 1) batch_size = 1;
+    if (batch_size > RECV_BATCH_MAX) batch_size = RECV_BATCH_MAX;
+
+    shard->recv_storage = (char*)malloc((size_t)batch_size * BUF_SIZE);
+    if (!shard->recv_storage) {
+        log_error("分片%d批量接收缓冲区内存分配失败，批量大小: %d", index, batch_size);
+        return MYERROR;
+    }
+    for (int i = 0; i < batch_size; i++) {
+        shard->recv_dgrams[i].buffer = shard->recv_storage + (size_t)i * BUF_SIZE;
+        shard->recv_dgrams[i].buffer_size = BUF_SIZE;
+    }
+    shard->recv_batch_size = batch_size;
+
+    shard->sock = create_listen_socket();
+    if (shard->sock == INVALID_SOCKET) {
+        free(shard->recv_storage);
+        shard->recv_storage = NULL;
+        return MYERROR;
+    }
+
+    if (platform_event_loop_init(&shard->event_loop) != 0 ||
+        platform_event_loop_add(&shard->event_loop, shard->sock, shard) != 0) {
+        log_error("分片%d事件循环初始化失败，错误码: %d", index, platform_get_last_error());
+        platform_event_loop_destroy(&shard->event_loop);
+        closesocket(shard->sock);
+        shard->sock = INVALID_SOCKET;
+        free(shard->recv_storage);
+        shard->recv_storage = NULL;
+        return MYERROR;
+    }
+
+    if (shard->inline_fast_path && config->send_batch_size > 1 &&
+        send_batch_init(&shard->send_batch, config->send_batch_size) != MYSUCCESS) {
+        log_warn("分片%d批量发送缓冲区初始化失败，快速路径响应将逐个发送", index);
+    }
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 释放监听分片资源（I/O线程需已退出）
+ */
+static void listen_shard_destroy(dns_listen_shard_t* shard) {
+    send_batch_destroy(&shard->send_batch);
+    platform_event_loop_destroy(&shard->event_loop);
+    if (shard->sock != INVALID_SOCKET) {
+        closesocket(shard->sock);
+        shard->sock = INVALID_SOCKET;
+    }
+    if (shard->recv_storage) {
+        free(shard->recv_storage);
+        shard->recv_storage = NULL;
+    }
+}
+
+/**
+ * @brief 非0号分片的I/O线程：独立的事件循环，只负责收包和提交任务
+ */
+static THREAD_RETURN_TYPE listen_shard_thread_main(void* arg) {
+    dns_listen_shard_t* shard = (dns_listen_shard_t*)arg;
+    platform_event_t events[PLATFORM_EVENT_MAX];
+
+    log_debug("监听分片%d的I/O线程启动", shard->index);
+    if (shard->send_batch.capacity > 0) {
+        send_batch_bind_current_thread(&shard->send_batch);
+    }
+    while (g_server_running) {
+        // 超时等待以便及时感知服务器关闭
+        int ready = platform_event_loop_wait(&shard->event_loop, events, PLATFORM_EVENT_MAX,
+                                             HOUSEKEEPING_INTERVAL_MS);
+        if (ready < 0) {
+            log_error("分片%d等待事件失败，错误码: %d", shard->index, platform_get_last_error());
+            break;
+        }
+        for (int i = 0; i < ready; i++) {
+            handle_receive_threaded((dns_listen_shard_t*)events[i].data);
+        }
+    }
+    send_batch_bind_current_thread(NULL);
+    log_debug("监听分片%d的I/O线程退出", shard->index);
+    return THREAD_RETURN_VALUE;
+}
+
+/**
+ * @brief 创建上游专用套接字，并把每个套接字挂到一个监听分片的事件循环上
+ *
+ * 第i个上游挂到第(i % 分片数)个分片，由该分片的I/O线程接收，
+ * 与分片共用接收缓冲区（同一线程顺序处理，且提交任务时已拷贝数据）。
+ */
+static int upstream_receivers_attach(void) {
+    if (upstream_pool_open_sockets(&g_upstream_pool) != MYSUCCESS) {
+        return MYERROR;
+    }
+
+    for (int i = 0; i < g_upstream_pool.server_count; i++) {
+        dns_listen_shard_t* host = &g_listen_shards[i % g_listen_shard_count];
+        dns_listen_shard_t* receiver = &g_upstream_receivers[i];
+
+        memset(receiver, 0, sizeof(*receiver));
+        receiver->index = i;
+        receiver->is_upstream = 1;
+        receiver->sock = g_upstream_pool.sockets[i];
+        receiver->recv_batch_size = host->recv_batch_size;
+        memcpy(receiver->recv_dgrams, host->recv_dgrams, sizeof(platform_dgram_t) * host->recv_batch_size);
+
+        if (platform_event_loop_add(&host->event_loop, receiver->sock, receiver) != 0) {
+            log_error("注册上游套接字%d失败，错误码: %d", i, platform_get_last_error());
+            upstream_pool_close_sockets(&g_upstream_pool);
+            g_upstream_receiver_count = 0;
+            return MYERROR;
+        }
+        g_upstream_receiver_count++;
+    }
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 停止所有分片I/O线程并释放分片资源
+ */
+static void listen_shards_shutdown(void) {
+    g_server_running = 0;
+    for (int i = 0; i < g_listen_shard_count; i++) {
+        if (g_listen_shards[i].thread_started) {
+            platform_thread_join(g_listen_shards[i].thread_id, NULL);
+            g_listen_shards[i].thread_started = 0;
+        }
+    }
+    for (int i = 0; i < g_listen_shard_count; i++) {
+        listen_shard_destroy(&g_listen_shards[i]);
+    }
+    g_listen_shard_count = 0;
+
+    // 上游套接字归上游服务器池所有，这里只关闭并清空接收端点
+    upstream_pool_close_sockets(&g_upstream_pool);
+    g_upstream_receiver_count = 0;
+}
+
+/**
+ * @brief 打印各监听分片的接收统计
+ */
+static void print_listen_shard_status(void) {
+    printf("=== 监听分片 (SO_REUSEPORT) ===\n");
+    printf("分片数: %d\n", g_listen_shard_count);
+    for (int i = 0; i < g_listen_shard_count; i++) {
+        dns_listen_shard_t* shard = &g_listen_shards[i];
+        printf("分片%d: 数据包 %lu (客户端 %lu, 上游 %lu), 提交失败 %lu",
+               i, shard->recv_packet_count, shard->client_requests,
+               shard->upstream_responses, shard->submit_failures);
+        if (shard->inline_fast_path) {
+            printf(", 快速路径应答 %lu", shard->inline_answers);
+        }
+        if (shard->recv_batch_count > 0) {
+            printf(", recvmmsg平均填充 %.2f/%d",
+                   (double)shard->recv_packet_count / shard->recv_batch_count, shard->recv_batch_size);
+        }
+        printf("\n");
+    }
+    for (int i = 0; i < g_upstream_receiver_count; i++) {
+        dns_listen_shard_t* receiver = &g_upstream_receivers[i];
+        printf("上游%d (%s): 响应 %lu, 提交失败 %lu\n",
+               i, inet_ntoa(g_upstream_pool.servers[i].sin_addr),
+               receiver->upstream_responses, receiver->submit_failures);
+    }
+    printf("===================\n\n");
+}
+
+/**
+ * @brief 多线程版本的DNS代理服务器主函数
+ * 
+ * 这是DNS代理服务器的多线程版本，实现了：
+ * 1. I/O线程负责网络数据接收和发送
+ * 2. 工作线程池负责DNS数据包解析和处理
+ * 3. 线程安全的ID映射表操作
+ * 4. 高并发性能和多核CPU利用
+ * 
+ * 架构特点：
+ * - 主线程作为I/O线程，专门处理网络事件
+ * - 工作线程池处理CPU密集型任务
+ * - 线程安全的资源访问
+ * - 优雅的关闭机制
+ * 
+ * @return int 成功返回 MYSUCCESS，失败返回 MYERROR
+ */
+int start_dns_proxy_server_threaded(const dns_server_config_t* config) {
+    dns_server_config_t default_config;
+    log_info("=== 启动多线程DNS代理服务器 ===");    
+
+    if (!config) {
+        dns_server_config_init(&default_config);
+        config = &default_config;
+    }
+
+    int shard_count = config->listen_shards;
+    if (shard_count <= 0) {
+        shard_count = platform_get_cpu_count();
+    }
+    if (shard_count > MAX_LISTEN_SHARDS) {
+        shard_count = MAX_LISTEN_SHARDS;
+    }
+#ifdef _WIN32
+    // Windows没有SO_REUSEPORT的负载分担语义，只使用单个监听套接字
+    if (shard_count > 1) {
+        log_warn("当前平台不支持SO_REUSEPORT分片，监听分片数回退为1");
+        shard_count = 1;
+    }
+#endif
+    if (shard_count < 1) {
+        shard_count = 1;
+    }
+    
+
+    // === 第一步：初始化映射表 ===
+    init_mapping_table(&g_mapping_table);
+    log_debug("初始化映射表 (最大并发请求数: %d)", MAX_CONCURRENT_REQUESTS);
+
+
+    // === 第二步：创建监听分片（套接字、接收缓冲区、事件循环） ===
+    for (int i = 0; i < shard_count; i++) {
+        if (listen_shard_init(&g_listen_shards[i], i, config) != MYSUCCESS) {
+            log_error("监听分片%d初始化失败", i);
+            listen_shards_shutdown();
+            return MYERROR;
+        }
+        g_listen_shard_count++;
+    }
+    log_info("DNS服务成功绑定到端口: %d（监听分片: %d）", DNS_PORT, shard_count);
+
+    // 每个上游使用专用的已连接套接字，上游响应不再与客户端请求共用监听套接字
+    if (upstream_receivers_attach() != MYSUCCESS) {
+        log_error("上游专用套接字初始化失败");
+        listen_shards_shutdown();
+        return MYERROR;
+    }
+    log_info("已为 %d 个上游DNS服务器创建专用套接字", g_upstream_receiver_count);
+
+    // 0号分片运行在主线程，同时承担定时维护任务
+    dns_listen_shard_t* main_shard = &g_listen_shards[0];
+    if (platform_event_loop_set_timer(&main_shard->event_loop, HOUSEKEEPING_INTERVAL_MS, NULL) != 0) {
+        log_error("注册维护定时器失败，错误码: %d", platform_get_last_error());
+        listen_shards_shutdown();
+        return MYERROR;
+    }
+
+    // === 第三步：初始化线程池 ===
+    int worker_count = 0; // 使用默认线程数（基于CPU核心数）
+    int queue_size = 0;   // 使用默认队列大小
+    
+    if (thread_pool_init(&g_dns_thread_pool, worker_count, queue_size, 
+                        main_shard->sock, &g_mapping_table) != MYSUCCESS) {
+        log_error("线程池初始化失败");
+        listen_shards_shutdown();
+        return MYERROR;
+    }
+
+    // 设置全局线程池实例，以便其他模块可以访问互斥锁
+    thread_pool_set_global_instance(&g_dns_thread_pool);
+    thread_pool_set_send_batch_size(&g_dns_thread_pool, config->send_batch_size);
+
+    // === 第四步：启动线程池 ===
+    if (thread_pool_start(&g_dns_thread_pool) != MYSUCCESS) {
+        log_error("线程池启动失败");
+        thread_pool_destroy(&g_dns_thread_pool);
+        listen_shards_shutdown();
+        return MYERROR;
+    }
+
+    // === 第五步：启动其余分片的I/O线程 ===
+    g_server_running = 1;
+    for (int i = 1; i < g_listen_shard_count; i++) {
+        if (platform_thread_create(&g_listen_shards[i].thread_id, NULL,
+                                   listen_shard_thread_main, &g_listen_shards[i]) != 0) {
+            log_error("创建监听分片%d的I/O线程失败", i);
+            listen_shards_shutdown();
+            thread_pool_stop(&g_dns_thread_pool, 5000);
+            thread_pool_destroy(&g_dns_thread_pool);
+            return MYERROR;
+        }
+        g_listen_shards[i].thread_started = 1;
+    }
+    log_info("批量收发已启用：接收批量 %d，发送批量 %d",
+             main_shard->recv_batch_size, g_dns_thread_pool.send_batch_size);
+    if (config->inline_fast_path) {
+        log_info("I/O线程快速路径已启用：本地表和缓存命中在收包线程内直接应答");
+    }
+
+    // === 第六步：主I/O事件循环（0号分片） ===
+    /*
+     * 在多线程架构中，I/O线程专门负责网络收包：
+     * 1. 监听网络事件（socket可读）
+     * 2. 接收UDP数据包
+     * 3. 将数据包封装成任务并提交给线程池
+     * 4. 主线程额外执行定期维护任务（1秒周期定时器驱动）
+     * 
+     * 启用多个分片时，每个分片一个SO_REUSEPORT套接字和一个I/O线程，
+     * 内核按四元组把客户端流量分散到各分片，收包不再受单个I/O线程限制。
+     */
+    if (config->cache_config_file) {
+        if (platform_reload_signal_install() == 0) {
+            log_info("收到SIGHUP时重新读取缓存配置: %s", config->cache_config_file);
+        } else {
+            log_warn("当前平台不支持重载信号，缓存配置只在启动时读取");
+        }
+    }
+
+    time_t last_cleanup = time(NULL);
+    time_t last_status_print = time(NULL);
+    platform_event_t events[PLATFORM_EVENT_MAX];
+    if (main_shard->send_batch.capacity > 0) {
+        send_batch_bind_current_thread(&main_shard->send_batch);
+    }
+    
+    while (g_server_running) {
+        int ready = platform_event_loop_wait(&main_shard->event_loop, events, PLATFORM_EVENT_MAX, -1);
+        if (ready < 0) {
+            log_error("等待事件失败，错误码: %d", platform_get_last_error());
+            break; // 发生严重错误，退出主循环
+        }
+
+        for (int i = 0; i < ready; i++) {
+            // === 处理网络数据接收 ===
+            if (!events[i].is_timer) {
+                handle_receive_threaded((dns_listen_shard_t*)events[i].data);
+                continue;
+            }
+
+            // === 定期维护任务（定时器驱动） ===
+            time_t current_time = time(NULL);
+            
+            // 收到重载信号后重新读取缓存配置并在线调整容量
+            if (config->cache_config_file && platform_reload_signal_take()) {
+                if (dns_cache_reload_config(config->cache_config_file) != MYSUCCESS) {
+                    log_warn("缓存配置重新加载失败，保持当前容量");
+                }
+            }
+            
+            // 每10秒清理一次过期映射
+            if (current_time - last_cleanup > 10) {
+                thread_pool_cleanup_mappings_safe();
+                last_cleanup = current_time;
+                log_debug("定期清理过期映射完成");
+            }
+            
+            // 每30秒打印一次服务器状态
+            if (current_time - last_status_print > 30) {
+                thread_pool_print_status(&g_dns_thread_pool);
+                print_listen_shard_status();
+                last_status_print = current_time;
+            }
+        }
+    }    // === 清理资源 ===
+    log_info("正在关闭多线程DNS代理服务器...");
+    send_batch_bind_current_thread(NULL);
+
+    // 先停止分片I/O线程，不再产生新任务
+    g_server_running = 0;
+    for (int i = 1; i < g_listen_shard_count; i++) {
+        if (g_listen_shards[i].thread_started) {
+            platform_thread_join(g_listen_shards[i].thread_id, NULL);
+            g_listen_shards[i].thread_started = 0;
+        }
+    }
+    
+    // 停止线程池（给工作线程5秒时间完成当前任务）
+    thread_pool_stop(&g_dns_thread_pool, 5000);
+    
+    // 销毁线程池
+    thread_pool_destroy(&g_dns_thread_pool);
+    
+    // 清除全局线程池实例
+    thread_pool_set_global_instance(NULL);
+    
+    // 清理DNS上游服务器池
+    upstream_pool_destroy(&g_upstream_pool);
+    log_debug("DNS上游服务器池已清理");
+
+    // 清理DNS缓存
+    dns_cache_destroy();
+
+    // 关闭监听分片（套接字、事件循环、接收缓冲区）
+    listen_shards_shutdown();
+    
+    log_info("多线程DNS代理服务器已关闭");
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 多线程版本的网络数据接收处理函数
+ * 
+ * 与单线程版本的主要区别：
+ * 1. 不直接解析和处理DNS数据包
+ * 2. 将接收到的原始数据提交给线程池
+ * 3. 由工作线程异步处理具体的DNS逻辑
+ * 4. 提高I/O处理的响应速度
+ * 
+ * 使用recvmmsg一次系统调用接收多个数据报，循环直到套接字读空。
+ * 每个监听分片由各自的I/O线程调用，只访问分片自身的缓冲区和统计。
+ * 任务类型由接收端点确定：监听套接字收到的是客户端请求，上游专用套接字收到的是上游响应。
+ * 分片启用快速路径时，客户端请求先在本线程查询本地表和缓存，只有未命中的请求才提交线程池。
+ *
+ * @param shard 就绪的接收端点（监听分片或上游专用套接字）
+ */
+int handle_receive_threaded(dns_listen_shard_t* shard) {
+    int receive_processed = 0;     // 本次处理的数据计数
+    int batch_received = 0;        // 单个批次接收到的数据报数
+    int refused_count = 0;         // 上游套接字上报的ICMP错误次数
+    task_type_t task_type = shard->is_upstream ? TASK_UPSTREAM_RESPONSE : TASK_CLIENT_REQUEST;
+
+    // === 批量处理接收到的数据 ===
+    // 事件循环为边沿触发，必须在一次就绪事件中读空套接字；
+    // recvmmsg以MSG_DONTWAIT返回不满一批即表示此刻已无数据，之后到达的数据报会重新触发事件
+    for (;;) {
+        batch_received = platform_recv_batch(shard->sock, shard->recv_dgrams, shard->recv_batch_size);
+        if (batch_received == SOCKET_ERROR && shard->is_upstream && refused_count < RECV_BATCH_MAX) {
+            // 已连接的UDP套接字会以接收错误的形式上报ICMP端口不可达，
+            // 读取即清除该错误，继续读空套接字以免边沿触发丢失后续数据报
+            refused_count++;
+            log_debug("上游套接字%d收到错误通知，错误码: %d", shard->index, platform_get_last_error());
+            continue;
+        }
+        if (batch_received <= 0) {
+            break;
+        }
+        shard->recv_batch_count++;
+        shard->recv_packet_count += batch_received;
+
+        for (int i = 0; i < batch_received; i++) {
+            platform_dgram_t* dgram = &shard->recv_dgrams[i];
+            int receive_len = dgram->length;
+            receive_processed++;
+            
+            // === 验证请求数据完整性 ===
+            if (receive_len < 2) {
+                log_warn("请求数据过短 (%d 字节)，来源: %s，忽略处理", receive_len, inet_ntoa(dgram->addr.sin_addr));
+                continue;
+            }
+
+            if (task_type == TASK_CLIENT_REQUEST) {
+                shard->client_requests++;
+                log_debug("收到客户端请求: %s, 长度: %d 字节", inet_ntoa(dgram->addr.sin_addr), receive_len);
+            } else {
+                shard->upstream_responses++;
+                log_debug("收到上游响应: %s, 长度: %d 字节", inet_ntoa(dgram->addr.sin_addr), receive_len);
+            }
+
+            // === 快速路径：命中直接应答，未命中的请求交给线程池转发 ===
+            task_type_t submit_type = task_type;
+            if (task_type == TASK_CLIENT_REQUEST && shard->inline_fast_path) {
+                int answered = handle_client_request_inline(shard, dgram);
+                if (answered != 0) {
+                    if (answered > 0) {
+                        shard->inline_answers++;
+                    }
+                    continue;
+                }
+                submit_type = TASK_CLIENT_FORWARD;
+            }
+
+            // === 提交任务到线程池 ===
+            if (thread_pool_submit_task(&g_dns_thread_pool, dgram->buffer, receive_len,
+                                       dgram->addr, dgram->addr_len, submit_type, shard->sock) != MYSUCCESS) {
+                shard->submit_failures++;
+                log_warn("任务提交失败，可能是队列已满，来源: %s", inet_ntoa(dgram->addr.sin_addr));
+            }
+        }
+
+        // 批次未填满说明套接字已读空
+        if (batch_received < shard->recv_batch_size) {
+            break;
+        }
+    }
+
+    // 发出本轮快速路径积累的响应
+    if (shard->send_batch.count > 0) {
+        send_batch_flush(&shard->send_batch);
+    }
+
+    // 记录批量处理结果
+    if (receive_processed > 0) {
+        log_debug("批量接收处理完成，本次处理: %d 个数据包", receive_processed);
+    }
+
+    // 检查是否是由于错误而退出循环
+    if (batch_received == SOCKET_ERROR) {
+        log_error("%s%d recvmmsg() 失败，错误码: %d",
+                  shard->is_upstream ? "上游套接字" : "分片", shard->index, platform_get_last_error());
+        return MYERROR;
+    }
+    
+    return MYSUCCESS;
+}
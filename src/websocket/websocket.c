@@ -1,323 +1,509 @@
-#include "websocket/websocket.h"
-
-// 最大IP地址长度（IPv6最大长度为45字符，加1为46）
-#define MAX_IP_LENGTH 46
-
-//全局变量定义
-struct sockaddr_in upstream_addr;
-upstream_dns_pool_t g_upstream_pool; // 全局上游DNS服务器池
-
-struct sockaddr_in get_upstream_addr()
-{
-    struct sockaddr_in upstream_addr;
-    // 初始化随机数种子
-    srand((unsigned int)time(NULL));
-    
-    // 从IP池中随机选择一个DNS服务器
-    struct sockaddr_in* selected_server = upstream_pool_get_random_server(&g_upstream_pool);
-    if (selected_server != NULL) {
-        // 直接返回选中的服务器地址
-        return *selected_server;
-    } else {
-        // 如果池为空或出错，使用默认DNS服务器
-        upstream_addr.sin_family = AF_INET; 
-        upstream_addr.sin_port = htons(DNS_PORT); 
-        upstream_addr.sin_addr.s_addr = inet_addr(DNS_SERVER); 
-        return upstream_addr;
-    }
-}
-
-/**
- * @brief 从配置文件加载DNS服务器列表
- * @param pool DNS服务器池指针
- * @param config_file 配置文件路径
- * @return 成功返回MYSUCCESS，失败返回MYERROR
- */
-int upstream_pool_load_from_file(upstream_dns_pool_t* pool, const char* config_file) {
-    if (!pool || !config_file) {
-        return MYERROR;
-    }
-    
-    FILE* file = fopen(config_file, "r");
-    if (!file) {
-        return MYERROR;
-    }
-    
-    char line[256];
-    int loaded_count = 0;
-    
-    while (fgets(line, sizeof(line), file) && loaded_count < MAX_UPSTREAM_SERVERS) {
-        // 移除行尾的换行符
-        char* newline = strchr(line, '\n');
-        if (newline) {
-            *newline = '\0';
-        }
-        
-        // 跳过空行和注释行
-        if (strlen(line) == 0 || line[0] == '#') {
-            continue;
-        }
-        
-        // 简单的IP地址格式验证
-        if (strlen(line) >= 7 && strlen(line) < MAX_IP_LENGTH) {
-            if (upstream_pool_add_server(pool, line) == MYSUCCESS) {
-                loaded_count++;
-            }
-        }
-    }
-    
-    fclose(file);
-    
-    if (loaded_count > 0) {
-        log_debug("从配置文件成功加载 %d 个DNS服务器", loaded_count);
-        return MYSUCCESS;
-    } else {
-        return MYERROR;
-    }
-}
-
-/**
- * @brief 打印当前DNS服务器池状态
- * @param pool DNS服务器池指针
- */
-void upstream_pool_print_status(upstream_dns_pool_t* pool) {
-    if (!pool) {
-        log_error("DNS服务器池: 未初始化\n");
-        return;
-    }
-
-    log_info("=== DNS上游服务器池状态 ===");
-    log_info("服务器数量: %d/%d", pool->server_count, MAX_UPSTREAM_SERVERS);
-    log_info("当前索引: %d", pool->current_index);
-    log_info("服务器列表:");
-
-    for (int i = 0; i < pool->server_count; i++) {
-        log_info("  [%d] %s", i, inet_ntoa(pool->servers[i].sin_addr));
-    }
-
-    log_info("=========================");
-}
-
-/**
- * @brief 初始化上游DNS服务器池
- * @param pool 服务器池指针
- * @return 成功返回MYSUCCESS，失败返回MYERROR
- */
-int upstream_pool_init(upstream_dns_pool_t* pool, const char* config_file) {
-    if (!pool) {
-        return MYERROR;
-    }
-    
-    pool->server_count = 0;
-    pool->current_index = 0;
-    // 尝试从配置文件加载，失败则使用默认DNS服务器
-    if (upstream_pool_load_from_file(pool, config_file) != MYSUCCESS) {
-        log_error("从配置文件加载上游DNS失败，使用谷歌公共DNS服务器: %s", "8.8.8.8");
-        upstream_pool_add_server(pool, "8.8.8.8");  
-    }
-    log_info("成功加载上游DNS服务器池，当前服务器数量: %d", pool->server_count);
-    upstream_pool_print_status(pool);  // 打印当前池状态
-
-    return MYSUCCESS;
-}
-
-/**
- * @brief 向DNS服务器池添加服务器 - 优化版本
- * @param pool 服务器池指针
- * @param ip_address IP地址字符串
- * @return 成功返回MYSUCCESS，失败返回MYERROR
- */
-int upstream_pool_add_server(upstream_dns_pool_t* pool, const char* ip_address) {
-    if (!pool || !ip_address) {
-        log_error("upstream_pool_add_server: 无效参数");
-        return MYERROR;
-    }
-    
-    if (pool->server_count >= MAX_UPSTREAM_SERVERS) {
-        log_error("DNS服务器池已满，无法添加更多服务器 (最大: %d)", MAX_UPSTREAM_SERVERS);
-        return MYERROR;
-    }
-    
-    // 检查IP地址是否已存在
-    if (upstream_pool_contains_server(pool, ip_address) == 1) {
-        log_warn("DNS服务器 %s 已存在于池中", ip_address);
-        return MYSUCCESS; // 视为成功，避免重复添加
-    }
-    
-    // 直接在池中设置完整的sockaddr_in结构
-    struct sockaddr_in* server_addr = &pool->servers[pool->server_count];
-    memset(server_addr, 0, sizeof(struct sockaddr_in));
-    
-    server_addr->sin_family = AF_INET;
-    server_addr->sin_port = htons(DNS_PORT);
-    
-    // 转换IP地址字符串为网络地址
-    if (inet_addr(ip_address) == INADDR_NONE) {
-        log_error("无效的IP地址格式: %s", ip_address);
-        return MYERROR;
-    }
-    
-    server_addr->sin_addr.s_addr = inet_addr(ip_address);
-    pool->server_count++;
-
-    log_info("成功添加DNS服务器: %s (总数: %d)", ip_address, pool->server_count);
-    return MYSUCCESS;
-}
-
-/**
- * @brief 从DNS服务器池中随机获取一个服务器地址 - 优化版本
- * @param pool 服务器池指针
- * @return 成功返回服务器地址指针，失败返回NULL
- */
-struct sockaddr_in* upstream_pool_get_random_server(upstream_dns_pool_t* pool) {
-    if (!pool || pool->server_count == 0) {
-        return NULL;
-    }
-    
-    // 生成随机索引
-    int random_index = rand() % pool->server_count;
-    
-    log_debug("随机选择DNS服务器: %s (索引: %d/%d)", 
-             inet_ntoa(pool->servers[random_index].sin_addr), 
-             random_index, pool->server_count - 1);
-    
-    return &pool->servers[random_index];
-}
-
-/**
- * @brief 从DNS服务器池中轮询获取下一个服务器地址
- * @param pool 服务器池指针
- * @return 成功返回服务器地址指针，失败返回NULL
- */
-struct sockaddr_in* upstream_pool_get_next_server(upstream_dns_pool_t* pool) {
-    if (!pool || pool->server_count == 0) {
-        return NULL;
-    }
-    
-    // 轮询获取下一个服务器
-    struct sockaddr_in* server_addr = &pool->servers[pool->current_index];
-    
-    log_debug("轮询选择DNS服务器: %s (索引: %d/%d)", 
-             inet_ntoa(server_addr->sin_addr), 
-             pool->current_index, pool->server_count - 1);
-    
-    // 更新索引到下一个服务器
-    pool->current_index = (pool->current_index + 1) % pool->server_count;
-    
-    return server_addr;
-}
-
-
-/**
- * @brief 销毁DNS服务器池
- * @param pool 服务器池指针
- */
-void upstream_pool_destroy(upstream_dns_pool_t* pool) {
-    if (!pool) {
-        return;
-    }
-    pool->server_count = 0;
-    pool->current_index = 0;
-}
-
-int sendDnsPacket(SOCKET sock,struct sockaddr_in address,const DNS_ENTITY* dns_entity)
-{
-
-    //发送数据包：
-    log_debug("%s",dns_entity_to_string(dns_entity));
-    char buf[BUF_SIZE];      // 用于发送数据的缓冲区    
-    // 将DNS_ENTITY序列化为字节流
-    int packet_len = serialize_dns_packet(buf, dns_entity);
-    if (packet_len <= 0) {
-        log_error("DNS数据包序列化失败，数据包长度=%d", packet_len);
-        return MYERROR;
-    }  
-    
-    // 使用 sendto 函数通过 UDP 发送数据
-    if (sendto(sock, buf, packet_len, 0, (struct sockaddr *)&address, sizeof(address)) == SOCKET_ERROR) {
-        int error = platform_get_last_error();
-        log_error("sendto 调用失败，错误码: %d", error);        // === 错误处理和分类 ===
-#ifdef _WIN32
-        if (error == WSAEWOULDBLOCK) {
-#else
-        if (error == EWOULDBLOCK || error == EAGAIN) {
-#endif
-            // 发送缓冲区满，这在高负载时可能发生
-            log_warn("发送缓冲区已满 (WOULDBLOCK)，请求可能延迟");
-            // 注意：在真实的生产环境中，这里可能需要重试逻辑
-            return MYSUCCESS;  // 视为成功，因为数据最终会被发送
-        } else {
-            // 真正的网络错误
-            log_error("向 %s:%d 发送数据失败，错误码: %d", 
-                     inet_ntoa(address.sin_addr), ntohs(address.sin_port), error);
-            return MYERROR;
-        }
-    }
-    
-    // === 记录成功发送 ===
-    
-    
-    return MYSUCCESS;
-}
-
-/**
- * @brief 判断指定IP地址是否在DNS服务器池中 - 优化版本
- * @param pool 服务器池指针
- * @param ip_address 要检查的IP地址字符串
- * @return 存在返回1，不存在返回0，出错返回-1
- */
-int upstream_pool_contains_server(upstream_dns_pool_t* pool, const char* ip_address) {
-    if (!pool || !ip_address) {
-        return -1; // 参数错误
-    }
-    
-    // 如果池为空，直接返回不存在
-    if (pool->server_count == 0) {
-        return 0;
-    }
-    
-    // 将输入的IP地址字符串转换为网络地址，用于比较
-    unsigned long target_addr = inet_addr(ip_address);
-    if (target_addr == INADDR_NONE) {
-        log_error("无效的IP地址格式: %s", ip_address);
-        return -1; // IP地址格式错误
-    }
-    
-    // 遍历服务器池中的所有地址结构
-    for (int i = 0; i < pool->server_count; i++) {
-        if (pool->servers[i].sin_addr.s_addr == target_addr) {
-            return 1; // 找到匹配的IP
-        }
-    }
-      return 0; // 未找到
-}
-
-
-/**
- * @brief 向轮询选择的上游DNS服务器发送DNS数据包
- * @param sock 套接字
- * @param dns_entity DNS实体
- * @return 成功返回MYSUCCESS，失败返回MYERROR
- */
-int sendDnsPacketToNextUpstream(SOCKET sock, const DNS_ENTITY* dns_entity)
-{
-    struct sockaddr_in default_addr;
-    
-    // 从IP池中轮询选择下一个DNS服务器
-    struct sockaddr_in* target_addr = upstream_pool_get_next_server(&g_upstream_pool);
-    if (target_addr == NULL) {
-        // 如果池为空或出错，使用默认DNS服务器
-        default_addr.sin_family = AF_INET;
-        default_addr.sin_port = htons(DNS_PORT);
-        default_addr.sin_addr.s_addr = inet_addr(DNS_SERVER);
-        target_addr = &default_addr;
-        
-        log_warn("DNS服务器池为空，使用默认服务器: %s", DNS_SERVER);
-    }
-    
-    log_debug("发送到轮询DNS：%s", inet_ntoa(target_addr->sin_addr));
-
-    // 发送DNS数据包到选定的服务器
-    return sendDnsPacket(sock, *target_addr, dns_entity);
-}
-
+#include "websocket/websocket.h"
+
+// 最大IP地址长度（IPv6最大长度为45字符，加1为46）
+#define MAX_IP_LENGTH 46
+
+//全局变量定义
+struct sockaddr_in upstream_addr;
+upstream_dns_pool_t g_upstream_pool; // 全局上游DNS服务器池
+
+struct sockaddr_in get_upstream_addr()
+{
+    struct sockaddr_in upstream_addr;
+    // 初始化随机数种子
+    srand((unsigned int)time(NULL));
+    
+    // 从IP池中随机选择一个DNS服务器
+    struct sockaddr_in* selected_server = upstream_pool_get_random_server(&g_upstream_pool);
+    if (selected_server != NULL) {
+        // 直接返回选中的服务器地址
+        return *selected_server;
+    } else {
+        // 如果池为空或出错，使用默认DNS服务器
+        upstream_addr.sin_family = AF_INET; 
+        upstream_addr.sin_port = htons(DNS_PORT); 
+        upstream_addr.sin_addr.s_addr = inet_addr(DNS_SERVER); 
+        return upstream_addr;
+    }
+}
+
+/**
+ * @brief 从配置文件加载DNS服务器列表
+ * @param pool DNS服务器池指针
+ * @param config_file 配置文件路径
+ * @return 成功返回MYSUCCESS，失败返回MYERROR
+ */
+int upstream_pool_load_from_file(upstream_dns_pool_t* pool, const char* config_file) {
+    if (!pool || !config_file) {
+        return MYERROR;
+    }
+    
+    FILE* file = fopen(config_file, "r");
+    if (!file) {
+        return MYERROR;
+    }
+    
+    char line[256];
+    int loaded_count = 0;
+    
+    while (fgets(line, sizeof(line), file) && loaded_count < MAX_UPSTREAM_SERVERS) {
+        // 移除行尾的换行符
+        char* newline = strchr(line, '\n');
+        if (newline) {
+            *newline = '\0';
+        }
+        
+        // 跳过空行和注释行
+        if (strlen(line) == 0 || line[0] == '#') {
+            continue;
+        }
+        
+        // 简单的IP地址格式验证
+        if (strlen(line) >= 7 && strlen(line) < MAX_IP_LENGTH) {
+            if (upstream_pool_add_server(pool, line) == MYSUCCESS) {
+                loaded_count++;
+            }
+        }
+    }
+    
+    fclose(file);
+    
+    if (loaded_count > 0) {
+        log_debug("从配置文件成功加载 %d 个DNS服务器", loaded_count);
+        return MYSUCCESS;
+    } else {
+        return MYERROR;
+    }
+}
+
+/**
+ * @brief 打印当前DNS服务器池状态
+ * @param pool DNS服务器池指针
+ */
+void upstream_pool_print_status(upstream_dns_pool_t* pool) {
+    if (!pool) {
+        log_error("DNS服务器池: 未初始化\n");
+        return;
+    }
+
+    log_info("=== DNS上游服务器池状态 ===");
+    log_info("服务器数量: %d/%d", pool->server_count, MAX_UPSTREAM_SERVERS);
+    log_info("轮询计数: %u", platform_atomic_load_relaxed(&pool->next_index));
+    log_info("服务器列表:");
+
+    for (int i = 0; i < pool->server_count; i++) {
+        log_info("  [%d] %s", i, inet_ntoa(pool->servers[i].sin_addr));
+    }
+
+    log_info("=========================");
+}
+
+/**
+ * @brief 初始化上游DNS服务器池
+ * @param pool 服务器池指针
+ * @return 成功返回MYSUCCESS，失败返回MYERROR
+ */
+int upstream_pool_init(upstream_dns_pool_t* pool, const char* config_file) {
+    if (!pool) {
+        return MYERROR;
+    }
+    
+    pool->server_count = 0;
+    pool->next_index = 0;
+    for (int i = 0; i < MAX_UPSTREAM_SERVERS; i++) {
+        pool->sockets[i] = INVALID_SOCKET;
+    }
+    // 尝试从配置文件加载，失败则使用默认DNS服务器
+    if (upstream_pool_load_from_file(pool, config_file) != MYSUCCESS) {
+        log_error("从配置文件加载上游DNS失败，使用谷歌公共DNS服务器: %s", "8.8.8.8");
+        upstream_pool_add_server(pool, "8.8.8.8");  
+    }
+    log_info("成功加载上游DNS服务器池，当前服务器数量: %d", pool->server_count);
+    upstream_pool_print_status(pool);  // 打印当前池状态
+
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 向DNS服务器池添加服务器 - 优化版本
+ * @param pool 服务器池指针
+ * @param ip_address IP地址字符串
+ * @return 成功返回MYSUCCESS，失败返回MYERROR
+ */
+int upstream_pool_add_server(upstream_dns_pool_t* pool, const char* ip_address) {
+    if (!pool || !ip_address) {
+        log_error("upstream_pool_add_server: 无效参数");
+        return MYERROR;
+    }
+    
+    if (pool->server_count >= MAX_UPSTREAM_SERVERS) {
+        log_error("DNS服务器池已满，无法添加更多服务器 (最大: %d)", MAX_UPSTREAM_SERVERS);
+        return MYERROR;
+    }
+    
+    // 检查IP地址是否已存在
+    if (upstream_pool_contains_server(pool, ip_address) == 1) {
+        log_warn("DNS服务器 %s 已存在于池中", ip_address);
+        return MYSUCCESS; // 视为成功，避免重复添加
+    }
+    
+    // 直接在池中设置完整的sockaddr_in结构
+    struct sockaddr_in* server_addr = &pool->servers[pool->server_count];
+    memset(server_addr, 0, sizeof(struct sockaddr_in));
+    
+    server_addr->sin_family = AF_INET;
+    server_addr->sin_port = htons(DNS_PORT);
+    
+    // 转换IP地址字符串为网络地址
+    if (inet_addr(ip_address) == INADDR_NONE) {
+        log_error("无效的IP地址格式: %s", ip_address);
+        return MYERROR;
+    }
+    
+    server_addr->sin_addr.s_addr = inet_addr(ip_address);
+    pool->sockets[pool->server_count] = INVALID_SOCKET;
+    pool->server_count++;
+
+    log_info("成功添加DNS服务器: %s (总数: %d)", ip_address, pool->server_count);
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 从DNS服务器池中随机获取一个服务器地址 - 优化版本
+ * @param pool 服务器池指针
+ * @return 成功返回服务器地址指针，失败返回NULL
+ */
+struct sockaddr_in* upstream_pool_get_random_server(upstream_dns_pool_t* pool) {
+    if (!pool || pool->server_count == 0) {
+        return NULL;
+    }
+    
+    // 生成随机索引
+    int random_index = rand() % pool->server_count;
+    
+    log_debug("随机选择DNS服务器: %s (索引: %d/%d)", 
+             inet_ntoa(pool->servers[random_index].sin_addr), 
+             random_index, pool->server_count - 1);
+    
+    return &pool->servers[random_index];
+}
+
+/**
+ * @brief 从DNS服务器池中轮询获取下一个服务器地址（多线程并发调用安全）
+ * @param pool 服务器池指针
+ * @return 成功返回服务器地址指针，失败返回NULL
+ */
+struct sockaddr_in* upstream_pool_get_next_server(upstream_dns_pool_t* pool) {
+    if (!pool || pool->server_count == 0) {
+        return NULL;
+    }
+    
+    // 轮询计数原子递增，无符号回绕后取模仍落在合法范围内
+    int index = (int)(platform_atomic_fetch_add(&pool->next_index, 1u) % (unsigned int)pool->server_count);
+    struct sockaddr_in* server_addr = &pool->servers[index];
+    
+    log_debug("轮询选择DNS服务器: %s (索引: %d/%d)", 
+             inet_ntoa(server_addr->sin_addr), 
+             index, pool->server_count - 1);
+    
+    return server_addr;
+}
+
+
+/**
+ * @brief 为每个上游服务器创建专用的已连接UDP套接字
+ *
+ * connect()后内核为套接字分配随机的临时源端口，并只接收来自该上游地址的数据报，
+ * 伪造源地址的响应在内核中即被丢弃；收到的数据报类型由套接字本身确定。
+ *
+ * @param pool 服务器池指针
+ * @return 成功返回MYSUCCESS，失败返回MYERROR（已创建的套接字会被关闭）
+ */
+int upstream_pool_open_sockets(upstream_dns_pool_t* pool) {
+    if (!pool) {
+        return MYERROR;
+    }
+
+    for (int i = 0; i < pool->server_count; i++) {
+        SOCKET sock = create_socket();
+        if (sock == INVALID_SOCKET) {
+            log_error("创建上游套接字失败，错误码: %d", platform_get_last_error());
+            upstream_pool_close_sockets(pool);
+            return MYERROR;
+        }
+
+        if (set_socket_nonblocking(sock) == SOCKET_ERROR ||
+            connect(sock, (struct sockaddr*)&pool->servers[i], sizeof(pool->servers[i])) == SOCKET_ERROR) {
+            log_error("连接上游DNS服务器 %s 失败，错误码: %d",
+                      inet_ntoa(pool->servers[i].sin_addr), platform_get_last_error());
+            closesocket(sock);
+            upstream_pool_close_sockets(pool);
+            return MYERROR;
+        }
+
+        pool->sockets[i] = sock;
+        log_debug("上游DNS服务器 %s 的专用套接字已创建", inet_ntoa(pool->servers[i].sin_addr));
+    }
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 关闭所有上游专用套接字
+ * @param pool 服务器池指针
+ */
+void upstream_pool_close_sockets(upstream_dns_pool_t* pool) {
+    if (!pool) {
+        return;
+    }
+    for (int i = 0; i < MAX_UPSTREAM_SERVERS; i++) {
+        if (pool->sockets[i] != INVALID_SOCKET) {
+            closesocket(pool->sockets[i]);
+            pool->sockets[i] = INVALID_SOCKET;
+        }
+    }
+}
+
+/**
+ * @brief 销毁DNS服务器池
+ * @param pool 服务器池指针
+ */
+void upstream_pool_destroy(upstream_dns_pool_t* pool) {
+    if (!pool) {
+        return;
+    }
+    upstream_pool_close_sockets(pool);
+    pool->server_count = 0;
+    pool->next_index = 0;
+}
+
+// ============================================================================
+// 批量发送实现
+// ============================================================================
+
+static pthread_key_t g_send_batch_key;
+static pthread_once_t g_send_batch_key_once = PTHREAD_ONCE_INIT;
+
+static void send_batch_create_key(void) {
+    pthread_key_create(&g_send_batch_key, NULL);
+}
+
+/**
+ * @brief 初始化批量发送缓冲区
+ * @param batch 批次指针
+ * @param capacity 批次容量（1~SEND_BATCH_MAX）
+ * @return 成功返回MYSUCCESS，失败返回MYERROR
+ */
+int send_batch_init(dns_send_batch_t* batch, int capacity) {
+    if (!batch) return MYERROR;
+
+    memset(batch, 0, sizeof(dns_send_batch_t));
+    if (capacity <= 0) capacity = DEFAULT_SEND_BATCH_SIZE;
+    if (capacity > SEND_BATCH_MAX) capacity = SEND_BATCH_MAX;
+
+    batch->storage = (char*)malloc((size_t)capacity * SEND_BATCH_SLOT_SIZE);
+    if (!batch->storage) {
+        log_error("批量发送缓冲区内存分配失败，容量: %d", capacity);
+        return MYERROR;
+    }
+
+    for (int i = 0; i < capacity; i++) {
+        batch->dgrams[i].buffer = batch->storage + (size_t)i * SEND_BATCH_SLOT_SIZE;
+        batch->dgrams[i].buffer_size = SEND_BATCH_SLOT_SIZE;
+    }
+    batch->capacity = capacity;
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 销毁批量发送缓冲区（未发送的数据包会先被刷新）
+ */
+void send_batch_destroy(dns_send_batch_t* batch) {
+    if (!batch) return;
+
+    if (batch->storage) {
+        send_batch_flush(batch);
+        free(batch->storage);
+        batch->storage = NULL;
+    }
+    batch->count = 0;
+    batch->capacity = 0;
+}
+
+/**
+ * @brief 刷新批次：将连续使用同一套接字的数据报合并为一次批量发送
+ * @return 返回成功发送的数据包数
+ */
+int send_batch_flush(dns_send_batch_t* batch) {
+    if (!batch || batch->count == 0) return 0;
+
+    int sent = 0;
+    int start = 0;
+    while (start < batch->count) {
+        int end = start + 1;
+        while (end < batch->count && batch->sockets[end] == batch->sockets[start]) {
+            end++;
+        }
+        int group_sent = platform_send_batch(batch->sockets[start], &batch->dgrams[start], end - start);
+        batch->drop_count += (unsigned long)(end - start - group_sent);
+        sent += group_sent;
+        batch->flush_count++;
+        start = end;
+    }
+
+    if (sent < batch->count) {
+        log_warn("批量发送部分失败: %d/%d", sent, batch->count);
+    }
+    batch->packet_count += sent;
+    batch->count = 0;
+    return sent;
+}
+
+/**
+ * @brief 将批次绑定到当前线程，之后该线程的sendDnsRawPacket调用只入批不立即发送
+ */
+void send_batch_bind_current_thread(dns_send_batch_t* batch) {
+    pthread_once(&g_send_batch_key_once, send_batch_create_key);
+    pthread_setspecific(g_send_batch_key, batch);
+}
+
+/**
+ * @brief 获取当前线程绑定的批次，未绑定返回NULL
+ */
+dns_send_batch_t* send_batch_get_current_thread(void) {
+    pthread_once(&g_send_batch_key_once, send_batch_create_key);
+    return (dns_send_batch_t*)pthread_getspecific(g_send_batch_key);
+}
+
+/**
+ * @brief 发送已编码的DNS数据包：当前线程绑定了批次时入批，否则直接sendto
+ *
+ * address为NULL表示sock是已连接的套接字（上游专用套接字），使用send()发送，
+ * 已连接的UDP套接字再指定目的地址时BSD/macOS会返回EISCONN。
+ */
+int sendDnsRawPacket(SOCKET sock, const struct sockaddr_in* address, const char* buf, int packet_len)
+{
+    dns_send_batch_t* batch = send_batch_get_current_thread();
+    if (batch && batch->capacity > 0 && packet_len <= SEND_BATCH_SLOT_SIZE) {
+        platform_dgram_t* dgram = &batch->dgrams[batch->count];
+        memcpy(dgram->buffer, buf, packet_len);
+        dgram->length = packet_len;
+        if (address) {
+            dgram->addr = *address;
+            dgram->addr_len = sizeof(struct sockaddr_in);
+        } else {
+            dgram->addr_len = 0;
+        }
+        batch->sockets[batch->count] = sock;
+        batch->count++;
+
+        // 批次已满立即刷新
+        if (batch->count >= batch->capacity) {
+            send_batch_flush(batch);
+        }
+        return MYSUCCESS;
+    }
+
+    // 使用 sendto 函数通过 UDP 发送数据（已连接套接字使用 send）
+    int result = address ? sendto(sock, buf, packet_len, 0, (const struct sockaddr *)address, sizeof(*address))
+                         : send(sock, buf, packet_len, 0);
+    if (result == SOCKET_ERROR) {
+        int error = platform_get_last_error();
+        log_error("%s 调用失败，错误码: %d", address ? "sendto" : "send", error);        // === 错误处理和分类 ===
+#ifdef _WIN32
+        if (error == WSAEWOULDBLOCK) {
+#else
+        if (error == EWOULDBLOCK || error == EAGAIN) {
+#endif
+            // 发送缓冲区满，这在高负载时可能发生
+            log_warn("发送缓冲区已满 (WOULDBLOCK)，请求可能延迟");
+            // 注意：在真实的生产环境中，这里可能需要重试逻辑
+            return MYSUCCESS;  // 视为成功，因为数据最终会被发送
+        } else {
+            // 真正的网络错误
+            if (address) {
+                log_error("向 %s:%d 发送数据失败，错误码: %d", 
+                         inet_ntoa(address->sin_addr), ntohs(address->sin_port), error);
+            } else {
+                log_error("经已连接套接字发送数据失败，错误码: %d", error);
+            }
+            return MYERROR;
+        }
+    }
+    
+    // === 记录成功发送 ===
+    
+    
+    return MYSUCCESS;
+}
+
+/**
+ * @brief 判断指定IP地址是否在DNS服务器池中 - 优化版本
+ * @param pool 服务器池指针
+ * @param ip_address 要检查的IP地址字符串
+ * @return 存在返回1，不存在返回0，出错返回-1
+ */
+int upstream_pool_contains_server(upstream_dns_pool_t* pool, const char* ip_address) {
+    if (!pool || !ip_address) {
+        return -1; // 参数错误
+    }
+    
+    // 如果池为空，直接返回不存在
+    if (pool->server_count == 0) {
+        return 0;
+    }
+    
+    // 将输入的IP地址字符串转换为网络地址，用于比较
+    unsigned long target_addr = inet_addr(ip_address);
+    if (target_addr == INADDR_NONE) {
+        log_error("无效的IP地址格式: %s", ip_address);
+        return -1; // IP地址格式错误
+    }
+    
+    // 遍历服务器池中的所有地址结构
+    for (int i = 0; i < pool->server_count; i++) {
+        if (pool->servers[i].sin_addr.s_addr == target_addr) {
+            return 1; // 找到匹配的IP
+        }
+    }
+      return 0; // 未找到
+}
+
+
+/**
+ * @brief 向轮询选择的上游DNS服务器发送已编码的DNS数据包
+ *
+ * 上游已创建专用套接字时经专用套接字用send()发送（套接字已连接，不再指定目的地址），
+ * 响应也只会从该套接字返回；否则退回使用调用方传入的套接字sendto。
+ *
+ * @param sock 后备套接字
+ * @param buf 报文
+ * @param packet_len 报文长度
+ * @return 成功返回MYSUCCESS，失败返回MYERROR
+ */
+int sendDnsRawPacketToNextUpstream(SOCKET sock, const char* buf, int packet_len)
+{
+    struct sockaddr_in default_addr;
+    
+    // 从IP池中轮询选择下一个DNS服务器
+    struct sockaddr_in* target_addr = upstream_pool_get_next_server(&g_upstream_pool);
+    if (target_addr != NULL) {
+        SOCKET upstream_sock = g_upstream_pool.sockets[target_addr - g_upstream_pool.servers];
+        if (upstream_sock != INVALID_SOCKET) {
+            log_debug("发送到轮询DNS：%s", inet_ntoa(target_addr->sin_addr));
+            return sendDnsRawPacket(upstream_sock, NULL, buf, packet_len);
+        }
+    } else {
+        // 如果池为空或出错，使用默认DNS服务器
+        default_addr.sin_family = AF_INET;
+        default_addr.sin_port = htons(DNS_PORT);
+        default_addr.sin_addr.s_addr = inet_addr(DNS_SERVER);
+        target_addr = &default_addr;
+        
+        log_warn("DNS服务器池为空，使用默认服务器: %s", DNS_SERVER);
+    }
+    
+    log_debug("发送到轮询DNS：%s", inet_ntoa(target_addr->sin_addr));
+
+    // 发送DNS数据包到选定的服务器
+    return sendDnsRawPacket(sock, target_addr, buf, packet_len);
+}